@@ -0,0 +1,353 @@
+#
+# Scaling benchmark of the device tree generator
+#
+# Synthesizes Microblaze designs with N peripherals on a tree of AXI
+# interconnects and a PLB bus, writes them as hardware descriptions for
+# the offline backend and times generation end to end and per phase:
+#
+#   tclsh device-tree_bench.tcl [-sizes {10 100 1000 5000}] [-levels 3]
+#       [-fanout 2] [-out bench_out] [-baseline <directory>] [-phases 1]
+#
+# With -baseline, the generated device trees are compared with the ones
+# of an earlier run in that directory and the exit code is 1 if any of
+# them differs. Lines with the date and the project directory are ignored.
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License as
+# published by the Free Software Foundation; either version 2 of
+# the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+# MA 02111-1307 USA
+
+namespace eval ::bench {
+	variable data_dir [file join [file dirname [file normalize [info script]]] .. data]
+
+	# Peripherals cycled through by the synthesized designs:
+	# type HW_VER interrupt_port sensitivity clock_port parameters
+	variable axi_types {
+		{axi_gpio 1.01.b IP2INTC_Irpt LEVEL_HIGH S_AXI_ACLK {C_GPIO_WIDTH 8 C_INTERRUPT_PRESENT 1 C_IS_DUAL 0}}
+		{axi_uartlite 1.02.a Interrupt EDGE_RISING S_AXI_ACLK {C_BAUDRATE 115200 C_DATA_BITS 8 C_USE_PARITY 0 C_ODD_PARITY 0}}
+		{axi_uart16550 1.01.a IP2INTC_Irpt LEVEL_HIGH S_AXI_ACLK {C_IS_A_16550 1 C_HAS_EXTERNAL_XIN 0}}
+		{axi_timer 1.03.a Interrupt EDGE_RISING S_AXI_ACLK {C_COUNT_WIDTH 32 C_ONE_TIMER_ONLY 0}}
+		{axi_iic 1.01.b IIC2INTC_Irpt EDGE_RISING S_AXI_ACLK {C_IIC_FREQ 100000 C_TEN_BIT_ADR 0 C_GPO_WIDTH 1}}
+		{axi_quad_spi 2.00.a IP2INTC_Irpt EDGE_RISING S_AXI_ACLK {C_SCK_RATIO 4 C_NUM_SS_BITS 1 C_NUM_TRANSFER_BITS 8 C_FIFO_EXIST 1 C_SPI_MODE 0}}
+		{axi_timebase_wdt 1.02.a WDT_Interrupt EDGE_RISING S_AXI_ACLK {C_WDT_INTERVAL 30 C_WDT_ENABLE_ONCE 0}}
+		{axi_hwicap 2.03.a ip2intc_irpt LEVEL_HIGH S_AXI_ACLK {C_WRITE_FIFO_DEPTH 64 C_ICAP_DWIDTH 32 C_MODE FAST}}
+	}
+	variable plb_types {
+		{xps_gpio 2.00.a IP2INTC_Irpt LEVEL_HIGH SPLB_Clk {C_GPIO_WIDTH 8 C_INTERRUPT_PRESENT 1 C_IS_DUAL 0}}
+		{xps_uartlite 1.02.a Interrupt EDGE_RISING SPLB_Clk {C_BAUDRATE 115200 C_DATA_BITS 8 C_USE_PARITY 0 C_ODD_PARITY 0}}
+		{xps_timer 1.02.a Interrupt EDGE_RISING SPLB_Clk {C_COUNT_WIDTH 32 C_ONE_TIMER_ONLY 0}}
+		{xps_iic 2.03.a IIC2INTC_Irpt EDGE_RISING SPLB_Clk {C_IIC_FREQ 100000 C_TEN_BIT_ADR 0 C_GPO_WIDTH 1}}
+	}
+
+	# Address space of the synthesized peripherals, 64 KiB each
+	variable periph_base 0x44000000
+	variable periph_size 0x10000
+}
+
+# Synthesized design
+# design(buses) - bus names, design(parent,$bus) - parent bus
+# design(kind,$bus) - axi or plb, design(ips,$bus) - peripherals on bus
+# design(base,$bus)/design(high,$bus) - address window of the bus subtree
+proc ::bench::add_bus {designvar name kind parent} {
+	upvar $designvar design
+
+	lappend design(buses) $name
+	set design(kind,$name) $kind
+	set design(parent,$name) $parent
+	set design(children,$name) {}
+	set design(ips,$name) {}
+	if {$parent != ""} {
+		lappend design(children,$parent) $name
+	}
+}
+
+# Give every bus subtree a contiguous address window
+proc ::bench::place {designvar bus next} {
+	upvar $designvar design
+	variable periph_size
+
+	set design(base,$bus) $next
+	set count [llength $design(ips,$bus)]
+	if {$count == 0} {
+		set count 1
+	}
+	set next [expr {$next + $count * $periph_size}]
+	foreach child $design(children,$bus) {
+		set next [place design $child $next]
+	}
+	set design(high,$bus) [expr {$next - 1}]
+	return $next
+}
+
+proc ::bench::hex {value} {
+	return [format "0x%08x" $value]
+}
+
+proc ::bench::clock_port {name} {
+	return [list port $name clk_100 {SIGIS CLK CLK_FREQ_HZ 100000000 DIR I}]
+}
+
+proc ::bench::ip {name type body} {
+	set out "[list ip $name $type] \{\n"
+	foreach entry $body {
+		append out "\t$entry\n"
+	}
+	append out "\}\n"
+	return $out
+}
+
+proc ::bench::synthesize {count levels fanout filepath} {
+	variable axi_types
+	variable plb_types
+	variable periph_base
+	variable periph_size
+
+	array set design {buses {}}
+	add_bus design axi4lite_0 axi ""
+	set frontier axi4lite_0
+	for {set level 1} {$level < $levels} {incr level} {
+		set next {}
+		foreach parent $frontier {
+			for {set i 0} {$i < $fanout} {incr i} {
+				set bus "axi_l${level}_[llength $design(buses)]"
+				add_bus design $bus axi $parent
+				lappend next $bus
+			}
+		}
+		set frontier $next
+	}
+	add_bus design plb_0 plb axi4lite_0
+
+	# Spread the peripherals over the buses, every fifth one on the PLB
+	set axi_buses {}
+	foreach bus $design(buses) {
+		if {$design(kind,$bus) == "axi"} {
+			lappend axi_buses $bus
+		}
+	}
+	set periphs {}
+	for {set i 0} {$i < $count} {incr i} {
+		if {$i % 5 == 4} {
+			set bus plb_0
+			set desc [lindex $plb_types [expr {($i / 5) % [llength $plb_types]}]]
+		} else {
+			set bus [lindex $axi_buses [expr {$i % [llength $axi_buses]}]]
+			set desc [lindex $axi_types [expr {$i % [llength $axi_types]}]]
+		}
+		set name "[lindex $desc 0]_$i"
+		lappend design(ips,$bus) $name
+		lappend periphs [list $name $bus $desc]
+	}
+	place design axi4lite_0 $periph_base
+
+	set out "# Synthesized design with $count peripherals\n"
+	append out "[list version 1]\n[list swver 14.4]\n[list processor microblaze_0]\n"
+	append out "[list os [list bootargs "" "console device" rs232_uart_1 timer axi_timer_sys main_memory ddr3 main_memory_bank 0]]\n"
+	append out "[list slave_periphs {}]\n"
+
+	set irqs {}
+	foreach periph $periphs {
+		set name [lindex $periph 0]
+		lappend irqs "irq_$name"
+	}
+	lappend irqs uart_irq timer_irq
+
+	append out [ip microblaze_0 microblaze [list \
+		{param HW_VER 8.40.a {}} {param C_FAMILY kintex7 {}} \
+		{param C_CACHE_BYTE_SIZE 16384 {}} {param C_ICACHE_LINE_LEN 8 {}} \
+		{param C_ICACHE_BASEADDR 0x80000000 {}} {param C_ICACHE_HIGHADDR 0xbfffffff {}} \
+		{param C_DCACHE_BYTE_SIZE 16384 {}} {param C_DCACHE_LINE_LEN 8 {}} \
+		{param C_DCACHE_BASEADDR 0x80000000 {}} {param C_DCACHE_HIGHADDR 0xbfffffff {}} \
+		{param C_USE_BARREL 1 {}} {param C_USE_DIVIDER 1 {}} {param C_USE_HW_MUL 2 {}} \
+		{param C_USE_FPU 0 {}} {param C_USE_MMU 3 {}} {param C_ENDIANNESS 1 {}} \
+		{param C_PVR 2 {}} {param C_D_AXI 1 {}} {param C_DEBUG_ENABLED 1 {}} \
+		[clock_port CLK] \
+		{port Interrupt mb_irq {SIGIS INTERRUPT SENSITIVITY LEVEL_HIGH DIR I}} \
+		{busif M_AXI_DP axi4lite_0 MASTER} {busif M_AXI_DC axi4_0 MASTER} \
+		{busif M_AXI_IC axi4_0 MASTER}]]
+	append out [ip clk_gen clock_generator [list {param HW_VER 4.03.a {}} \
+		{port CLKOUT0 clk_100 {SIGIS CLK CLK_FREQ_HZ 100000000 DIR O}}]]
+	append out [ip axi4_0 axi_interconnect [list {param HW_VER 1.06.a {}}]]
+	append out [ip ddr3 axi_7series_ddrx [list {param HW_VER 1.09.a {}} \
+		{param C_S_AXI_BASEADDR 0x80000000 {ADDRESS BASE PAIR C_S_AXI_HIGHADDR}} \
+		{param C_S_AXI_HIGHADDR 0xbfffffff {}} {busif S_AXI axi4_0 SLAVE}]]
+	append out [ip microblaze_0_intc axi_intc [list {param HW_VER 1.04.a {}} \
+		{param C_BASEADDR 0x41200000 {ADDRESS BASE PAIR C_HIGHADDR}} {param C_HIGHADDR 0x4120ffff {}} \
+		[list param C_NUM_INTR_INPUTS [llength $irqs] {}] {param C_KIND_OF_INTR 0xffffffff {}} \
+		[list port INTR [join $irqs " & "] {SIGIS INTERRUPT SENSITIVITY LEVEL_HIGH DIR I}] \
+		{port IRQ mb_irq {SIGIS INTERRUPT SENSITIVITY LEVEL_HIGH DIR O}} \
+		[clock_port S_AXI_ACLK] {busif S_AXI axi4lite_0 SLAVE}]]
+	append out [ip rs232_uart_1 axi_uartlite [list {param HW_VER 1.02.a {}} \
+		{param C_BASEADDR 0x40600000 {ADDRESS BASE PAIR C_HIGHADDR}} {param C_HIGHADDR 0x4060ffff {}} \
+		{param C_BAUDRATE 115200 {}} {param C_DATA_BITS 8 {}} {param C_USE_PARITY 0 {}} {param C_ODD_PARITY 0 {}} \
+		{port Interrupt uart_irq {SIGIS INTERRUPT SENSITIVITY EDGE_RISING DIR O}} \
+		[clock_port S_AXI_ACLK] {busif S_AXI axi4lite_0 SLAVE}]]
+	append out [ip axi_timer_sys axi_timer [list {param HW_VER 1.03.a {}} \
+		{param C_BASEADDR 0x41c00000 {ADDRESS BASE PAIR C_HIGHADDR}} {param C_HIGHADDR 0x41c0ffff {}} \
+		{param C_COUNT_WIDTH 32 {}} {param C_ONE_TIMER_ONLY 0 {}} \
+		{port Interrupt timer_irq {SIGIS INTERRUPT SENSITIVITY EDGE_RISING DIR O}} \
+		[clock_port S_AXI_ACLK] {busif S_AXI axi4lite_0 SLAVE}]]
+
+	# Interconnects and bridges
+	set bridge 0
+	foreach bus $design(buses) {
+		if {$design(kind,$bus) == "plb"} {
+			append out [ip $bus plb_v46 [list {param HW_VER 1.05.a {}}]]
+		} else {
+			append out [ip $bus axi_interconnect [list {param HW_VER 1.06.a {}}]]
+		}
+		set parent $design(parent,$bus)
+		if {$parent == ""} {
+			continue
+		}
+		set base [hex $design(base,$bus)]
+		set high [hex $design(high,$bus)]
+		if {$design(kind,$bus) == "plb"} {
+			append out [ip "bridge_$bridge" axi_plbv46_bridge [list {param HW_VER 2.02.a {}} \
+				{param C_S_AXI_NUM_ADDR_RANGES 1 {}} \
+				[list param C_S_AXI_RNG1_BASEADDR $base {ADDRESS BASE PAIR C_S_AXI_RNG1_HIGHADDR}] \
+				[list param C_S_AXI_RNG1_HIGHADDR $high {}] \
+				[list busif S_AXI $parent SLAVE] [list busif MPLB $bus MASTER]]]
+		} else {
+			append out [ip "bridge_$bridge" axi2axi_connector [list {param HW_VER 1.00.a {}} \
+				{param C_S_AXI_NUM_ADDR_RANGES 1 {}} \
+				[list param C_S_AXI_RNG00_BASEADDR $base {ADDRESS BASE PAIR C_S_AXI_RNG00_HIGHADDR}] \
+				[list param C_S_AXI_RNG00_HIGHADDR $high {}] \
+				[list busif S_AXI $parent SLAVE] [list busif M_AXI $bus MASTER]]]
+		}
+		incr bridge
+	}
+
+	# Peripherals
+	array set cursor {}
+	foreach periph $periphs {
+		set name [lindex $periph 0]
+		set bus [lindex $periph 1]
+		set desc [lindex $periph 2]
+		if {![info exists cursor($bus)]} {
+			set cursor($bus) $design(base,$bus)
+		}
+		set base $cursor($bus)
+		set cursor($bus) [expr {$base + $periph_size}]
+		if {$design(kind,$bus) == "plb"} {
+			set busif SPLB
+		} else {
+			set busif S_AXI
+		}
+		set body [list [list param HW_VER [lindex $desc 1] {}] \
+			[list param C_BASEADDR [hex $base] {ADDRESS BASE PAIR C_HIGHADDR}] \
+			[list param C_HIGHADDR [hex [expr {$base + $periph_size - 1}]] {}]]
+		foreach {param value} [lindex $desc 5] {
+			lappend body [list param $param $value {}]
+		}
+		lappend body [list port [lindex $desc 2] "irq_$name" [list SIGIS INTERRUPT SENSITIVITY [lindex $desc 3] DIR O]]
+		lappend body [clock_port [lindex $desc 4]]
+		lappend body [list busif $busif $bus SLAVE]
+		append out [ip $name [lindex $desc 0] $body]
+	}
+
+	set fd [open $filepath w]
+	puts -nonewline $fd $out
+	close $fd
+	return [llength $design(buses)]
+}
+
+# Generate filepath from hardware description design, returns microseconds
+proc ::bench::generate {design filepath profile} {
+	::offline::load $design
+	::offline::set_os_parameters [list "profile=$profile"]
+	set start [profile_clock]
+	with_generator_context [list generate_os [::offline::handle os] $filepath]
+	return [expr {[profile_clock] - $start}]
+}
+
+# Phase rows of the profile CSV written next to filepath
+proc ::bench::phases {filepath} {
+	set fd [open "[file rootname $filepath].profile.csv" r]
+	set lines [split [read $fd] "\n"]
+	close $fd
+	set rows {}
+	foreach line [lrange $lines 1 end] {
+		set fields [split $line ","]
+		if {[lindex $fields 0] == "phase"} {
+			lappend rows [lrange $fields 1 3]
+		}
+	}
+	return $rows
+}
+
+# Content of a device tree without the lines which change between runs
+proc ::bench::stable_content {filepath} {
+	set fd [open $filepath r]
+	set content [read $fd]
+	close $fd
+	set out {}
+	foreach line [split $content "\n"] {
+		if {[string match " \\* Today is:*" $line] || [string match " \\* XPS project directory:*" $line]} {
+			continue
+		}
+		lappend out $line
+	}
+	return [join $out "\n"]
+}
+
+proc ::bench::main {argv} {
+	variable data_dir
+
+	array set opt {-sizes {10 100 1000 5000} -levels 3 -fanout 2 -out bench_out -baseline "" -phases 1}
+	foreach {name value} $argv {
+		if {![info exists opt($name)]} {
+			puts stderr "Unknown option $name, expected one of [lsort [array names opt]]"
+			exit 1
+		}
+		set opt($name) $value
+	}
+	file mkdir $opt(-out)
+
+	uplevel #0 [list source [file join $data_dir device-tree_offline.tcl]]
+	uplevel #0 [list source [file join $data_dir device-tree_v2_1_0.tcl]]
+	# Only warnings, the clock and IP summaries would dominate the time
+	set ::debug_level {warning}
+
+	# The generator prints some progress itself, report after all runs
+	set failed 0
+	set report [list [format "%8s %6s %12s" "IPs" "buses" "usec"]]
+	foreach size $opt(-sizes) {
+		set design [file join $opt(-out) "bench_$size.hw"]
+		set dts [file join $opt(-out) "bench_$size.dts"]
+		set buses [synthesize $size $opt(-levels) $opt(-fanout) $design]
+		set usec [generate $design $dts false]
+		lappend report [format "%8d %6d %12d" $size $buses $usec]
+		if {$opt(-phases)} {
+			generate $design $dts true
+			foreach row [phases $dts] {
+				lappend report [format "%16s %-16s %6d calls %12d usec" "" [lindex $row 0] [lindex $row 1] [lindex $row 2]]
+			}
+		}
+		if {$opt(-baseline) != ""} {
+			set reference [file join $opt(-baseline) "bench_$size.dts"]
+			if {![file exists $reference]} {
+				lappend report "    no baseline $reference"
+			} elseif {[stable_content $reference] != [stable_content $dts]} {
+				lappend report "    DIFFERS from $reference"
+				set failed 1
+			} else {
+				lappend report "    identical to $reference"
+			}
+		}
+	}
+	puts [join $report "\n"]
+	exit $failed
+}
+
+::bench::main $argv
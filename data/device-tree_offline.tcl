@@ -0,0 +1,438 @@
+#
+# Offline backend of the device tree generator
+#
+# Implements the libgen xget_* API over a hardware description written
+# by export_hw_design (hw_export OS parameter), so device trees can be
+# generated in a plain tclsh without EDK:
+#
+#   tclsh device-tree_offline.tcl <hardware description> [<output>] [<OS parameter>=<value> ...]
+#
+# OS parameters given on the command line replace the exported ones.
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License as
+# published by the Free Software Foundation; either version 2 of
+# the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+# MA 02111-1307 USA
+
+namespace eval ::offline {
+	# Loaded hardware description
+	# hw(ips) - IP names in MHS order
+	# hw(ip,$ip) - IP type
+	# hw(params,$ip), hw(ports,$ip), hw(busifs,$ip) - names of the IP's
+	# parameters, ports and bus interfaces
+	# hw(param,$ip,$name) - {value subproperties}
+	# hw(port,$ip,$name) - {net subproperties}
+	# hw(busif,$ip,$name) - {bus role}
+	# hw(portname,$ip,$NAME) - port name with original case
+	variable hw
+	array set hw {}
+	variable supported_version 1
+}
+
+# Handles are <kind>:<IP name>[:<name>], kind one of
+# mhs, os, proc, ip, param, port, busif
+proc ::offline::handle {kind {ip ""} {name ""}} {
+	if {$name != ""} {
+		return "$kind:$ip:$name"
+	}
+	if {$ip != ""} {
+		return "$kind:$ip"
+	}
+	return $kind
+}
+
+proc ::offline::split_handle {handle} {
+	return [split $handle ":"]
+}
+
+proc ::offline::load {filepath} {
+	variable hw
+	variable supported_version
+
+	set fd [open $filepath r]
+	set content [read $fd]
+	close $fd
+
+	# Remove comment lines, the rest is a Tcl list
+	set data {}
+	foreach line [split $content "\n"] {
+		if {![string match "#*" $line]} {
+			append data "$line\n"
+		}
+	}
+
+	array unset hw
+	array set hw {}
+	set hw(ips) {}
+	set hw(os) {}
+	set hw(swver) ""
+	set hw(slave_periphs) {}
+	set hw(version) ""
+	set count [llength $data]
+	for {set i 0} {$i < $count} {incr i} {
+		set key [lindex $data $i]
+		switch -exact -- $key {
+			"version" -
+			"swver" -
+			"processor" -
+			"os" -
+			"slave_periphs" {
+				set hw($key) [lindex $data [incr i]]
+			}
+			"ip" {
+				set name [lindex $data [incr i]]
+				set type [lindex $data [incr i]]
+				load_ip $name $type [lindex $data [incr i]]
+			}
+			default {
+				error "Unknown entry $key in $filepath"
+			}
+		}
+	}
+	if {$hw(version) != $supported_version} {
+		error "$filepath: unsupported hardware description version $hw(version)"
+	}
+	if {![info exists hw(processor)] || ![info exists hw(ip,$hw(processor))]} {
+		error "$filepath: no processor"
+	}
+}
+
+proc ::offline::load_ip {ip type body} {
+	variable hw
+
+	lappend hw(ips) $ip
+	set hw(ip,$ip) $type
+	set hw(params,$ip) {}
+	set hw(ports,$ip) {}
+	set hw(busifs,$ip) {}
+	foreach entry [split $body "\n"] {
+		if {[llength $entry] == 0} {
+			continue
+		}
+		set name [lindex $entry 1]
+		switch -exact -- [lindex $entry 0] {
+			"param" {
+				lappend hw(params,$ip) $name
+				set hw(param,$ip,$name) [lrange $entry 2 3]
+			}
+			"port" {
+				lappend hw(ports,$ip) $name
+				set hw(port,$ip,$name) [lrange $entry 2 3]
+				set hw(portname,$ip,[string toupper $name]) $name
+			}
+			"busif" {
+				lappend hw(busifs,$ip) $name
+				set hw(busif,$ip,$name) [lrange $entry 2 3]
+			}
+			default {
+				error "Unknown entry $entry of $ip"
+			}
+		}
+	}
+}
+
+# Replace OS parameters, arguments are <name>=<value>
+proc ::offline::set_os_parameters {assignments} {
+	variable hw
+
+	array set os $hw(os)
+	foreach assignment $assignments {
+		set index [string first "=" $assignment]
+		if {$index < 1} {
+			error "Bad OS parameter $assignment, expected <name>=<value>"
+		}
+		set os([string range $assignment 0 [expr {$index - 1}]]) [string range $assignment [expr {$index + 1}] end]
+	}
+	set hw(os) [array get os]
+}
+
+# Children of kind of ip, all with name "*"
+proc ::offline::children {kind list ip name} {
+	variable hw
+
+	if {$name == "*"} {
+		set handles {}
+		foreach child $hw($list,$ip) {
+			lappend handles [handle $kind $ip $child]
+		}
+		return $handles
+	}
+	if {[info exists hw($kind,$ip,$name)]} {
+		return [handle $kind $ip $name]
+	}
+	return ""
+}
+
+proc ::offline::port_name {ip name} {
+	variable hw
+
+	if {[info exists hw(portname,$ip,[string toupper $name])]} {
+		return $hw(portname,$ip,[string toupper $name])
+	}
+	return $name
+}
+
+# libgen API
+
+proc xget_swverandbld {} {
+	return $::offline::hw(swver)
+}
+
+proc xget_libgen_proc_handle {} {
+	return [::offline::handle proc $::offline::hw(processor)]
+}
+
+proc xget_handle {handle kind} {
+	return [::offline::handle ip [lindex [::offline::split_handle $handle] 1]]
+}
+
+proc xget_sw_ipinst_handle_from_processor {proc_handle name} {
+	if {[info exists ::offline::hw(ip,$name)]} {
+		return [::offline::handle ip $name]
+	}
+	return ""
+}
+
+# Software parameters of IPs are not exported, their hardware values are used
+proc xget_sw_parameter_value {handle name} {
+	upvar #0 ::offline::hw hw
+
+	set parts [::offline::split_handle $handle]
+	if {[lindex $parts 0] == "os"} {
+		array set os $hw(os)
+		if {[info exists os($name)]} {
+			return $os($name)
+		}
+		return ""
+	}
+	return [xget_hw_parameter_value $handle $name]
+}
+
+proc xget_value {handle args} {
+	upvar #0 ::offline::hw hw
+
+	set ip [lindex [::offline::split_handle $handle] 1]
+	switch -exact -- [string toupper [lindex $args 0]] {
+		"VALUE" {
+			return [xget_hw_value $handle]
+		}
+		"NAME" {
+			return [xget_hw_name $handle]
+		}
+		"OPTION" {
+			# IPNAME
+			return $hw(ip,$ip)
+		}
+		"PORT" {
+			return [xget_hw_port_value $handle [lindex $args 1]]
+		}
+	}
+	error "xget_value $handle $args is not supported offline"
+}
+
+proc xget_hw_name {handle} {
+	set parts [::offline::split_handle $handle]
+	switch -exact -- [lindex $parts 0] {
+		"proc" -
+		"ip" {
+			return [lindex $parts 1]
+		}
+		"param" -
+		"port" -
+		"busif" {
+			return [lindex $parts 2]
+		}
+	}
+	return ""
+}
+
+proc xget_hw_value {handle} {
+	upvar #0 ::offline::hw hw
+
+	set parts [::offline::split_handle $handle]
+	set kind [lindex $parts 0]
+	set ip [lindex $parts 1]
+	switch -exact -- $kind {
+		"proc" -
+		"ip" {
+			return $hw(ip,$ip)
+		}
+		"param" -
+		"port" -
+		"busif" {
+			return [lindex $hw($kind,$ip,[lindex $parts 2]) 0]
+		}
+	}
+	return ""
+}
+
+proc xget_hw_parent_handle {handle} {
+	set parts [::offline::split_handle $handle]
+	switch -exact -- [lindex $parts 0] {
+		"proc" -
+		"ip" {
+			return [::offline::handle mhs]
+		}
+		"param" -
+		"port" -
+		"busif" {
+			return [::offline::handle ip [lindex $parts 1]]
+		}
+	}
+	return ""
+}
+
+proc xget_hw_ipinst_handle {mhs_handle name} {
+	upvar #0 ::offline::hw hw
+
+	if {$name == "*"} {
+		set handles {}
+		foreach ip $hw(ips) {
+			lappend handles [::offline::handle ip $ip]
+		}
+		return $handles
+	}
+	if {[info exists hw(ip,$name)]} {
+		return [::offline::handle ip $name]
+	}
+	return ""
+}
+
+proc xget_hw_parameter_handle {handle name} {
+	return [::offline::children param params [lindex [::offline::split_handle $handle] 1] $name]
+}
+
+proc xget_hw_parameter_value {handle name} {
+	upvar #0 ::offline::hw hw
+
+	set ip [lindex [::offline::split_handle $handle] 1]
+	if {[info exists hw(param,$ip,$name)]} {
+		return [lindex $hw(param,$ip,$name) 0]
+	}
+	return ""
+}
+
+proc xget_hw_port_handle {handle name} {
+	set ip [lindex [::offline::split_handle $handle] 1]
+	if {$name != "*"} {
+		set name [::offline::port_name $ip $name]
+	}
+	return [::offline::children port ports $ip $name]
+}
+
+proc xget_hw_port_value {handle name} {
+	upvar #0 ::offline::hw hw
+
+	set ip [lindex [::offline::split_handle $handle] 1]
+	set name [::offline::port_name $ip $name]
+	if {[info exists hw(port,$ip,$name)]} {
+		return [lindex $hw(port,$ip,$name) 0]
+	}
+	return ""
+}
+
+proc xget_hw_subproperty_value {handle name} {
+	upvar #0 ::offline::hw hw
+
+	set parts [::offline::split_handle $handle]
+	set kind [lindex $parts 0]
+	if {$kind != "param" && $kind != "port"} {
+		return ""
+	}
+	array set sub [lindex $hw($kind,[lindex $parts 1],[lindex $parts 2]) 1]
+	if {[info exists sub($name)]} {
+		return $sub($name)
+	}
+	return ""
+}
+
+proc xget_hw_busif_handle {handle name} {
+	return [::offline::children busif busifs [lindex [::offline::split_handle $handle] 1] $name]
+}
+
+proc xget_hw_busif_value {handle name} {
+	upvar #0 ::offline::hw hw
+
+	set ip [lindex [::offline::split_handle $handle] 1]
+	if {[info exists hw(busif,$ip,$name)]} {
+		return [lindex $hw(busif,$ip,$name) 0]
+	}
+	return ""
+}
+
+proc xget_hw_connected_busifs_handle {mhs_handle bus role} {
+	upvar #0 ::offline::hw hw
+
+	set role [string toupper $role]
+	set handles {}
+	foreach ip $hw(ips) {
+		foreach busif $hw(busifs,$ip) {
+			if {$hw(busif,$ip,$busif) == [list $bus $role]} {
+				lappend handles [::offline::handle busif $ip $busif]
+			}
+		}
+	}
+	return $handles
+}
+
+# Only "source" is used, the output port driving net
+proc xget_hw_connected_ports_handle {mhs_handle net dir} {
+	upvar #0 ::offline::hw hw
+
+	foreach ip $hw(ips) {
+		foreach port $hw(ports,$ip) {
+			if {[lindex $hw(port,$ip,$port) 0] != $net} {
+				continue
+			}
+			array unset sub
+			array set sub [lindex $hw(port,$ip,$port) 1]
+			if {[info exists sub(DIR)] && [string toupper $sub(DIR)] == "O"} {
+				return [::offline::handle port $ip $port]
+			}
+		}
+	}
+	return ""
+}
+
+proc xget_hw_proc_slave_periphs {handle} {
+	set handles {}
+	foreach ip $::offline::hw(slave_periphs) {
+		lappend handles [::offline::handle ip $ip]
+	}
+	return $handles
+}
+
+proc ::offline::main {argv} {
+	if {[llength $argv] < 1} {
+		puts stderr "usage: tclsh device-tree_offline.tcl <hardware description> \[<output>\] \[<OS parameter>=<value> ...\]"
+		exit 1
+	}
+	set filepath "xilinx.dts"
+	set assignments {}
+	foreach arg [lrange $argv 1 end] {
+		if {[string first "=" $arg] > 0} {
+			lappend assignments $arg
+		} else {
+			set filepath $arg
+		}
+	}
+	load [lindex $argv 0]
+	set_os_parameters $assignments
+
+	uplevel #0 [list source [file join [file dirname [info script]] device-tree_v2_1_0.tcl]]
+	uplevel #0 [list with_generator_context [list generate_os [handle os] $filepath]]
+}
+
+if {[info exists argv0] && [file tail [info script]] == [file tail $argv0]} {
+	::offline::main $argv
+}
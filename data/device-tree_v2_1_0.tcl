@@ -39,34 +39,106 @@ lappend debug_level [list "ip"]
 
 # Globals variable
 variable device_tree_generator_version "1.1"
-variable cpunumber 0
-variable periphery_array ""
-variable buses {}
-variable bus_count 0
-variable mac_count 0
-variable gpio_names {}
-variable overrides {}
-variable microblaze_system_timer ""
 
-variable serial_count 0
-variable sysace_count 0
-variable ethernet_count 0
-variable alias_node_list {}
-variable phy_count 0
+# Generation context
+# The counters, lists and OS parameters a run changes live in a context
+# array instead of namespace and global variables, so a run doesn't depend
+# on those left behind by another one. Procs link the entries they use with
+# context_var, which works like variable/global.
+# Runs are not re-entrant: the override index, hardware model, interrupt
+# controller tables, slave cache, param_file, handler and compatible
+# registries, clock nets, label index and DTB state are still namespace
+# variables which every run resets for itself, mostly in
+# reset_generator_state. Runs have to follow each other, a run must not be
+# started from inside another one.
+# generator_context - name of the context array of the current run
+# $ctx($name) - counters, lists and OS parameters of the run
+# $ctx(visited,$set,$key) - visited sets
+variable generator_context_count 0
+
+# Initial values of the context entries which are changed while generating,
+# reset_generator_state restores them at the start of every run
+# FIXME ps7_cortexa9_clk/ps7_cortexa9_1x_clk - it will be better not to use it
+variable generator_state_defaults {
+	cpunumber 0 bus_count 0 mac_count 0 gpio_names {}
+	microblaze_system_timer "" serial_count 0 sysace_count 0
+	ethernet_count 0 alias_node_list {} phy_count 0 vdma_device_id 0
+	dma_device_id 0 ps7_spi_count 0 ps7_i2c_count 0 ps7_cortexa9_clk 0
+	ps7_cortexa9_1x_clk 0 ps7_smcc_list {} axi_ifs "" cells_stack {}
+	address_map_entries {} processor_fingerprint ""
+	handler_file_types {} handler_file_content ""
+}
+
+proc generator_context_new {} {
+	variable generator_context_count
+	variable generator_state_defaults
+
+	incr generator_context_count
+	set ctx "[namespace current]::generator_context$generator_context_count"
+	upvar #0 $ctx context
+	array set context $generator_state_defaults
+	set context(simple_version) 0
+	set context(overrides) {}
+	return $ctx
+}
+
+# Make ctx the current context, returns the previous one
+proc generator_context_use {ctx} {
+	variable generator_context
+
+	set previous $generator_context
+	set generator_context $ctx
+	return $previous
+}
+
+proc generator_context_free {ctx} {
+	upvar #0 $ctx context
+
+	set previous [generator_context_use $ctx]
+	stream_abort
+	generator_context_use $previous
+	array unset context
+}
+
+# Evaluate script in the caller with a new current context
+proc with_generator_context {script} {
+	set ctx [generator_context_new]
+	set previous [generator_context_use $ctx]
+	set code [catch {uplevel 1 $script} result]
+	generator_context_use $previous
+	generator_context_free $ctx
+	if {$code == 1} {
+		global errorInfo errorCode
+		return -code error -errorinfo $errorInfo -errorcode $errorCode $result
+	}
+	return -code $code $result
+}
 
-variable vdma_device_id 0
-variable dma_device_id 0
+# Link entries of the current context to local variables of the caller
+proc context_var {args} {
+	variable generator_context
 
-variable ps7_spi_count 0
-variable ps7_i2c_count 0
+	foreach name $args {
+		uplevel 1 [list upvar #0 "${generator_context}($name)" $name]
+	}
+}
 
-# FIXME it will be better not to use it
-variable ps7_cortexa9_clk 0
-variable ps7_cortexa9_1x_clk 0
+# Context used by callers of generate_device_tree which don't create one
+variable generator_context ""
+generator_context_use [generator_context_new]
 
-variable ps7_smcc_list {}
+# Per-run cache of interrupt controller signal tables
+# intc_signal_cache($intc) - marks that the table for $intc is built
+# intc_signal_cache($intc,$signal) - irq number of $signal on $intc
+variable intc_signal_cache
+array set intc_signal_cache {}
 
-variable simple_version 0
+# Visited sets used while traversing the hardware, kept in the context
+# visited,$set,$key - $key was already seen in set $set
+# buses - bus names already generated
+# periphery - IP handles already generated
+# bus_ips - slave IP handles collected for the current bus
+# memory - memory controllers already scanned
 
 #
 # How to use generate_device_tree() from another MLD
@@ -115,61 +187,240 @@ proc device_tree_drc {os_handle} {
 }
 
 proc generate {os_handle} {
-	variable  device_tree_generator_version
-	variable simple_version
-
 	debug info "\#--------------------------------------"
 	debug info "\# device-tree BSP generate..."
 	debug info "\#--------------------------------------"
 
+	with_generator_context [list generate_os $os_handle "xilinx.dts"]
+}
+
+# Generate filepath from the parameters of OS os_handle
+proc generate_os {os_handle filepath} {
 	set bootargs [xget_sw_parameter_value $os_handle "bootargs"]
-	global consoleip
+	context_var consoleip
 	set consoleip [xget_sw_parameter_value $os_handle "stdout"]
 	if {[llength $consoleip] == 0} {
 		set consoleip [xget_sw_parameter_value $os_handle "console device"]
-		variable simple_version
+		context_var simple_version
 		set simple_version "1"
 	}
 
-	global overrides
+	context_var overrides
 	set overrides [xget_sw_parameter_value $os_handle "periph_type_overrides"]
 	# Format override string to list format
 	set overrides [string map { "\}\{" "\} \{" } $overrides]
 	edk_override_update
 
-	global main_memory
+	context_var main_memory
 	set main_memory [xget_sw_parameter_value $os_handle "main_memory"]
-	global main_memory_bank
+	context_var main_memory_bank
 	set main_memory_bank [xget_sw_parameter_value $os_handle "main_memory_bank"]
 	if {[llength $main_memory_bank] == 0} {
 		set main_memory_bank 0
 	}
-	global main_memory_start
+	context_var main_memory_start
 	set main_memory_start [xget_sw_parameter_value $os_handle "main_memory_start"]
-	global main_memory_size
+	context_var main_memory_size
 	set main_memory_size [xget_sw_parameter_value $os_handle "main_memory_size"]
-	global main_memory_offset
+	context_var main_memory_offset
 	set main_memory_offset [xget_sw_parameter_value $os_handle "main_memory_offset"]
-	global flash_memory
+	context_var memory_layout
+	set memory_layout [xget_sw_parameter_value $os_handle "memory_layout"]
+	context_var sram_nodes
+	set sram_nodes [xget_sw_parameter_value $os_handle "sram_nodes"]
+	context_var clock_nodes
+	set clock_nodes [xget_sw_parameter_value $os_handle "clock_nodes"]
+	context_var flash_memory
 	set flash_memory [xget_sw_parameter_value $os_handle "flash_memory"]
-	global flash_memory_bank
+	context_var flash_memory_bank
 	set flash_memory_bank [xget_sw_parameter_value $os_handle "flash_memory_bank"]
-	global timer
+	context_var timer
 	set timer [xget_sw_parameter_value $os_handle "timer"]
+	context_var dtb_output
+	set dtb_output [xget_sw_parameter_value $os_handle "dtb_output"]
+	context_var incremental
+	set incremental [xget_sw_parameter_value $os_handle "incremental"]
+	context_var handler_file
+	set handler_file [xget_sw_parameter_value $os_handle "handler_file"]
+	context_var compatible_file
+	set compatible_file [xget_sw_parameter_value $os_handle "compatible_file"]
+	context_var param_emission
+	set param_emission [xget_sw_parameter_value $os_handle "param_emission"]
+	context_var address_cells size_cells
+	set address_cells [xget_sw_parameter_value $os_handle "address_cells"]
+	set size_cells [xget_sw_parameter_value $os_handle "size_cells"]
+	context_var profile
+	set profile [xget_sw_parameter_value $os_handle "profile"]
+	context_var streaming
+	set streaming [xget_sw_parameter_value $os_handle "streaming"]
+	context_var overlay
+	set overlay [xget_sw_parameter_value $os_handle "overlay"]
+	context_var flatten_buses
+	set flatten_buses [xget_sw_parameter_value $os_handle "flatten_buses"]
 
 	if { "$simple_version" == "1" } {
 		set main_memory_start -1
 		set main_memory_size 0
 	}
 
-	global buses
-	set buses {}
+	set hw_export [xget_sw_parameter_value $os_handle "hw_export"]
+	if {[llength $hw_export] != 0} {
+		export_hw_design $os_handle $hw_export
+	}
+
+	generate_device_tree $filepath $bootargs $consoleip
+}
+
+# Hardware description export
+# Writes everything the generator reads through the xget_* API to a file,
+# which device-tree_offline.tcl loads to generate device trees in tclsh
+# without libgen. The file is a Tcl list:
+#   version <n>
+#   swver <EDK version>
+#   processor <IP name>
+#   os {<OS parameter> <value> ...}
+#   slave_periphs {<IP name> ...}
+#   ip <IP name> <IP type> {
+#       param <name> <value> {<subproperty> <value> ...}
+#       port <name> <net> {<subproperty> <value> ...}
+#       busif <name> <bus> <role>
+#   }
+variable hw_export_version 1
+variable hw_export_os_parameters {bootargs stdout "console device"
+	periph_type_overrides main_memory main_memory_bank main_memory_start
+	main_memory_size main_memory_offset memory_layout sram_nodes flash_memory
+	flash_memory_bank timer dtb_output incremental handler_file
+	compatible_file param_emission address_cells size_cells profile
+	streaming clock_nodes overlay flatten_buses}
+variable hw_export_port_subproperties {SIGIS SENSITIVITY CLK_FREQ_HZ DIR CLK_INPORT CLK_FACTOR}
+variable hw_export_param_subproperties {ADDRESS PAIR}
+variable hw_export_busif_roles {master slave target initiator}
+
+proc hw_export_subproperties {handle names} {
+	set sub {}
+	foreach name $names {
+		set value [xget_hw_subproperty_value $handle $name]
+		if {[llength $value] != 0} {
+			lappend sub $name $value
+		}
+	}
+	return $sub
+}
+
+proc export_hw_design {os_handle filepath} {
+	variable hw_export_version
+	variable device_tree_generator_version
+	variable hw_export_os_parameters
+	variable hw_export_port_subproperties
+	variable hw_export_param_subproperties
+	variable hw_export_busif_roles
+
+	set proc_handle [xget_libgen_proc_handle]
+	set hwproc_handle [xget_handle $proc_handle "IPINST"]
+	set mhs_handle [xget_hw_parent_handle $hwproc_handle]
+	set ips [xget_hw_ipinst_handle $mhs_handle "*"]
+
+	set out "# Hardware description written by device tree generator $device_tree_generator_version\n"
+	append out "[list version $hw_export_version]\n"
+	append out "[list swver [xget_swverandbld]]\n"
+	append out "[list processor [xget_hw_name $hwproc_handle]]\n"
+	set os {}
+	foreach name $hw_export_os_parameters {
+		lappend os $name [xget_sw_parameter_value $os_handle $name]
+	}
+	append out "[list os $os]\n"
+	set periphs {}
+	foreach ip [xget_hw_proc_slave_periphs $hwproc_handle] {
+		lappend periphs [xget_hw_name $ip]
+	}
+	append out "[list slave_periphs $periphs]\n"
+
+	# The API has no bus interface role, ask every bus for its peers
+	array set roles {}
+	array set buses {}
+	foreach ip $ips {
+		foreach busif [xget_hw_busif_handle $ip "*"] {
+			set bus [xget_hw_value $busif]
+			if {[llength $bus] == 0 || [info exists buses($bus)]} {
+				continue
+			}
+			set buses($bus) 1
+			foreach role $hw_export_busif_roles {
+				foreach peer [xget_hw_connected_busifs_handle $mhs_handle $bus $role] {
+					set roles($peer) [string toupper $role]
+				}
+			}
+		}
+	}
+
+	foreach ip $ips {
+		append out "[list ip [xget_hw_name $ip] [xget_hw_value $ip]] \{\n"
+		foreach par [xget_hw_parameter_handle $ip "*"] {
+			append out "\t[list param [xget_hw_name $par] [xget_hw_value $par] [hw_export_subproperties $par $hw_export_param_subproperties]]\n"
+		}
+		foreach port [xget_hw_port_handle $ip "*"] {
+			append out "\t[list port [xget_hw_name $port] [xget_hw_value $port] [hw_export_subproperties $port $hw_export_port_subproperties]]\n"
+		}
+		foreach busif [xget_hw_busif_handle $ip "*"] {
+			set role ""
+			if {[info exists roles($busif)]} {
+				set role $roles($busif)
+			}
+			append out "\t[list busif [xget_hw_name $busif] [xget_hw_value $busif] $role]\n"
+		}
+		append out "\}\n"
+	}
+	write_file_atomic $filepath $out
+	debug info "Hardware description written to $filepath"
+}
+
+# Generate several device trees in one session
+# jobs: list of {os_handle filepath ?setup?}, setup is a script evaluated
+# at global level before the job, e.g. to switch the hardware description
+# All jobs are run even if some fail; the failed ones are reported at the end.
+proc generate_device_tree_batch {jobs} {
+	set failed {}
+	foreach job $jobs {
+		set os_handle [lindex $job 0]
+		set filepath [lindex $job 1]
+		set setup [lindex $job 2]
+		if {[catch {
+			if {$setup != ""} {
+				uplevel #0 $setup
+			}
+			with_generator_context [list generate_os $os_handle $filepath]
+		} error]} {
+			debug warning "ERROR: $filepath: $error"
+			lappend failed $filepath
+		}
+	}
+	if {[llength $failed] != 0} {
+		error "Device tree generation failed for: $failed"
+	}
+}
+
+# Reset all the state a previous run may have left behind, also the
+# namespace state, so it must not be called while another run is going on
+proc reset_generator_state {} {
+	variable generator_state_defaults
+
+	foreach {name value} $generator_state_defaults {
+		context_var $name
+		set $name $value
+	}
 
-	generate_device_tree "xilinx.dts" $bootargs $consoleip
+	clear_intc_signal_cache
+	clear_param_file
+	clear_registered_handlers
+	clear_registered_compatibles
+	profile_stop
+	visited_clear
+	tree_index_clear
+	hw_snapshot_clear
 }
 
 proc edk_override_update {} {
-	global overrides
+	context_var overrides
 
 	# FIXME - Xilinx 14.2 changed the TCL API and IP names are returned
 	# lowercase.  Must lowercase the override string to match
@@ -189,57 +440,541 @@ proc edk_override_update {} {
 	}
 }
 
+# Overrides are compiled once per run into override_index, so consumers
+# don't rescan the whole list for every node. IP names which are glob
+# patterns are kept in ordered lists and have to be matched.
+# override_index($kind) - overrides of $kind in the original order
+# override_index(ignore,$name) - "ip -ignore" for IP $name
+# override_index(compatible,$name) - first "compatible" override for IP
+#     $name: {order mode compatible_list}, mode is -append or -replace
+# override_index(dts,$name) - "dts" overrides of node: {{param type value}...}
+# override_index(phy,$name) - "phy" override of IP $name: {phy_addr compatible}
+# override_index(cells,$name) - "cells" override of bus $name: {address_cells size_cells}
+# override_index(params,$type) - "params" emission policy of IP type $type
+# override_index(irq) - "irq" affinity and priority overrides, see override_irq
+# override_index(ignore|compatible,patterns) - entries with glob patterns
+variable override_index
+array set override_index {}
+
+# Number of elements of each override kind, exact if positive, a minimum
+# if negative
+variable override_arity
+array set override_arity {ip 3 dts 5 compatible -3 led 5 hard-reset-gpios 4 phy 4 cells 4 params 3 irq -4}
+
+proc override_is_pattern {name} {
+	return [regexp {[][*?\\]} $name]
+}
+
+proc compile_overrides {} {
+	context_var overrides
+	variable override_index
+	variable override_arity
+
+	array unset override_index
+	array set override_index {}
+	set override_index(ignore,patterns) {}
+	set override_index(compatible,patterns) {}
+	if {![info exists overrides]} {
+		return
+	}
+	set order 0
+	foreach over $overrides {
+		set kind [lindex $over 0]
+		if {[info exists override_arity($kind)]} {
+			set arity $override_arity($kind)
+			if {($arity > 0 && [llength $over] != $arity) || ($arity < 0 && [llength $over] < -$arity)} {
+				error "Wrong $kind override command string - $over"
+			}
+		} else {
+			debug warning "Warning!: Unknown override $over"
+		}
+		lappend override_index($kind) $over
+
+		switch -exact $kind {
+			"ip" {
+				# Command: "ip -ignore <IP name>"
+				if { [string match [lindex $over 1] "-ignore"] } {
+					set name [lindex $over 2]
+					if {[override_is_pattern $name]} {
+						lappend override_index(ignore,patterns) $name
+					} else {
+						set override_index(ignore,$name) 1
+					}
+				}
+			}
+			"compatible" {
+				# Command: "compatible -replace/-append <IP name> <compatible list>"
+				# or: "compatible <IP name> <compatible list>" where replace is used
+				set mode [lindex $over 1]
+				if {$mode == "-append" || $mode == "-replace"} {
+					set name [lindex $over 2]
+					set clist [lrange $over 3 end]
+				} else {
+					set mode "-replace"
+					set name [lindex $over 1]
+					set clist [lrange $over 2 end]
+				}
+				if {[override_is_pattern $name]} {
+					lappend override_index(compatible,patterns) [list $name $order $mode $clist]
+				} elseif {![info exists override_index(compatible,$name)]} {
+					set override_index(compatible,$name) [list $order $mode $clist]
+				}
+			}
+			"dts" {
+				# Command: "dts <IP name> <parameter> <value type> <value>"
+				lappend override_index(dts,[lindex $over 1]) [lrange $over 2 4]
+			}
+			"phy" {
+				# Command: "phy <IP name> <phy addr> <compatible>"
+				set override_index(phy,[lindex $over 1]) [lrange $over 2 3]
+			}
+			"cells" {
+				# Command: "cells <bus name> <address cells> <size cells>"
+				set cells [lrange $over 2 3]
+				if {![cells_valid $cells]} {
+					error "Wrong cells override command string - $over"
+				}
+				set override_index(cells,[lindex $over 1]) $cells
+			}
+			"params" {
+				# Command: "params <IP type> default|minimal"
+				set policy [lindex $over 2]
+				if {$policy != "default" && $policy != "minimal"} {
+					error "Wrong params override command string - $over"
+				}
+				set override_index(params,[lindex $over 1]) $policy
+			}
+			"irq" {
+				# Command: "irq <IP name> affinity|priority <value>..."
+				set setting [lindex $over 2]
+				if {$setting != "affinity" && $setting != "priority"} {
+					error "Wrong irq override command string - $over"
+				}
+				if {$setting == "priority"} {
+					foreach value [lrange $over 3 end] {
+						if {![string is integer -strict $value] || $value < 0 || $value > 255} {
+							error "Wrong irq override command string - $over"
+						}
+					}
+				}
+			}
+		}
+		incr order
+	}
+}
+
+# Return list of overrides of one kind
+proc override_list {kind} {
+	variable override_index
+
+	if {[info exists override_index($kind)]} {
+		return $override_index($kind)
+	}
+	return {}
+}
+
+proc override_ignored {name} {
+	variable override_index
+
+	if {[info exists override_index(ignore,$name)]} {
+		return 1
+	}
+	foreach pattern $override_index(ignore,patterns) {
+		if {[string match $pattern $name]} {
+			return 1
+		}
+	}
+	return 0
+}
+
+# Return {mode compatible_list} of the first compatible override for name
+proc override_compatible {name} {
+	variable override_index
+
+	set found {}
+	set order -1
+	if {[info exists override_index(compatible,$name)]} {
+		set found [lrange $override_index(compatible,$name) 1 2]
+		set order [lindex $override_index(compatible,$name) 0]
+	}
+	foreach entry $override_index(compatible,patterns) {
+		if {$order >= 0 && [lindex $entry 1] > $order} {
+			break
+		}
+		if {[string match [lindex $entry 0] $name]} {
+			return [lrange $entry 2 3]
+		}
+	}
+	return $found
+}
+
+# Hardware snapshot
+# The whole MHS is walked once at the start of generate_device_tree and
+# every IP with its parameters, ports and bus interfaces is recorded in
+# hw_model. The hw_* procs below mirror the xget_hw_* API and read from
+# the snapshot. Handles which are not part of the snapshot fall back to
+# xget_hw_* and the result is remembered for the rest of the run.
+#
+# hw_model(mhs) - mhs handle the snapshot was taken from
+# hw_model(ips) - all IP handles
+# hw_model(inst,$name) - IP handle by lowercase instance name
+# hw_model(name,$h), hw_model(value,$h), hw_model(parent,$h) - any handle
+# hw_model(params,$ip), hw_model(ports,$ip), hw_model(busifs,$ip) - handle lists
+# hw_model(param|port|busif,$ip,$NAME) - handle by uppercase name
+# hw_model(sub,$h,$prop) - subproperty value
+# hw_model(net,$net) - bus interface handles connected to $net
+# hw_model(type,$type) - IP handles of lowercase IP type in MHS order
+# hw_model(order,$ip) - position of IP in the MHS
+# hw_model(clkports) - {ip port} of all ports with SIGIS = CLK
+variable hw_model
+array set hw_model {}
+
+proc hw_snapshot_clear {} {
+	variable hw_model
+	variable int_param_cache
+
+	array unset hw_model
+	array set hw_model {}
+	array unset int_param_cache
+	array set int_param_cache {}
+}
+
+proc hw_snapshot {mhs_handle} {
+	variable hw_model
+
+	hw_snapshot_clear
+	set ips [xget_hw_ipinst_handle $mhs_handle "*"]
+	set hw_model(mhs) $mhs_handle
+	set hw_model(ips) $ips
+	set hw_model(clkports) {}
+	set order 0
+	foreach ip $ips {
+		set name [xget_hw_name $ip]
+		set hw_model(name,$ip) $name
+		set hw_model(value,$ip) [xget_hw_value $ip]
+		set hw_model(parent,$ip) $mhs_handle
+		set hw_model(inst,[string tolower $name]) $ip
+		lappend hw_model(type,[string tolower $hw_model(value,$ip)]) $ip
+		set hw_model(order,$ip) $order
+		incr order
+
+		set hw_model(params,$ip) [xget_hw_parameter_handle $ip "*"]
+		foreach par $hw_model(params,$ip) {
+			hw_snapshot_handle $ip $par param
+		}
+
+		set hw_model(ports,$ip) [xget_hw_port_handle $ip "*"]
+		foreach port $hw_model(ports,$ip) {
+			hw_snapshot_handle $ip $port port
+			foreach prop "SIGIS SENSITIVITY CLK_FREQ_HZ DIR" {
+				set hw_model(sub,$port,$prop) [xget_hw_subproperty_value $port $prop]
+			}
+			if {[string toupper $hw_model(sub,$port,SIGIS)] == "CLK"} {
+				lappend hw_model(clkports) [list $ip $port]
+			}
+		}
+
+		set hw_model(busifs,$ip) [xget_hw_busif_handle $ip "*"]
+		foreach busif $hw_model(busifs,$ip) {
+			hw_snapshot_handle $ip $busif busif
+			lappend hw_model(net,$hw_model(value,$busif)) $busif
+		}
+	}
+	debug handles "Hardware snapshot: [llength $ips] IPs"
+}
+
+# Return IP handles of any of types in MHS order
+proc hw_ips_of_type {mhs_handle types} {
+	variable hw_model
+
+	if {![info exists hw_model(mhs)] || $hw_model(mhs) != $mhs_handle} {
+		set ips {}
+		foreach ip [xget_hw_ipinst_handle $mhs_handle "*"] {
+			if {[lsearch -exact $types [string tolower [xget_hw_value $ip]]] != -1} {
+				lappend ips $ip
+			}
+		}
+		return $ips
+	}
+	set ips {}
+	foreach type [lsort -unique $types] {
+		if {[info exists hw_model(type,$type)]} {
+			foreach ip $hw_model(type,$type) {
+				lappend ips [list $hw_model(order,$ip) $ip]
+			}
+		}
+	}
+	set handles {}
+	foreach ip [lsort -integer -index 0 $ips] {
+		lappend handles [lindex $ip 1]
+	}
+	return $handles
+}
+
+# Return {ip port} of all clock ports in MHS order
+proc hw_clock_ports {mhs_handle} {
+	variable hw_model
+
+	if {![info exists hw_model(mhs)] || $hw_model(mhs) != $mhs_handle} {
+		set clkports {}
+		foreach ip [xget_hw_ipinst_handle $mhs_handle "*"] {
+			foreach port [xget_hw_port_handle $ip "*"] {
+				if {[string toupper [xget_hw_subproperty_value $port "SIGIS"]] == "CLK"} {
+					lappend clkports [list $ip $port]
+				}
+			}
+		}
+		return $clkports
+	}
+	return $hw_model(clkports)
+}
+
+proc hw_snapshot_handle {ip handle kind} {
+	variable hw_model
+
+	set name [xget_hw_name $handle]
+	set hw_model(name,$handle) $name
+	set hw_model(value,$handle) [xget_hw_value $handle]
+	set hw_model(parent,$handle) $ip
+	set key "$kind,$ip,[string toupper $name]"
+	if {![info exists hw_model($key)]} {
+		set hw_model($key) $handle
+	}
+}
+
+proc hw_name {handle} {
+	variable hw_model
+
+	if {![info exists hw_model(name,$handle)]} {
+		set hw_model(name,$handle) [xget_hw_name $handle]
+	}
+	return $hw_model(name,$handle)
+}
+
+proc hw_value {handle} {
+	variable hw_model
+
+	if {![info exists hw_model(value,$handle)]} {
+		set hw_model(value,$handle) [xget_hw_value $handle]
+	}
+	return $hw_model(value,$handle)
+}
+
+proc hw_parent_handle {handle} {
+	variable hw_model
+
+	if {![info exists hw_model(parent,$handle)]} {
+		set hw_model(parent,$handle) [xget_hw_parent_handle $handle]
+	}
+	return $hw_model(parent,$handle)
+}
+
+proc hw_subproperty_value {handle name} {
+	variable hw_model
+
+	if {![info exists hw_model(sub,$handle,$name)]} {
+		set hw_model(sub,$handle,$name) [xget_hw_subproperty_value $handle $name]
+	}
+	return $hw_model(sub,$handle,$name)
+}
+
+proc hw_ipinst_handle {mhs_handle name} {
+	variable hw_model
+
+	if {![info exists hw_model(mhs)] || $hw_model(mhs) != $mhs_handle} {
+		return [xget_hw_ipinst_handle $mhs_handle $name]
+	}
+	if {[string equal "*" $name]} {
+		return $hw_model(ips)
+	}
+	set key "inst,[string tolower $name]"
+	if {[info exists hw_model($key)]} {
+		return $hw_model($key)
+	}
+	return ""
+}
+
+# Look up a parameter, port or bus interface handle of an IP
+proc hw_child_handle {kind ip_handle name} {
+	variable hw_model
+
+	if {[string equal "*" $name]} {
+		return $hw_model(${kind}s,$ip_handle)
+	}
+	set key "$kind,$ip_handle,[string toupper $name]"
+	if {[info exists hw_model($key)]} {
+		return $hw_model($key)
+	}
+	return ""
+}
+
+proc hw_parameter_handle {ip_handle name} {
+	variable hw_model
+
+	if {![info exists hw_model(params,$ip_handle)]} {
+		return [xget_hw_parameter_handle $ip_handle $name]
+	}
+	return [hw_child_handle param $ip_handle $name]
+}
+
+proc hw_parameter_value {ip_handle name} {
+	variable hw_model
+
+	if {![info exists hw_model(params,$ip_handle)]} {
+		return [xget_hw_parameter_value $ip_handle $name]
+	}
+	set handle [hw_child_handle param $ip_handle $name]
+	if {[llength $handle] == 0} {
+		return ""
+	}
+	return [hw_value $handle]
+}
+
+proc hw_port_handle {ip_handle name} {
+	variable hw_model
+
+	if {![info exists hw_model(ports,$ip_handle)]} {
+		return [xget_hw_port_handle $ip_handle $name]
+	}
+	return [hw_child_handle port $ip_handle $name]
+}
+
+proc hw_port_value {ip_handle name} {
+	variable hw_model
+
+	if {![info exists hw_model(ports,$ip_handle)]} {
+		return [xget_hw_port_value $ip_handle $name]
+	}
+	set handle [hw_child_handle port $ip_handle $name]
+	if {[llength $handle] == 0} {
+		return ""
+	}
+	return [hw_value $handle]
+}
+
+proc hw_busif_handle {ip_handle name} {
+	variable hw_model
+
+	if {![info exists hw_model(busifs,$ip_handle)]} {
+		return [xget_hw_busif_handle $ip_handle $name]
+	}
+	return [hw_child_handle busif $ip_handle $name]
+}
+
+# All bus interfaces connected to the bus or net from the snapshot
+proc hw_net_busifs {net} {
+	variable hw_model
+
+	if {[info exists hw_model(net,$net)]} {
+		return $hw_model(net,$net)
+	}
+	return ""
+}
+
+proc hw_busif_value {ip_handle name} {
+	variable hw_model
+
+	if {![info exists hw_model(busifs,$ip_handle)]} {
+		return [xget_hw_busif_value $ip_handle $name]
+	}
+	set handle [hw_child_handle busif $ip_handle $name]
+	if {[llength $handle] == 0} {
+		return ""
+	}
+	return [hw_value $handle]
+}
+
 proc generate_device_tree {filepath bootargs {consoleip ""}} {
 	variable  device_tree_generator_version
 	global board_name
 	debug info "--- device tree generator version: v$device_tree_generator_version ---"
 	debug info "generating $filepath"
 
+	reset_generator_state
+	context_var profile
+	if {[info exists profile] && [string is true -strict $profile]} {
+		profile_start
+	}
+	set run_start [profile_begin]
+
+	compile_overrides
+	cells_push [root_cells]
+
+	context_var handler_file compatible_file
+	if {[info exists compatible_file]} {
+		load_compatible_file $compatible_file
+	}
+	if {[info exists handler_file]} {
+		load_handler_file $handler_file
+	}
+
+	context_var incremental
+	if {[info exists incremental] && [string is true -strict $incremental]} {
+		slave_cache_load "[file rootname $filepath].cache"
+	} else {
+		slave_cache_load ""
+	}
+
 	set toplevel {}
 	set ip_tree {}
 
+	context_var streaming dtb_output overlay
+	if {[info exists streaming] && [string is true -strict $streaming]} {
+		if {[info exists dtb_output] && [string is true -strict $dtb_output]} {
+			debug warning "Warning!: streaming is not possible with dtb_output, the whole tree is kept"
+		} elseif {[info exists overlay] && [llength $overlay] != 0} {
+			debug warning "Warning!: streaming is not possible with overlay, the whole tree is kept"
+		} else {
+			stream_open $filepath
+		}
+	}
+
 	set proc_handle [xget_libgen_proc_handle]
 	set hwproc_handle [xget_handle $proc_handle "IPINST"]
 
+	set mhs_handle [xget_hw_parent_handle $hwproc_handle]
+	profile_eval hw_snapshot {
+		hw_snapshot $mhs_handle
+	}
+
 # Clock port summary
+	set clock_start [profile_begin]
+	clock_nets_clear
 	debug clock "Clock Port Summary:"
-	set mhs_handle [xget_hw_parent_handle $hwproc_handle]
-	set ips [xget_hw_ipinst_handle $mhs_handle "*"]
-	foreach ip $ips {
-		set ipname [xget_hw_name $ip]
-		set ports [xget_hw_port_handle $ip "*"]
-		foreach port $ports {
-			set sigis [xget_hw_subproperty_value $port "SIGIS"]
-			if {[string toupper $sigis] == "CLK"} {
-				set portname [xget_hw_name $port]
-				# EDK doesn't compute clocks for ports that aren't connected.
-				set connected_port [xget_hw_port_value $ip $portname]
-				if {[llength $connected_port] != 0} {
-					set frequency [get_clock_frequency $ip $portname]
-					if {$frequency == ""} {
-						set connected_bus [get_clock_frequency $ip $portname]
-						set frequency "WARNING: no frequency found!"
-					}
-					debug clock "$ipname.$portname connected to $connected_port:"
-					debug clock "    CLK_FREQ_HZ = $frequency"
-					set dir [xget_hw_subproperty_value $port "DIR"]
-					set inport [xget_hw_subproperty_value $port "CLK_INPORT"]
-					set factor [xget_hw_subproperty_value $port "CLK_FACTOR"]
-					if {[string toupper $dir] == "O"} {
-						debug clock "    CLK_INPORT = $inport"
-						debug clock "    CLK_FACTOR = $factor"
-					}
-				}
+	foreach clkport [hw_clock_ports $mhs_handle] {
+		set ip [lindex $clkport 0]
+		set port [lindex $clkport 1]
+		set ipname [hw_name $ip]
+		set portname [hw_name $port]
+		# EDK doesn't compute clocks for ports that aren't connected.
+		set connected_port [hw_port_value $ip $portname]
+		if {[llength $connected_port] != 0} {
+			set frequency [get_clock_frequency $ip $portname]
+			if {$frequency == ""} {
+				set connected_bus [get_clock_frequency $ip $portname]
+				set frequency "WARNING: no frequency found!"
+			}
+			debug clock "$ipname.$portname connected to $connected_port:"
+			debug clock "    CLK_FREQ_HZ = $frequency"
+			clock_net_add $connected_port $frequency
+			set dir [hw_subproperty_value $port "DIR"]
+			set inport [hw_subproperty_value $port "CLK_INPORT"]
+			set factor [hw_subproperty_value $port "CLK_FACTOR"]
+			if {[string toupper $dir] == "O"} {
+				debug clock "    CLK_INPORT = $inport"
+				debug clock "    CLK_FACTOR = $factor"
+				clock_net_driver $connected_port $ip $inport
 			}
 		}
 	}
+	profile_end phase clock_summary $clock_start
 
 	set proctype [xget_value $hwproc_handle "OPTION" "IPNAME"]
 	switch $proctype {
 		"microblaze" {
 			# Microblaze linux system requires dual-channel timer
-			global timer
-			variable simple_version
+			context_var timer
+			context_var simple_version
 
 			if { "$simple_version" != "1" } {
 				if { [string match "" $timer] || [string match "none" $timer] } {
@@ -255,38 +990,38 @@ proc generate_device_tree {filepath bootargs {consoleip ""}} {
 			# a valid handle for both these bus ifs, even if they are not
 			# connected. The better way of checking if a bus is connected
 			# or not is to check it's value.
-			set bus_name [xget_hw_busif_value $hwproc_handle "M_AXI_DC"]
+			set bus_name [hw_busif_value $hwproc_handle "M_AXI_DC"]
 			if { [string compare -nocase $bus_name ""] != 0 } {
 				set tree [bus_bridge $hwproc_handle $intc 0 "M_AXI_DC"]
 				if { [llength $tree] != 0 } {
-					set tree [tree_append $tree [list ranges empty empty]]
-					lappend ip_tree $tree
+					tree_lappend tree [list ranges empty empty]
+					bus_tree_add ip_tree $tree
 				}
 			}
-			set bus_name [xget_hw_busif_value $hwproc_handle "M_AXI_DP"]
+			set bus_name [hw_busif_value $hwproc_handle "M_AXI_DP"]
 			if { [string compare -nocase $bus_name ""] != 0 } {
 				set tree [bus_bridge $hwproc_handle $intc 0 "M_AXI_DP"]
 				if { [llength $tree] != 0 } {
-					set tree [tree_append $tree [list ranges empty empty]]
-					lappend ip_tree $tree
+					tree_lappend tree [list ranges empty empty]
+					bus_tree_add ip_tree $tree
 				}
 			}
-			set bus_name [xget_hw_busif_value $hwproc_handle "DPLB"]
+			set bus_name [hw_busif_value $hwproc_handle "DPLB"]
 			if { [string compare -nocase $bus_name ""] != 0 } {
 				# Microblaze v7 has PLB.
 				set tree [bus_bridge $hwproc_handle $intc 0 "DPLB"]
 				if { [llength $tree] != 0 } {
-					set tree [tree_append $tree [list ranges empty empty]]
-					lappend ip_tree $tree
+					tree_lappend tree [list ranges empty empty]
+					bus_tree_add ip_tree $tree
 				}
 			}
-			set bus_name [xget_hw_busif_value $hwproc_handle "DOPB"]
+			set bus_name [hw_busif_value $hwproc_handle "DOPB"]
 			if { [string compare -nocase $bus_name ""] != 0 } {
 				# Older microblazes have OPB.
 				set tree [bus_bridge $hwproc_handle $intc 0 "DOPB"]
 				if { [llength $tree] != 0 } {
-					set tree [tree_append $tree [list ranges empty empty]]
-					lappend ip_tree $tree
+					tree_lappend tree [list ranges empty empty]
+					bus_tree_add ip_tree $tree
 				}
 			}
 			lappend toplevel [list "compatible" stringtuple [list "xlnx,microblaze"] ]
@@ -294,7 +1029,7 @@ proc generate_device_tree {filepath bootargs {consoleip ""}} {
 				lappend toplevel [list model string "Xilinx MicroBlaze"]
 			}
 
-			variable microblaze_system_timer
+			context_var microblaze_system_timer
 			if { "$simple_version" != "1" } {
 				if { [llength $microblaze_system_timer] == 0 } {
 					error "Microblaze requires to setup system timer. Please setup it!"
@@ -303,38 +1038,38 @@ proc generate_device_tree {filepath bootargs {consoleip ""}} {
 		}
 		"ppc405" -
 		"ppc405_virtex4" {
-			global timer
+			context_var timer
 			set timer ""
 
 			set intc [get_handle_to_intc $proc_handle "EICC405EXTINPUTIRQ"]
 			set toplevel [gen_ppc405 $toplevel $hwproc_handle [default_parameters $hwproc_handle]]
-			set busif_handle [xget_hw_busif_handle $hwproc_handle "DPLB"]
+			set busif_handle [hw_busif_handle $hwproc_handle "DPLB"]
 			if {[llength $busif_handle] != 0} {
 				# older ppc405s have a single PLB interface.
 				set tree [bus_bridge $hwproc_handle $intc 0 "DPLB"]
 				if { [llength $tree] != 0 } {
-					set tree [tree_append $tree [list ranges empty empty]]
-					lappend ip_tree $tree
+					tree_lappend tree [list ranges empty empty]
+					bus_tree_add ip_tree $tree
 				}
 			} else {
 				# newer ppc405s since edk9.2 have two plb interfaces, with
 				# DPLB1 only being used for memory.
 				set tree [bus_bridge $hwproc_handle $intc 0 "DPLB0"]
 				if { [llength $tree] != 0 } {
-					set tree [tree_append $tree [list ranges empty empty]]
-					lappend ip_tree $tree
+					tree_lappend tree [list ranges empty empty]
+					bus_tree_add ip_tree $tree
 				}
 				set tree [bus_bridge $hwproc_handle $intc 1 "DPLB1"]
 				if { [llength $tree] != 0 } {
-					set tree [tree_append $tree [list ranges empty empty]]
-					lappend ip_tree $tree
+					tree_lappend tree [list ranges empty empty]
+					bus_tree_add ip_tree $tree
 				}
 			}
 			# pickup things which are only on the dcr bus.
 			if {[bus_is_connected $hwproc_handle "MDCR"]} {
 				set tree [bus_bridge $hwproc_handle $intc 0 "MDCR"]
 				if { [llength $tree] != 0 } {
-					lappend ip_tree $tree
+					bus_tree_add ip_tree $tree
 				}
 			}
 
@@ -344,37 +1079,37 @@ proc generate_device_tree {filepath bootargs {consoleip ""}} {
 			}
 		}
 		"ppc440_virtex5" {
-			global timer
+			context_var timer
 			set timer ""
 
 			set intc [get_handle_to_intc $proc_handle "EICC440EXTIRQ"]
 			set toplevel [gen_ppc440 $toplevel $hwproc_handle $intc [default_parameters $hwproc_handle]]
 			set tree [bus_bridge $hwproc_handle $intc 0 "MPLB"]
 			if { [llength $tree] != 0 } {
-				set tree [tree_append $tree [list ranges empty empty]]
-				lappend ip_tree $tree
+				tree_lappend tree [list ranges empty empty]
+				bus_tree_add ip_tree $tree
 			}
 			# pickup things which are only on the dcr bus.
 			if {[bus_is_connected $hwproc_handle "MDCR"]} {
 				set tree [bus_bridge $hwproc_handle $intc 0 "MDCR"]
 				if { [llength $tree] != 0 } {
-					lappend ip_tree $tree
+					bus_tree_add ip_tree $tree
 				}
 			}
 
 # 			set tree [bus_bridge $hwproc_handle $intc 0 "PPC440MC"]
 # 			set tree [tree_append $tree [list ranges empty empty]]
-# 			lappend ip_tree $tree
+# 			bus_tree_add ip_tree $tree
 
 			lappend toplevel [list "compatible" stringtuple [list "xlnx,virtex440" "xlnx,virtex"] ]
-			set cpu_name [xget_hw_name $hwproc_handle]
+			set cpu_name [hw_name $hwproc_handle]
 			lappend toplevel [list "dcr-parent" labelref $cpu_name]
 			if { ![info exists board_name] } {
 				lappend toplevel [list model string "Xilinx PPC Virtex440"]
 			}
 		}
 		"ps7_cortexa9" {
-			global timer
+			context_var timer
 			set timer ""
 
 			# MS: This is nasty hack how to get all slave IPs
@@ -383,23 +1118,23 @@ proc generate_device_tree {filepath bootargs {consoleip ""}} {
 			set ips [xget_hw_proc_slave_periphs $hwproc_handle]
 
 			# FIXME uses axi_ifs instead of ips and remove that param from bus_bridge
-			global axi_ifs
+			context_var axi_ifs
 			set axi_ifs ""
 
 			# Find out GIC
 			foreach i $ips {
-				if { "[xget_hw_value $i]" == "ps7_scugic" } {
+				if { "[hw_value $i]" == "ps7_scugic" } {
 					set intc "$i"
 				}
 			}
 
 			set toplevel [gen_cortexa9 $toplevel $hwproc_handle $intc [default_parameters $hwproc_handle]]
 
-			set bus_name [xget_hw_busif_value $hwproc_handle "M_AXI_DP"]
+			set bus_name [hw_busif_value $hwproc_handle "M_AXI_DP"]
 			if { [string compare -nocase $bus_name ""] != 0 } {
 				set tree [bus_bridge $hwproc_handle $intc 0 "M_AXI_DP" "" $ips "ps7_pl310 ps7_xadc"]
-				set tree [tree_append $tree [list ranges empty empty]]
-				lappend ip_tree $tree
+				tree_lappend tree [list ranges empty empty]
+				bus_tree_add ip_tree $tree
 			}
 			lappend toplevel [list "compatible" stringtuple [list "xlnx,zynq-zc770" "xlnx,zynq-7000"] ]
 			if { ![info exists board_name] } {
@@ -411,14 +1146,19 @@ proc generate_device_tree {filepath bootargs {consoleip ""}} {
 		}
 	}
 
-	variable alias_node_list
+	context_var alias_node_list
 	puts "$alias_node_list"
 
+	set overlay_tree {}
+	if {[info exists overlay] && [llength $overlay] != 0} {
+		set overlay_tree [overlay_split ip_tree $overlay]
+	}
+
 	if {[llength $bootargs] == 0} {
 		# generate default string for uart16550 or uartlite if specified
 		if {![string match "" $consoleip] && ![string match -nocase "none" $consoleip] } {
 			set uart_handle [xget_sw_ipinst_handle_from_processor [xget_libgen_proc_handle] $consoleip]
-			switch -exact [xget_value $uart_handle "VALUE"] {
+			switch -exact [hw_value $uart_handle] {
 				"axi_uart16550" -
 				"xps_uart16550" -
 				"plb_uart16550" -
@@ -448,6 +1188,7 @@ proc generate_device_tree {filepath bootargs {consoleip ""}} {
 	lappend chosen [list bootargs string $bootargs]
 
 	set dev_tree [concat $toplevel $ip_tree]
+	tree_index $dev_tree
 	if {$consoleip != ""} {
 		set consolepath [get_pathname_for_label $dev_tree $consoleip]
 		if {$consolepath != ""} {
@@ -459,8 +1200,7 @@ proc generate_device_tree {filepath bootargs {consoleip ""}} {
 		debug warning "WARNING: no console ip was specified.  This may prevent output from appearing on the boot console."
 	}
 
-	lappend toplevel [list \#size-cells int 1]
-	lappend toplevel [list \#address-cells int 1]
+	set toplevel [concat $toplevel [cells_properties]]
 
 	if { [info exists board_name] } {
 		lappend toplevel [list model string [prj_dir]]
@@ -477,77 +1217,570 @@ proc generate_device_tree {filepath bootargs {consoleip ""}} {
 	#
 	lappend toplevel [list aliases tree $alias_node_list]
 
+	set clocks [gen_clock_nodes]
+	if {[llength $clocks] != 0} {
+		lappend toplevel $clocks
+	}
+
 	set toplevel [gen_memories $toplevel $hwproc_handle]
+	address_map_finish $toplevel
 
-	set toplevel_file [open $filepath w]
-	headerc $toplevel_file $device_tree_generator_version
-	puts $toplevel_file "/dts-v1/;"
-	puts $toplevel_file "/ {"
-	write_tree 0 $toplevel_file $toplevel
-	write_tree 0 $toplevel_file $ip_tree
-	puts $toplevel_file "} ;"
-	close $toplevel_file
+	set write_start [profile_begin]
+	if {[stream_active]} {
+		stream_close $toplevel
+	} else {
+		set dts [dts_header $device_tree_generator_version]
+		append dts "/dts-v1/;\n"
+		append dts "/ {\n"
+		append dts [render_tree 0 $toplevel]
+		append dts [render_tree 0 $ip_tree]
+		append dts "} ;\n"
+		write_file_atomic $filepath $dts
+	}
+	slave_cache_save
+
+	if {[info exists dtb_output] && [string is true -strict $dtb_output]} {
+		set dtb_file "[file rootname $filepath].dtb"
+		debug info "generating $dtb_file"
+		# The overlay is resolved against __symbols__ of the base tree
+		write_file_atomic $dtb_file [fdt_blob [concat $toplevel $ip_tree] 0 [expr {[llength $overlay_tree] != 0}]] 1
+	}
+	if {[llength $overlay_tree] != 0} {
+		set dtso_file "[file rootname $filepath].dtso"
+		debug info "generating $dtso_file"
+		set dts [dts_header $device_tree_generator_version]
+		append dts "/dts-v1/;\n"
+		append dts "/plugin/;\n"
+		append dts "/ {\n"
+		append dts [render_tree 0 $overlay_tree]
+		append dts "} ;\n"
+		write_file_atomic $dtso_file $dts
+		if {[info exists dtb_output] && [string is true -strict $dtb_output]} {
+			set dtbo_file "[file rootname $filepath].dtbo"
+			debug info "generating $dtbo_file"
+			write_file_atomic $dtbo_file [fdt_blob $overlay_tree 1] 1
+		}
+	}
+	profile_end phase write $write_start
+	profile_end phase total $run_start
+	profile_finish "[file rootname $filepath].profile.csv"
 }
 
-proc post_generate {lib_handle} {
+# Streaming output
+# Every bus subtree is rendered and written as soon as bus_bridge returns
+# it, instead of keeping the whole tree until the end. The toplevel nodes
+# (cpus, chosen, aliases, memory) need labels from all buses and go to
+# a second root block, which dtc merges with the first one. Labels of the
+# written subtrees stay in tree_label_index for the console path.
+# The context keeps stream_channel and stream_file of the open temporary file.
+proc stream_open {filepath} {
+	variable device_tree_generator_version
+	context_var stream_channel stream_file
+
+	set stream_file $filepath
+	set stream_channel [open "$filepath.tmp" w]
+	fconfigure $stream_channel -buffering full -buffersize 65536
+	puts -nonewline $stream_channel [dts_header $device_tree_generator_version]
+	puts $stream_channel "/dts-v1/;"
+	puts $stream_channel "/ \{"
 }
 
-proc prj_dir {} {
-	# board_name comes from toplevel BSP context
-	global board_name
+proc stream_active {} {
+	context_var stream_channel
 
-	if { [info exists board_name] } {
+	return [expr {[info exists stream_channel] && $stream_channel != ""}]
+}
 
-		return $board_name
+# Append bus tree to the list in treevar or write it to the stream
+proc bus_tree_add {treevar tree} {
+	upvar $treevar ip_tree
+	context_var stream_channel flatten_buses overlay
+
+	address_map_add [list $tree]
+	if {[info exists flatten_buses] && [string is true -strict $flatten_buses]} {
+		set keep [tree_references [list $tree]]
+		if {[info exists overlay]} {
+			set keep [concat $keep $overlay]
+		}
+		set tree [bus_flatten $tree $keep]
 	}
-	return [file tail [file normalize [file join .. .. ..]]]
+
+	if {![stream_active]} {
+		lappend ip_tree $tree
+		return
+	}
+	tree_index [list $tree]
+	puts -nonewline $stream_channel [render_tree 0 [list $tree]]
+	flush $stream_channel
 }
 
-proc headerc {ufile generator_version} {
-	puts $ufile "/*"
-	puts $ufile " * Device Tree Generator version: $generator_version"
-	puts $ufile " *"
-	puts $ufile " * (C) Copyright 2007-2013 Xilinx, Inc."
-	puts $ufile " * (C) Copyright 2007-2013 Michal Simek"
-	puts $ufile " * (C) Copyright 2007-2012 PetaLogix Qld Pty Ltd"
-	puts $ufile " *"
-	puts $ufile " * Michal SIMEK <monstr@monstr.eu>"
-	puts $ufile " *"
-	puts $ufile " * This program is free software; you can redistribute it and/or"
-	puts $ufile " * modify it under the terms of the GNU General Public License as"
-	puts $ufile " * published by the Free Software Foundation; either version 2 of"
-	puts $ufile " * the License, or (at your option) any later version."
-	puts $ufile " *"
-	puts $ufile " * This program is distributed in the hope that it will be useful,"
-	puts $ufile " * but WITHOUT ANY WARRANTY; without even the implied warranty of"
-	puts $ufile " * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the"
-	puts $ufile " * GNU General Public License for more details."
-	puts $ufile " *"
-	puts $ufile " * You should have received a copy of the GNU General Public License"
-	puts $ufile " * along with this program; if not, write to the Free Software"
-	puts $ufile " * Foundation, Inc., 59 Temple Place, Suite 330, Boston,"
-	puts $ufile " * MA 02111-1307 USA"
-	puts $ufile " *"
-	puts $ufile " * CAUTION: This file is automatically generated by libgen."
-	puts $ufile " * Version: [xget_swverandbld]"
-	puts $ufile " * [clock format [clock seconds] -format {Today is: %A, the %d of %B, %Y; %H:%M:%S}]"
-	puts $ufile " *"
-	puts $ufile " * XPS project directory: [prj_dir]"
-	puts $ufile " */"
-	puts $ufile ""
+proc stream_close {toplevel} {
+	context_var stream_channel stream_file
+
+	puts $stream_channel "\} ;"
+	puts $stream_channel "/ \{"
+	puts -nonewline $stream_channel [render_tree 0 $toplevel]
+	puts $stream_channel "\} ;"
+	close $stream_channel
+	set stream_channel ""
+	file rename -force "$stream_file.tmp" $stream_file
 }
 
-# generate structure for reset gpio.
-# mss description - first pin of Reset_GPIO ip is used for system reset
-# {key-word IP_name gpio_pin size_of_pin}
-# for reset-gpio is used only size equals 1
+# Drop the temporary file of a run which failed while streaming
+proc stream_abort {} {
+	context_var stream_channel stream_file
+
+	if {[stream_active]} {
+		catch {close $stream_channel}
+		catch {file delete -force "$stream_file.tmp"}
+		set stream_channel ""
+	}
+}
+
+# Address map
+# The reg entries and the parent side of the ranges entries of the nodes
+# on each bus are sorted by base address and swept once, comparing every
+# entry with the farthest reaching one before it, so overlapping regions
+# are reported in O(n log n) per bus instead of surfacing as probe
+# failures. Nodes with an empty ranges (the buses of the CPU,
+# xlnx,compound) share the address space of their parent, their subnodes
+# are checked with it. Buses below a translating ranges are checked when
+# their bus tree is added, the entries of the root address space are
+# kept in address_map_entries until the root nodes (memory, sram) are
+# known and address_map_finish checks them all together.
+
+# Value of a list of 32-bit cells
+proc cells_decode {cells} {
+	set value 0
+	foreach cell $cells {
+		set value [expr {(wide($value) << 32) | $cell}]
+	}
+	return $value
+}
+
+# {base high} windows node takes in the address space of its bus with cells
+proc address_map_windows {node cells} {
+	set address_cells [lindex $cells 0]
+	set node_cells [tree_cells $node]
+	set windows {}
+	foreach prop [lindex $node 2] {
+		if {[lindex $prop 1] != "hexinttuple"} {
+			continue
+		}
+		switch -exact -- [lindex $prop 0] {
+			"reg" {
+				set offset 0
+				set size_cells [lindex $cells 1]
+			}
+			"ranges" {
+				set offset [lindex $node_cells 0]
+				set size_cells [lindex $node_cells 1]
+			}
+			default {
+				continue
+			}
+		}
+		set width [expr {$offset + $address_cells + $size_cells}]
+		set value [lindex $prop 2]
+		for {set i 0} {$i + $width <= [llength $value]} {incr i $width} {
+			set base [cells_decode [lrange $value [expr {$i + $offset}] [expr {$i + $offset + $address_cells - 1}]]]
+			set size [cells_decode [lrange $value [expr {$i + $width - $size_cells}] [expr {$i + $width - 1}]]]
+			if {$size != 0} {
+				lappend windows [list $base [expr {$base + $size - 1}]]
+			}
+		}
+	}
+	return $windows
+}
+
+# Append {base high name path} entries of the list of tree triples on a
+# bus with cells to entriesvar and check the buses below them
+proc address_map_collect {nodes cells entriesvar path} {
+	upvar $entriesvar entries
+
+	foreach node $nodes {
+		if {[lindex $node 1] != "tree" || [llength $node] != 3} {
+			continue
+		}
+		set name [fdt_node_name [lindex $node 0]]
+		set nodepath "$path/[lindex $name 1]"
+		if {[lindex $name 0] != ""} {
+			set name [lindex $name 0]
+		} else {
+			set name [lindex $name 1]
+		}
+		foreach window [address_map_windows $node $cells] {
+			lappend entries [concat $window [list $name $nodepath]]
+		}
+		set ranges [tree_property $node "ranges"]
+		if {[lindex $ranges 1] == "empty"} {
+			address_map_collect [lindex $node 2] $cells entries $nodepath
+		} else {
+			address_map_check $node $nodepath
+		}
+	}
+}
+
+# Add the nodes of the root address space in the list of tree triples
+proc address_map_add {nodes} {
+	context_var address_map_entries
+
+	address_map_collect $nodes [root_cells] address_map_entries ""
+}
+
+# Check the root address space with the root nodes in toplevel
+proc address_map_finish {toplevel} {
+	context_var address_map_entries
+
+	address_map_add $toplevel
+	address_map_sweep $address_map_entries "/"
+	set address_map_entries {}
+}
+
+proc address_map_window {entry} {
+	return "[format 0x%08lx [lindex $entry 0]]-[format 0x%08lx [lindex $entry 1]]"
+}
+
+# Warn about overlapping windows of the nodes on the bus tree and below
+proc address_map_check {tree path} {
+	set entries {}
+	address_map_collect [lindex $tree 2] [tree_cells $tree] entries $path
+	address_map_sweep $entries $path
+}
+
+# Warn about overlapping {base high name path} entries on the bus at path
+proc address_map_sweep {entries path} {
+	set last {}
+	foreach entry [lsort -integer -index 0 $entries] {
+		# A node's own reg and ranges windows may overlap
+		if {[llength $last] != 0 && [lindex $entry 0] <= [lindex $last 1]
+			&& [lindex $entry 3] != [lindex $last 3]} {
+			debug warning "Warning!: [lindex $entry 2] [address_map_window $entry] overlaps [lindex $last 2] [address_map_window $last] on $path"
+		}
+		if {[llength $last] == 0 || [lindex $entry 1] > [lindex $last 1]} {
+			set last $entry
+		}
+	}
+}
+
+# Bus flattening
+# With the flatten_buses OS parameter, simple-bus and xlnx,compound nodes
+# nested in a bus whose ranges maps their addresses 1:1 to the same cells
+# are replaced by their subnodes, so of_platform walks fewer levels at
+# boot. Buses with labels in keep (referenced or overlay targets) and
+# buses whose subnodes would clash with names on the parent stay.
+
+# 1 if node is a bus that can be replaced by its subnodes on a bus with cells
+proc bus_identity {node cells keep} {
+	set label [lindex [fdt_node_name [lindex $node 0]] 0]
+	if {$label != "" && [lsearch -exact $keep $label] != -1} {
+		return 0
+	}
+	set compatible [lindex [tree_property $node "compatible"] 2]
+	if {[lsearch -exact $compatible "simple-bus"] == -1 && [lsearch -exact $compatible "xlnx,compound"] == -1} {
+		return 0
+	}
+	if {[tree_cells $node] != $cells} {
+		return 0
+	}
+	set ranges [tree_property $node "ranges"]
+	switch -exact -- [lindex $ranges 1] {
+		"empty" {
+			return 1
+		}
+		"hexinttuple" {
+			set address_cells [lindex $cells 0]
+			set width [expr {2 * $address_cells + [lindex $cells 1]}]
+			set value [lindex $ranges 2]
+			if {[llength $value] % $width != 0} {
+				return 0
+			}
+			for {set i 0} {$i < [llength $value]} {incr i $width} {
+				set child [lrange $value $i [expr {$i + $address_cells - 1}]]
+				set parent [lrange $value [expr {$i + $address_cells}] [expr {$i + 2 * $address_cells - 1}]]
+				if {[cells_decode $child] != [cells_decode $parent]} {
+					return 0
+				}
+			}
+			return 1
+		}
+	}
+	return 0
+}
+
+# Bus tree with the identity mapped buses below it replaced by their subnodes
+proc bus_flatten {tree keep} {
+	set cells [tree_cells $tree]
+	set content {}
+	foreach node [lindex $tree 2] {
+		if {[lindex $node 1] == "tree" && [llength $node] == 3} {
+			set node [bus_flatten $node $keep]
+		}
+		lappend content $node
+	}
+
+	array set names {}
+	foreach node $content {
+		if {[lindex $node 1] == "tree"} {
+			set names([lindex [fdt_node_name [lindex $node 0]] 1]) 1
+		}
+	}
+	set flattened {}
+	foreach node $content {
+		if {[lindex $node 1] != "tree" || [llength $node] != 3 || ![bus_identity $node $cells $keep]} {
+			lappend flattened $node
+			continue
+		}
+		set subnodes {}
+		set clash 0
+		foreach sub [lindex $node 2] {
+			if {[lindex $sub 1] != "tree"} {
+				continue
+			}
+			set name [lindex [fdt_node_name [lindex $sub 0]] 1]
+			if {[info exists names($name)]} {
+				set clash 1
+				break
+			}
+			lappend subnodes $sub
+		}
+		if {$clash} {
+			lappend flattened $node
+			continue
+		}
+		foreach sub $subnodes {
+			set names([lindex [fdt_node_name [lindex $sub 0]] 1]) 1
+		}
+		debug ip "Flattening bus [lindex $node 0]"
+		set flattened [concat $flattened $subnodes]
+	}
+	return [list [lindex $tree 0] tree $flattened]
+}
+
+# Device tree overlays
+# The nodes of the buses and IPs named in the overlay OS parameter are
+# moved from the bus trees to fragments of xilinx.dtso, one fragment per
+# parent node, so a reconfigurable region can be loaded at runtime on top
+# of xilinx.dts. References to labels of the base tree (interrupt
+# controllers, clocks) become fixups when the overlay is compiled.
+
+# Labels of all nodes in the list of tree triples
+proc tree_labels {tree} {
+	set labels {}
+	foreach node $tree {
+		if {[lindex $node 1] != "tree"} {
+			continue
+		}
+		set label [lindex [fdt_node_name [lindex $node 0]] 0]
+		if {$label != ""} {
+			lappend labels $label
+		}
+		set labels [concat $labels [tree_labels [lindex $node 2]]]
+	}
+	return $labels
+}
+
+# Labels referenced from properties in the list of tree triples
+proc tree_references {tree} {
+	set refs {}
+	foreach node $tree {
+		set value [lindex $node 2]
+		switch -exact [lindex $node 1] {
+			"tree" {
+				set refs [concat $refs [tree_references $value]]
+			}
+			"labelref" {
+				lappend refs $value
+			}
+			"labelreftuple" {
+				set refs [concat $refs $value]
+			}
+			"labelref-ext" {
+				lappend refs [lindex [eval concat $value] 0]
+			}
+			"celltuple" {
+				foreach element $value {
+					if {[string index $element 0] == "&"} {
+						lappend refs [string range $element 1 end]
+					}
+				}
+			}
+		}
+	}
+	return $refs
+}
+
+# Move nodes labelled with one of names out of the list of tree triples in
+# treevar. fragmentsvar is an array of the moved nodes by target, which is
+# the parent label or path, and the targets in order of first use.
+proc overlay_extract {treevar names fragmentsvar {target {labelref ""}} {path /}} {
+	upvar $treevar tree
+	upvar $fragmentsvar fragments
+
+	set kept {}
+	foreach node $tree {
+		if {[lindex $node 1] != "tree" || [llength $node] != 3} {
+			lappend kept $node
+			continue
+		}
+		set name [fdt_node_name [lindex $node 0]]
+		set label [lindex $name 0]
+		if {$label != "" && [lsearch -exact $names $label] != -1} {
+			if {![info exists fragments($target)]} {
+				lappend fragments(targets) $target
+			}
+			lappend fragments($target) $node
+			continue
+		}
+		set subtree [lindex $node 2]
+		if {$label != ""} {
+			set subtarget [list labelref $label]
+		} else {
+			set subtarget [list path "$path[lindex $name 1]"]
+		}
+		overlay_extract subtree $names fragments $subtarget "$path[lindex $name 1]/"
+		lappend kept [list [lindex $node 0] tree $subtree]
+	}
+	set tree $kept
+}
+
+# Move the overlay nodes out of the bus trees in treevar and drop aliases
+# of the moved nodes. Returns the root node content of the overlay.
+proc overlay_split {treevar names} {
+	upvar $treevar tree
+	context_var alias_node_list consoleip
+
+	array set fragments {targets {}}
+	overlay_extract tree $names fragments
+	if {[llength $fragments(targets)] == 0} {
+		debug warning "Warning!: no nodes found for overlay $names"
+		return {}
+	}
+
+	set overlay_tree {}
+	set moved {}
+	set index 0
+	foreach target $fragments(targets) {
+		set moved [concat $moved [tree_labels $fragments($target)]]
+		if {[lindex $target 0] == "labelref" && [lindex $target 1] != ""} {
+			set target_prop [list target labelref [lindex $target 1]]
+		} elseif {[lindex $target 0] == "path"} {
+			set target_prop [list target-path string [lindex $target 1]]
+		} else {
+			set target_prop [list target-path string "/"]
+		}
+		lappend overlay_tree [list "fragment@$index" tree [list $target_prop \
+			[list "__overlay__" tree $fragments($target)]]]
+		incr index
+	}
+	foreach name $names {
+		if {[lsearch -exact $moved $name] == -1} {
+			debug warning "Warning!: overlay node $name not found"
+		}
+	}
+
+	set aliases {}
+	foreach alias $alias_node_list {
+		if {[lsearch -exact $moved [lindex $alias 2]] == -1} {
+			lappend aliases $alias
+		}
+	}
+	set alias_node_list $aliases
+	if {[lsearch -exact $moved $consoleip] != -1} {
+		debug warning "Warning!: console ip $consoleip is in the overlay"
+	}
+	foreach ref [lsort -unique [tree_references $tree]] {
+		if {[lsearch -exact $moved $ref] != -1} {
+			debug warning "Warning!: base tree references $ref of the overlay"
+		}
+	}
+	return $overlay_tree
+}
+
+# Write the whole content with one write to a temporary file and move it
+# over filepath, so an aborted run never leaves a half-written file behind.
+proc write_file_atomic {filepath content {binary 0}} {
+	set tmpfile "$filepath.tmp"
+	set ufile [open $tmpfile w]
+	if {[catch {
+		fconfigure $ufile -buffering full -buffersize 1048576
+		if {$binary} {
+			fconfigure $ufile -translation binary
+		}
+		puts -nonewline $ufile $content
+		close $ufile
+	} error]} {
+		catch {close $ufile}
+		catch {file delete -force $tmpfile}
+		error "Can't write $filepath: $error"
+	}
+	file rename -force $tmpfile $filepath
+}
+
+proc post_generate {lib_handle} {
+}
+
+proc prj_dir {} {
+	# board_name comes from toplevel BSP context
+	global board_name
+
+	if { [info exists board_name] } {
+
+		return $board_name
+	}
+	return [file tail [file normalize [file join .. .. ..]]]
+}
+
+proc headerc {ufile generator_version} {
+	puts -nonewline $ufile [dts_header $generator_version]
+}
+
+proc dts_header {generator_version} {
+	set header ""
+	append header "/*\n"
+	append header " * Device Tree Generator version: $generator_version\n"
+	append header " *\n"
+	append header " * (C) Copyright 2007-2013 Xilinx, Inc.\n"
+	append header " * (C) Copyright 2007-2013 Michal Simek\n"
+	append header " * (C) Copyright 2007-2012 PetaLogix Qld Pty Ltd\n"
+	append header " *\n"
+	append header " * Michal SIMEK <monstr@monstr.eu>\n"
+	append header " *\n"
+	append header " * This program is free software; you can redistribute it and/or\n"
+	append header " * modify it under the terms of the GNU General Public License as\n"
+	append header " * published by the Free Software Foundation; either version 2 of\n"
+	append header " * the License, or (at your option) any later version.\n"
+	append header " *\n"
+	append header " * This program is distributed in the hope that it will be useful,\n"
+	append header " * but WITHOUT ANY WARRANTY; without even the implied warranty of\n"
+	append header " * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the\n"
+	append header " * GNU General Public License for more details.\n"
+	append header " *\n"
+	append header " * You should have received a copy of the GNU General Public License\n"
+	append header " * along with this program; if not, write to the Free Software\n"
+	append header " * Foundation, Inc., 59 Temple Place, Suite 330, Boston,\n"
+	append header " * MA 02111-1307 USA\n"
+	append header " *\n"
+	append header " * CAUTION: This file is automatically generated by libgen.\n"
+	append header " * Version: [xget_swverandbld]\n"
+	append header " * [clock format [clock seconds] -format {Today is: %A, the %d of %B, %Y; %H:%M:%S}]\n"
+	append header " *\n"
+	append header " * XPS project directory: [prj_dir]\n"
+	append header " */\n"
+	append header "\n"
+	return $header
+}
+
+# generate structure for reset gpio.
+# mss description - first pin of Reset_GPIO ip is used for system reset
+# {key-word IP_name gpio_pin size_of_pin}
+# for reset-gpio is used only size equals 1
 #
 # PARAMETER periph_type_overrides = {hard-reset-gpios Reset_GPIO 1 1}
 proc reset_gpio {} {
-	global overrides
 	# ignore size parameter
 	set reset {}
-	foreach over $overrides {
+	foreach over [override_list hard-reset-gpios] {
 		# parse hard-reset-gpio keyword
 		if {[lindex $over 0] == "hard-reset-gpios"} {
 			# search if that gpio name is valid IP core in system
@@ -575,9 +1808,8 @@ proc reset_gpio {} {
 #
 # PARAMETER periph_type_overrides = {led heartbeat LEDs_8Bit 5 5} {led yellow LEDs_8Bit 7 2} {led green LEDs_8Bit 4 1}
 proc led_gpio {} {
-	global overrides
 	set tree {}
-	foreach over $overrides {
+	foreach over [override_list led] {
 		# parse hard-reset-gpio keyword
 		if {[lindex $over 0] == "led"} {
 			# clear trigger
@@ -616,7 +1848,7 @@ proc led_gpio {} {
 
 # Check if gpio name is valid or not
 proc valid_gpio {name} {
-	global gpio_names
+	context_var gpio_names
 	foreach gpio_desc $gpio_names {
 		if { [string match -nocase [lindex $gpio_desc 0] "$name" ] } {
 			return $gpio_desc
@@ -628,7 +1860,7 @@ proc valid_gpio {name} {
 proc get_intc_signals {intc} {
 
 	# MS the simplest way to detect ARM is through intc type
-	if { "[xget_hw_value $intc]" == "ps7_scugic" } {
+	if { "[hw_value $intc]" == "ps7_scugic" } {
 		# MS here is small complication because INTC from FPGA
 		# are divided to two separate segments. That's why
 		# I generate two silly offsets to setup correct location
@@ -636,7 +1868,7 @@ proc get_intc_signals {intc} {
 		# FPGA 7-0 - irq 61 - 68
 		# FPGA 15-8 - irq 84 - 91
 
-		set int_lines "[split [xget_hw_port_value $intc "IRQ_F2P"] "&"]"
+		set int_lines "[split [hw_port_value $intc "IRQ_F2P"] "&"]"
 
 		set fpga_irq_id 0
 		set irq_signals {}
@@ -682,7 +1914,7 @@ proc get_intc_signals {intc} {
 		# Compose signal string with this layout from top to down
 		set signals "[lrange ${irq_signals} 0 7] $pl2 [lrange ${irq_signals} 8 15] $pl1"
 	} else {
-		set signals [split [xget_hw_port_value $intc "intr"] "&"]
+		set signals [split [hw_port_value $intc "intr"] "&"]
 	}
 
 	set intc_signals {}
@@ -692,30 +1924,163 @@ proc get_intc_signals {intc} {
 	return $intc_signals
 }
 
+# Build signal to irq table for intc once per run
+proc get_intc_signal_table {intc} {
+	variable intc_signal_cache
+
+	if {[info exists intc_signal_cache($intc)]} {
+		return
+	}
+	set intc_signals [get_intc_signals $intc]
+	set count [llength $intc_signals]
+	set index 0
+	foreach signal $intc_signals {
+		# interrupt 0 is last in list, first match wins
+		if {![info exists intc_signal_cache($intc,$signal)]} {
+			set irq [expr {$count - $index - 1}]
+			set intc_signal_cache($intc,$signal) $irq
+			lappend intc_signal_cache(route,$signal) [list $intc $irq]
+		}
+		incr index
+	}
+	set intc_signal_cache($intc) $count
+}
+
+# Interrupt routing
+# Interrupts of IPs can be connected to the interrupt controller of the
+# CPU or to an opb/xps/axi_intc cascaded behind it, whose IRQ output is
+# an input of the CPU controller (IRQ_F2P of the Zynq GIC) or of another
+# cascaded controller. Controllers of other processors are not part of
+# the routes. The signal tables of the CPU controller and the cascaded
+# ones are built once per run, the CPU controller first, and
+# intc_signal_cache(route,$signal) lists {controller irq} of every input
+# the signal is connected to.
+variable irq_controller_types {opb_intc xps_intc axi_intc}
+
+proc irq_route_table {intc} {
+	variable intc_signal_cache
+	variable irq_controller_types
+
+	if {[info exists intc_signal_cache(routes)]} {
+		return
+	}
+	set intc_signal_cache(routes) {}
+	if {[string match "" $intc] || [string match -nocase "none" $intc]} {
+		return
+	}
+	get_intc_signal_table $intc
+	lappend intc_signal_cache(routes) $intc
+	set candidates {}
+	foreach controller [hw_ips_of_type [hw_parent_handle $intc] $irq_controller_types] {
+		if {$controller != $intc} {
+			lappend candidates $controller
+		}
+	}
+	# Add the controllers whose IRQ output reaches one already added
+	# until no more are found
+	set found 1
+	while {$found} {
+		set found 0
+		set remaining {}
+		foreach controller $candidates {
+			set signal [hw_value [hw_port_handle $controller "IRQ"]]
+			set cascaded 0
+			if {![string match "" $signal]} {
+				foreach parent $intc_signal_cache(routes) {
+					if {[info exists intc_signal_cache($parent,$signal)]} {
+						set cascaded 1
+						break
+					}
+				}
+			}
+			if {$cascaded} {
+				get_intc_signal_table $controller
+				lappend intc_signal_cache(routes) $controller
+				set found 1
+			} else {
+				lappend remaining $controller
+			}
+		}
+		set candidates $remaining
+	}
+}
+
+# Return {controller irq} port_name of ip_handle is connected to, empty if
+# it isn't connected to any controller other than ip_handle itself
+proc irq_route {ip_handle intc port_name} {
+	variable intc_signal_cache
+
+	irq_route_table $intc
+	set signal [hw_value [hw_port_handle $ip_handle $port_name]]
+	if {[string match "" $signal] || ![info exists intc_signal_cache(route,$signal)]} {
+		return {}
+	}
+	foreach route $intc_signal_cache(route,$signal) {
+		if {[lindex $route 0] != $ip_handle} {
+			return $route
+		}
+	}
+	return {}
+}
+
+proc clear_intc_signal_cache {} {
+	variable intc_signal_cache
+
+	array unset intc_signal_cache
+	array set intc_signal_cache {}
+}
+
+# Add key to the visited set. Return 1 if it wasn't there before.
+proc visited_add {set key} {
+	variable generator_context
+	upvar #0 $generator_context context
+
+	if {[info exists context(visited,$set,$key)]} {
+		return 0
+	}
+	set context(visited,$set,$key) 1
+	return 1
+}
+
+proc visited_exists {set key} {
+	variable generator_context
+	upvar #0 $generator_context context
+
+	return [info exists context(visited,$set,$key)]
+}
+
+proc visited_clear {{set ""}} {
+	variable generator_context
+	upvar #0 $generator_context context
+
+	if {[string match "" $set]} {
+		array unset context "visited,*"
+	} else {
+		array unset context "visited,$set,*"
+	}
+}
+
 # Get interrupt number
 proc get_intr {ip_handle intc port_name} {
+	variable intc_signal_cache
+
 	if {![string match "" $intc] && ![string match -nocase "none" $intc]} {
-		set intc_signals [get_intc_signals $intc]
-		set port_handle [xget_hw_port_handle $ip_handle "$port_name"]
-		set interrupt_signal [xget_value $port_handle "VALUE"]
-		set index [lsearch $intc_signals $interrupt_signal]
-		if {$index == -1} {
-			return -1
-		} else {
-			# interrupt 0 is last in list.
-			return [expr [llength $intc_signals] - $index - 1]
+		get_intc_signal_table $intc
+		set port_handle [hw_port_handle $ip_handle "$port_name"]
+		set interrupt_signal [hw_value $port_handle]
+		if {[info exists intc_signal_cache($intc,$interrupt_signal)]} {
+			return $intc_signal_cache($intc,$interrupt_signal)
 		}
-	} else {
-		return -1
 	}
+	return -1
 }
 
 proc get_intr_type {intc ip_handle port_name} {
-	set ip_name [xget_hw_name $ip_handle]
-	set port_handle [xget_hw_port_handle $ip_handle "$port_name"]
-	set sensitivity [xget_hw_subproperty_value $port_handle "SENSITIVITY"];
+	set ip_name [hw_name $ip_handle]
+	set port_handle [hw_port_handle $ip_handle "$port_name"]
+	set sensitivity [hw_subproperty_value $port_handle "SENSITIVITY"];
 
-	if { "[xget_hw_value $intc]" == "ps7_scugic" } {
+	if { "[hw_value $intc]" == "ps7_scugic" } {
 		# Follow the openpic specification
 		if { [string compare -nocase $sensitivity "EDGE_FALLING"] == 0 } {
 			return 2;
@@ -746,13 +2111,15 @@ proc get_intr_type {intc ip_handle port_name} {
 # the opb_ps2_dual_ref
 proc compound_slave {slave {baseaddrname "C_BASEADDR"}} {
 	set baseaddr [scan_int_parameter_value $slave ${baseaddrname}]
-	set ip_name [xget_hw_name $slave]
-	set ip_type [xget_hw_value $slave]
+	set ip_name [hw_name $slave]
+	set ip_type [hw_value $slave]
 	set tree [list [format_ip_name $ip_type $baseaddr $ip_name] tree {}]
-	set tree [tree_append $tree [list \#size-cells int 1]]
-	set tree [tree_append $tree [list \#address-cells int 1]]
-	set tree [tree_append $tree [list ranges empty empty]]
-	set tree [tree_append $tree [list compatible stringtuple [list "xlnx,compound"]]]
+	# Subnodes use addresses of the bus because of the empty ranges
+	foreach cells [cells_properties] {
+		tree_lappend tree $cells
+	}
+	tree_lappend tree [list ranges empty empty]
+	tree_lappend tree [list compatible stringtuple [list "xlnx,compound"]]
 	return $tree
 }
 
@@ -762,21 +2129,21 @@ proc slaveip_intr {slave intc interrupt_port_list devicetype params {baseaddr_pr
 }
 
 proc get_dcr_parent_name {slave face} {
-	set busif_handle [xget_hw_busif_handle $slave $face]
+	set busif_handle [hw_busif_handle $slave $face]
 	if {[llength $busif_handle] == 0} {
 		error "Bus handle $face not found!"
 	}
-	set bus_name [xget_hw_value $busif_handle]
+	set bus_name [hw_value $busif_handle]
 
 	debug ip "IP on DCR bus $bus_name"
 	debug handles "  bus_handle: $busif_handle"
-	set mhs_handle [xget_hw_parent_handle $slave]
-	set bus_handle [xget_hw_ipinst_handle $mhs_handle $bus_name]
+	set mhs_handle [hw_parent_handle $slave]
+	set bus_handle [hw_ipinst_handle $mhs_handle $bus_name]
 
 	set master_ifs [xget_hw_connected_busifs_handle $mhs_handle $bus_name "master"]
 	if {[llength $master_ifs] == 1} {
-		set ip_handle [xget_hw_parent_handle [lindex $master_ifs 0 0]]
-		set ip_name [xget_hw_name $ip_handle]
+		set ip_handle [hw_parent_handle [lindex $master_ifs 0 0]]
+		set ip_name [hw_name $ip_handle]
 		return $ip_name
 	} else {
 		error "DCR bus found which does not have exactly one master.  Masters were $master_ifs"
@@ -784,12 +2151,12 @@ proc get_dcr_parent_name {slave face} {
 }
 
 proc append_dcr_interface {tree slave {dcr_baseaddr_prefix ""} } {
-	set name [xget_hw_name $slave]
+	set name [hw_name $slave]
 	set baseaddr [scan_int_parameter_value $slave [format "C_DCR%s_BASEADDR" $dcr_baseaddr_prefix]]
 	set highaddr [scan_int_parameter_value $slave [format "C_DCR%s_HIGHADDR" $dcr_baseaddr_prefix]]
-	set tree [tree_append $tree [gen_reg_property $name $baseaddr $highaddr "dcr-reg"]]
+	tree_lappend tree [gen_reg_property $name $baseaddr $highaddr "dcr-reg"]
 	set name [get_dcr_parent_name $slave "SDCR"]
-	set tree [tree_append $tree [list "dcr-parent" labelref $name]]
+	tree_lappend tree [list "dcr-parent" labelref $name]
 	return $tree
 }
 
@@ -814,7 +2181,7 @@ proc slaveip_dcr_or_plb {slave intc devicetype params {baseaddr_prefix ""} {othe
 			} else {
 				set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] $devicetype $params "S_AXI_" "" $other_compatibles]
 				# Necessary for linux driver probing because driver was designed for PPC DCR
-				set ip_tree [tree_append $ip_tree [list "xlnx,dcr-splb-slave-if" int $bus_name]]
+				tree_lappend ip_tree [list "xlnx,dcr-splb-slave-if" int $bus_name]
 				return $ip_tree
 			}
 		}
@@ -828,13 +2195,13 @@ proc slaveip_dcr_or_plb {slave intc devicetype params {baseaddr_prefix ""} {othe
 # device tree always handles byte address.
 proc slaveip_dcr {slave intc devicetype params {baseaddr_prefix ""} {other_compatibles {}} } {
 	set dcr_baseaddr [scan_int_parameter_value $slave [format "C_%sBASEADDR" $baseaddr_prefix]]
-	set name [xget_hw_name $slave]
-	set type [xget_hw_value $slave]
+	set name [hw_name $slave]
+	set type [hw_value $slave]
 	if {$devicetype == ""} {
 		set devicetype $type
 	}
 	set tree [slaveip_basic $slave $intc $params [format_ip_name $devicetype $dcr_baseaddr $name] $other_compatibles]
-	set dcr_busif_handle [xget_hw_busif_handle $slave "SDCR"]
+	set dcr_busif_handle [hw_busif_handle $slave "SDCR"]
 	if {[llength $dcr_busif_handle] != 0} {
 		# Hmm.. looks like there's a dcr interface.
 		set tree [append_dcr_interface $tree $slave]
@@ -849,7 +2216,7 @@ proc slaveip_dcr {slave intc devicetype params {baseaddr_prefix ""} {other_compa
 	# 4 and then have to convert back to the correct address.
 	set scaled_baseaddr [expr $dcr_baseaddr * 4]
 	set scaled_highaddr [expr ($dcr_highaddr + 1) * 4 - 1]
-	set tree [tree_append $tree [gen_reg_property $name $scaled_baseaddr $scaled_highaddr]]
+	tree_lappend tree [gen_reg_property $name $scaled_baseaddr $scaled_highaddr]
 
 	return $tree
 }
@@ -858,7 +2225,7 @@ proc slaveip {slave intc devicetype params {baseaddr_prefix ""} {other_compatibl
 	set baseaddr [scan_int_parameter_value $slave [format "C_%sBASEADDR" $baseaddr_prefix]]
 	set highaddr [scan_int_parameter_value $slave [format "C_%sHIGHADDR" $baseaddr_prefix]]
 	set tree [slaveip_explicit_baseaddr $slave $intc $devicetype $params $baseaddr $highaddr $other_compatibles]
-	set dcr_busif_handle [xget_hw_busif_handle $slave "SDCR"]
+	set dcr_busif_handle [hw_busif_handle $slave "SDCR"]
 	if {[llength $dcr_busif_handle] != 0} {
 		if {[bus_is_connected $slave "SDCR"] != 0} {
 			# Hmm.. looks like there's a dcr interface.
@@ -876,8 +2243,8 @@ proc slaveip_pcie_ipif_slave {slave intc devicetype params {baseaddr_prefix ""}
 }
 
 proc slaveip_explicit_baseaddr {slave intc devicetype params baseaddr highaddr {other_compatibles {}} } {
-	set name [xget_hw_name $slave]
-	set type [xget_hw_value $slave]
+	set name [hw_name $slave]
+	set type [hw_value $slave]
 	if {$devicetype == ""} {
 		set devicetype $type
 	}
@@ -886,10 +2253,10 @@ proc slaveip_explicit_baseaddr {slave intc devicetype params baseaddr highaddr {
 }
 
 proc slaveip_basic {slave intc params nodename {other_compatibles {}} } {
-	set name [xget_hw_name $slave]
-	set type [xget_hw_value $slave]
+	set name [hw_name $slave]
+	set type [hw_value $slave]
 
-	set hw_ver [xget_hw_parameter_value $slave "HW_VER"]
+	set hw_ver [hw_parameter_value $slave "HW_VER"]
 
 	set ip_node {}
 	lappend ip_node [gen_compatible_property $name $type $hw_ver $other_compatibles]
@@ -911,164 +2278,25 @@ proc gen_intc {slave intc devicetype param {prefix ""} {other_compatibles {}}} {
 	return [list $intc_name tree $intc_node]
 }
 
-proc ll_temac_parameters {ip_handle index} {
-	set params {}
-	foreach param [default_parameters $ip_handle] {
-		set pattern [format "C_TEMAC%d*" $index]
-		if {[string match $pattern $param]} {
-			lappend params $param
-		}
-	}
-	return $params
-}
-
 # Generate a slaveip, assuming it is inside a compound that has a
 # baseaddress and reasonable ranges.
 # index: The index of this slave
 # stride: The distance between instances of the slave inside the container
 # size: The size of the address space for the slave
 proc slaveip_in_compound_intr {slave intc interrupt_port_list devicetype parameter_list index stride size} {
-	set name [xget_hw_name $slave]
-	set type [xget_hw_value $slave]
+	set name [hw_name $slave]
+	set type [hw_value $slave]
 	if {$devicetype == ""} {
 		set devicetype $type
 	}
 	set baseaddr [expr $index * $stride]
 	set highaddr [expr $baseaddr + $size - 1]
 	set ip_tree [slaveip_basic $slave $intc $parameter_list [format_ip_name $devicetype $baseaddr]]
-	set ip_tree [tree_append $ip_tree [gen_reg_property $name $baseaddr $highaddr]]
+	tree_lappend ip_tree [gen_reg_property $name $baseaddr $highaddr]
 	set ip_tree [gen_interrupt_property $ip_tree $slave $intc $interrupt_port_list]
 	return $ip_tree
 }
 
-proc slave_ll_temac_port {slave intc index} {
-	set name [xget_hw_name $slave]
-	set type [xget_hw_value $slave]
-	set baseaddr [scan_int_parameter_value $slave "C_BASEADDR"]
-	set baseaddr [expr $baseaddr + $index * 0x40]
-	set highaddr [expr $baseaddr + 0x3f]
-
-	#
-	# Add this temac channel to the alias list
-	#
-	variable ethernet_count
-	variable alias_node_list
-	set subnode_name [format "%s_%s" $name "ETHERNET"]
-	set alias_node [list ethernet$ethernet_count aliasref $subnode_name $ethernet_count]
-	lappend alias_node_list $alias_node
-	incr ethernet_count
-
-	set ip_tree [slaveip_basic $slave $intc "" [format_ip_name "ethernet" $baseaddr $subnode_name]]
-	set ip_tree [tree_append $ip_tree [list "device_type" string "network"]]
-	variable mac_count
-	set ip_tree [tree_append $ip_tree [list "local-mac-address" bytesequence [list 0x00 0x0a 0x35 0x00 0x00 $mac_count]]]
-	incr mac_count
-
-	set ip_tree [tree_append $ip_tree [gen_reg_property $name $baseaddr $highaddr]]
-	set ip_tree [gen_interrupt_property $ip_tree $slave $intc [format "TemacIntc%d_Irpt" $index]]
-	set ip_name [lindex $ip_tree 0]
-	set ip_node [lindex $ip_tree 2]
-	# Generate the parameters, stripping off the right prefix.
-	set ip_node [gen_params $ip_node $slave [ll_temac_parameters $slave $index] [format "C_TEMAC%i_" $index]]
-	# Generate the common parameters.
-	set ip_node [gen_params $ip_node $slave [list "C_PHY_TYPE" "C_TEMAC_TYPE" "C_BUS2CORE_CLK_RATIO"]]
-	set ip_tree [list $ip_name tree $ip_node]
-	set mhs_handle [xget_hw_parent_handle $slave]
-	# See what the temac is connected to.
-	set ll_busif_handle [xget_hw_busif_handle $slave "LLINK$index"]
-	set ll_name [xget_hw_value $ll_busif_handle]
-	set ll_ip_handle [xget_hw_connected_busifs_handle $mhs_handle $ll_name "target"]
-	set ll_ip_handle_name [xget_hw_name $ll_ip_handle]
-	set connected_ip_handle [xget_hw_parent_handle $ll_ip_handle]
-	set connected_ip_name [xget_hw_name $connected_ip_handle]
-	set connected_ip_type [xget_hw_value $connected_ip_handle]
-	if {$connected_ip_type == "mpmc"} {
-		# Assumes only one MPMC.
-		if {[string match SDMA_LL? $ll_ip_handle_name]} {
-			set port_number [string range $ll_ip_handle_name 7 7]
-			set sdma_name "PIM$port_number"
-			set ip_tree [tree_append $ip_tree [list "llink-connected" labelref $sdma_name]]
-		} else {
-			error "found ll_temac connected to mpmc, but can't find the port number!"
-		}
-	} elseif {$connected_ip_type == "ppc440_virtex5"} {
-		# Assumes only one PPC.
-		if {[string match LLDMA? $ll_ip_handle_name]} {
-			set port_number [string range $ll_ip_handle_name 5 5]
-			set sdma_name "DMA$port_number"
-			set ip_tree [tree_append $ip_tree [list "llink-connected" labelref $sdma_name]]
-		} else {
-			error "found ll_temac connected to ppc440_virtex5, but can't find the port number!"
-		}
-	} else {
-		# Hope it's something that only has one locallink
-		# connection. Most likely an xps_ll_fifo
-		set ip_tree [tree_append $ip_tree [list "llink-connected" labelref "$connected_ip_name"]]
-	}
-	return $ip_tree
-}
-proc slave_ll_temac {slave intc} {
-	set tree [compound_slave $slave]
-	set tree [tree_append $tree [slave_ll_temac_port $slave $intc 0] ]
-	set port1_enabled  [scan_int_parameter_value $slave "C_TEMAC1_ENABLED"]
-	if {$port1_enabled == "1"} {
-		set tree [tree_append $tree [slave_ll_temac_port $slave $intc 1] ]
-	}
-	return $tree
-}
-proc slave_mpmc {slave intc} {
-	set share_addresses [scan_int_parameter_value $slave "C_ALL_PIMS_SHARE_ADDRESSES"]
-	if {[catch {
-		# Found control port for ECC and performance monitors
-		set tree [slaveip $slave $intc "" "" "MPMC_CTRL_"]
-		set ip_name [lindex $tree 0]
-		set mpmc_node [lindex $tree 2]
-	}]} {
-		# No control port
-		if {$share_addresses == 0} {
-			set baseaddr [scan_int_parameter_value $slave "C_PIM0_BASEADDR"]
-		} else {
-			set baseaddr [scan_int_parameter_value $slave "C_MPMC_BASEADDR"]
-		}
-		set tree [slaveip_basic $slave $intc "" [format_ip_name "mpmc" $baseaddr] ]
-		set ip_name [lindex $tree 0]
-		set mpmc_node [lindex $tree 2]
-
-		# Generate the parameters
-		# set mpmc_node [gen_params $mpmc_node $slave [default_parameters $slave] ]
-
-	}
-	lappend mpmc_node [list \#size-cells int 1]
-	lappend mpmc_node [list \#address-cells int 1]
-	lappend mpmc_node [list ranges empty empty]
-
-	set num_ports [scan_int_parameter_value $slave "C_NUM_PORTS"]
-	for {set x 0} {$x < $num_ports} {incr x} {
-		set pim_type [scan_int_parameter_value $slave [format "C_PIM%d_BASETYPE" $x]]
-		if {$pim_type == 3} {
-			# Found an SDMA port
-			if {$share_addresses == 0} {
-				set baseaddr [scan_int_parameter_value $slave [format "C_SDMA_CTRL%d_BASEADDR" $x]]
-				set highaddr [scan_int_parameter_value $slave [format "C_SDMA_CTRL%d_HIGHADDR" $x]]
-			} else {
-				set baseaddr [scan_int_parameter_value $slave "C_SDMA_CTRL_BASEADDR"]
-				set baseaddr [expr $baseaddr + $x * 0x80]
-				set highaddr [expr $baseaddr + 0x7f]
-			}
-
-			set sdma_name [format_ip_name sdma $baseaddr "PIM$x"]
-			set sdma_tree [list $sdma_name tree {}]
-			set sdma_tree [tree_append $sdma_tree [gen_reg_property $sdma_name $baseaddr $highaddr]]
-			set sdma_tree [tree_append $sdma_tree [gen_compatible_property $sdma_name "ll_dma" "1.00.a"]]
-			set sdma_tree [gen_interrupt_property $sdma_tree $slave $intc [list [format "SDMA%d_Rx_IntOut" $x] [format "SDMA%d_Tx_IntOut" $x]]]
-
-			lappend mpmc_node $sdma_tree
-
-		}
-	}
-	return [list $ip_name tree $mpmc_node]
-}
-
 #
 #get handle to interrupt controller from CPU handle
 #
@@ -1076,7 +2304,7 @@ proc get_handle_to_intc {proc_handle port_name} {
 	#one CPU handle
 	set hwproc_handle [xget_handle $proc_handle "IPINST"]
 	#hangle to mhs file
-	set mhs_handle [xget_hw_parent_handle $hwproc_handle]
+	set mhs_handle [hw_parent_handle $hwproc_handle]
 	#get handle to interrupt port on Microblaze
 	set intr_port [xget_value $hwproc_handle "PORT" $port_name]
 	if { [llength $intr_port] == 0 } {
@@ -1087,8 +2315,8 @@ proc get_handle_to_intc {proc_handle port_name} {
 	#get source port periphery handle - on interrupt controller
 	set source_port [xget_hw_connected_ports_handle $mhs_handle $intr_port "source"]
 	#get interrupt controller handle
-	set intc [xget_hw_parent_handle $source_port]
-	set name [xget_hw_name $intc]
+	set intc [hw_parent_handle $source_port]
+	set name [hw_name $intc]
 	debug handles "Interrupt Controller: $name $intc"
 	return $intc
 }
@@ -1116,13 +2344,17 @@ proc change_nodename {nodetochange oldname newname} {
 }
 
 proc check_console_irq {slave intc} {
-	global consoleip
-	set name [xget_hw_name $slave]
+	context_var consoleip
+	set name [hw_name $slave]
 
-	set irq [get_intr $slave $intc [interrupt_list $slave]]
+	set route [irq_route $slave $intc [interrupt_list $slave]]
+	set irq -1
+	if {[llength $route] != 0} {
+		set irq [lindex $route 1]
+	}
 	if { $irq == "-1" } {
 		if {[string match -nocase $name $consoleip]} {
-			error "Console($name) interrupt line is not connected to the interrupt controller [xget_hw_name $intc]. Please connect it or choose different console IP."
+			error "Console($name) interrupt line is not connected to the interrupt controller [hw_name $intc]. Please connect it or choose different console IP."
 		} else {
 			debug warning "Warning!: Serial IP ($name) has no interrupt connected!"
 		}
@@ -1175,1396 +2407,581 @@ proc zynq_irq {ip_tree intc name } {
 
 	if { [info exists zynq_irq_list($name)] } {
 		set irq "$zynq_irq_list($name)"
-		set ip_tree [tree_append $ip_tree [list "interrupts" inttuple "$irq"]]
-		set intc_name [xget_hw_name $intc]
-		set ip_tree [tree_append $ip_tree [list "interrupt-parent" labelref $intc_name]]
+		tree_lappend ip_tree [list "interrupts" inttuple "$irq"]
+		set intc_name [hw_name $intc]
+		tree_lappend ip_tree [list "interrupt-parent" labelref $intc_name]
+		set indexes {}
+		for {set i 0} {$i < [llength $irq] / 3} {incr i} {
+			lappend indexes $i
+		}
+		set ip_tree [gen_irq_hints $ip_tree $name $indexes]
 	}
 	return $ip_tree
 }
 
-proc gener_slave {node slave intc {force_type ""}} {
-	variable phy_count
-	variable mac_count
+# IP handler registry
+# Nodes for IP cores are generated by handler procs registered per IP type:
+#     proc handler {node slave intc name type} - returns node with the IP
+#         subtree(s) appended
+# slave_handlers($type) - handler proc of the type
+# slave_handler_info($type) - key/value metadata of the type
+#     family - group of IP types handled together
+#     devicetype, params, prefix, compatible - used by gen_slave_generic
+# IP types without a handler use gen_slave_default.
+# In-house cores can be registered from the handler_file MLD parameter.
+#
+# Handlers of less common families live in handlers/<family>.tcl and are
+# sourced the first time an IP of the family is generated, so a design
+# only compiles the handlers it uses.
+# handler_families_loaded($family) - handlers/<family>.tcl was sourced
+variable slave_handlers
+array set slave_handlers {}
+variable slave_handler_info
+array set slave_handler_info {}
+variable handler_dir [file join [file dirname [file normalize [info script]]] handlers]
+variable handler_families_loaded
+array set handler_families_loaded {}
+
+proc register_slave_handler {types handler {info {}}} {
+	variable slave_handlers
+	variable slave_handler_info
+
+	foreach type $types {
+		set slave_handlers($type) $handler
+		set slave_handler_info($type) $info
+	}
+}
 
-	if { [llength $force_type] != 0 } {
-		set name $force_type
-		set type $force_type
-	} else {
-		set name [xget_hw_name $slave]
-		set type [xget_hw_value $slave]
+proc slave_handler {type} {
+	variable slave_handlers
 
-		# Ignore IP through overides
-		# Command: "ip -ignore <IP name> "
-		global overrides
-		foreach i $overrides {
-			# skip others overrides
-			if { [lindex "$i" 0] != "ip" } {
-				continue;
-			}
-			# Compatible command have at least 4 elements in the list
-			if { [llength $i] != 3 } {
-				error "Wrong compatible override command string - $i"
-			}
-			# Check command and then IP name
-			if { [string match [lindex "$i" 1] "-ignore"] } {
-				if { [string match [lindex "$i" 2] "$name"] } {
-					puts "Ignoring $node"
-					return $node
-				}
-			}
+	if {![info exists slave_handlers($type)]} {
+		return gen_slave_default
+	}
+	set handler $slave_handlers($type)
+	if {[llength [info commands [namespace current]::$handler]] == 0} {
+		array set info [slave_handler_info $type]
+		if {[info exists info(family)]} {
+			load_handler_family $info(family)
 		}
 	}
+	return $handler
+}
 
-	switch -exact $type {
-		"opb_intc" -
-		"xps_intc" -
-		"axi_intc" {
-			# Interrupt controllers
-			lappend node [gen_intc $slave $intc "interrupt-controller" "C_NUM_INTR_INPUTS C_KIND_OF_INTR"]
-		}
-		"mdm" -
-		"opb_mdm" {
-			# Microblaze debug
-
-			# Check if uart feature is enabled
-			set use_uart [xget_hw_parameter_value $slave "C_USE_UART"]
-			if { "$use_uart" == "1" } {
-				set irq [check_console_irq $slave $intc]
-
-				variable alias_node_list
-				global consoleip
-				if { $irq != "-1"} {
-					set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "serial" [default_parameters $slave] "" "" "xlnx,xps-uartlite-1.00.a" ]
-					if {[string match -nocase $name $consoleip]} {
-						lappend alias_node_list [list serial0 aliasref $name 0]
-						set ip_tree [tree_append $ip_tree [list "port-number" int 0]]
-					} else {
-						variable serial_count
-						incr serial_count
-						lappend alias_node_list [list serial$serial_count aliasref $name $serial_count]
-						set ip_tree [tree_append $ip_tree [list "port-number" int $serial_count]]
-					}
-				} else {
-					set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "serial" [default_parameters $slave] "" "" "xlnx,xps-uartlite-1.00.a" ]
-				}
-			} else {
-				# EDK 11.4 disables PLB connection when USE_UART is disabled that's why whole node won't be generated
-				# Only bus connected IPs are generated
-				set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "debug" [default_parameters $slave] "" "" "" ]
-				#"C_MB_DBG_PORTS C_UART_WIDTH C_USE_UART"
-			}
-			lappend node $ip_tree
-		}
-		"xps_uartlite" -
-		"opb_uartlite" -
-		"axi_uartlite" {
-			#
-			# Add this uartlite device to the alias list
-			#
-			check_console_irq $slave $intc
-
-			set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "serial" [default_parameters $slave] ]
-			set ip_tree [tree_append $ip_tree [list "device_type" string "serial"]]
-
-			variable alias_node_list
-			global consoleip
-			if {[string match -nocase $name $consoleip]} {
-				lappend alias_node_list [list serial0 aliasref $name 0]
-				set ip_tree [tree_append $ip_tree [list "port-number" int 0]]
-			} else {
-				variable serial_count
-				incr serial_count
-				lappend alias_node_list [list serial$serial_count aliasref $name $serial_count]
-				set ip_tree [tree_append $ip_tree [list "port-number" int $serial_count]]
-			}
-
-			set ip_tree [tree_append $ip_tree [list "current-speed" int [xget_sw_parameter_value $slave "C_BAUDRATE"]]]
-			if { $type == "opb_uartlite"} {
-				set ip_tree [tree_append $ip_tree [list "clock-frequency" int [get_clock_frequency $slave "SOPB_Clk"]]]
-			} elseif { $type == "xps_uartlite" } {
-				set ip_tree [tree_append $ip_tree [list "clock-frequency" int [get_clock_frequency $slave "SPLB_Clk"]]]
-			} elseif { $type == "axi_uartlite" } {
-				set ip_tree [tree_append $ip_tree [list "clock-frequency" int [get_clock_frequency $slave "S_AXI_ACLK"]]]
-			}
-			lappend node $ip_tree
-			#"BAUDRATE DATA_BITS CLK_FREQ ODD_PARITY USE_PARITY"]
-		}
-		"xps_uart16550" -
-		"plb_uart16550" -
-		"opb_uart16550" -
-		"axi_uart16550" {
-			#
-			# Add this uart device to the alias list
-			#
-			check_console_irq $slave $intc
-
-			variable alias_node_list
-			global consoleip
-			if {[string match -nocase $name $consoleip]} {
-				lappend alias_node_list [list serial0 aliasref $name 0]
-			} else {
-				variable serial_count
-				incr serial_count
-				lappend alias_node_list [list serial$serial_count aliasref $name $serial_count]
-			}
-
-			set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "serial" [default_parameters $slave] "" "" [list "ns16550a"] ]
-			set ip_tree [tree_append $ip_tree [list "device_type" string "serial"]]
-			set ip_tree [tree_append $ip_tree [list "current-speed" int "115200"]]
-
-			# The 16550 cores usually use the bus clock as the baud
-			# reference, but can also take an external reference clock.
-			if { $type == "opb_uart16550"} {
-				set freq [get_clock_frequency $slave "OPB_Clk"]
-			} elseif { $type == "plb_uart16550"} {
-				set freq [get_clock_frequency $slave "PLB_Clk"]
-			} elseif { $type == "xps_uart16550"} {
-				set freq [get_clock_frequency $slave "SPLB_Clk"]
-			} elseif { $type == "axi_uart16550"} {
-				set freq [get_clock_frequency $slave "S_AXI_ACLK"]
-			}
-			set has_xin [scan_int_parameter_value $slave "C_HAS_EXTERNAL_XIN"]
-			if { $has_xin == "1" } {
-				set freq [get_clock_frequency $slave "xin"]
-			}
-			set ip_tree [tree_append $ip_tree [list "clock-frequency" int $freq]]
-
-			set ip_tree [tree_append $ip_tree [list "reg-shift" int "2"]]
-			if { $type == "axi_uart16550"} {
-				set ip_tree [tree_append $ip_tree [list "reg-offset" hexint [expr 0x1000]]]
-			} else {
-				set ip_tree [tree_append $ip_tree [list "reg-offset" hexint [expr 0x1003]]]
-			}
-			lappend node $ip_tree
-			#"BAUDRATE DATA_BITS CLK_FREQ ODD_PARITY USE_PARITY"]
-		}
-		"ps7_uart" {
-			set ip_tree [slaveip $slave $intc "serial" [default_parameters $slave] "S_AXI_" "xlnx,xuartps"]
-
-			variable alias_node_list
-			global consoleip
-			if {[string match -nocase $name $consoleip]} {
-				lappend alias_node_list [list serial0 aliasref $name 0]
-				set ip_tree [tree_append $ip_tree [list "port-number" int 0]]
-			} else {
-				variable serial_count
-				incr serial_count
-				lappend alias_node_list [list serial$serial_count aliasref $name $serial_count]
-				set ip_tree [tree_append $ip_tree [list "port-number" int $serial_count]]
-			}
-
-			# MS silly use just clock-frequency which is standard
-			set ip_tree [tree_append $ip_tree [list "device_type" string "serial"]]
-			set ip_tree [tree_append $ip_tree [list "current-speed" int "115200"]]
-			set ip_tree [zynq_irq $ip_tree $intc $name]
-
-			lappend node $ip_tree
-		}
-		"xps_timebase_wdt" -
-		"axi_timebase_wdt" {
-			set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "" [default_parameters $slave] ]
-			if { $type == "xps_timebase_wdt" } {
-				set ip_tree [tree_append $ip_tree [list "clock-frequency" int [get_clock_frequency $slave "SPLB_Clk"]]]
-			} elseif { $type == "axi_timebase_wdt" } {
-				set ip_tree [tree_append $ip_tree [list "clock-frequency" int [get_clock_frequency $slave "S_AXI_ACLK"]]]
-			}
-			lappend node $ip_tree
-		}
-		"xps_timer" -
-		"opb_timer" -
-		"axi_timer" {
-			global timer
-			if {[ string match -nocase $name $timer ]} {
-				set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "system_timer" [default_parameters $slave] ]
-				set one_timer_only [xget_hw_parameter_value $slave "C_ONE_TIMER_ONLY"]
-				if { $one_timer_only == "1" } {
-					error "Linux requires dual channel timer, but $name is set to single channel. Please configure the $name to dual channel"
-				}
-				set irq [get_intr $slave $intc "Interrupt"]
-				if { $irq == "-1" } {
-					error "Linux requires dual channel timer with interrupt connected. Please configure the $name to interrupt"
-				}
-				variable microblaze_system_timer
-				set microblaze_system_timer $timer
-			} else {
-				set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "timer" [default_parameters $slave] ]
-			}
-
-			# for version 1.01b of the xps timer, make sure that it has the patch applied to the h/w
-			# so that it's using an edge interrupt rather than a falling as described in AR 33880
-			# this is tracking a h/w bug in EDK 11.4 that should be fixed in the future
-
-			set hw_ver [xget_hw_parameter_value $slave "HW_VER"]
-			if { $hw_ver == "1.01.b" && $type == "xps_timer" } {
-				set port_handle [xget_hw_port_handle $slave "Interrupt"]
-				set sensitivity [xget_hw_subproperty_value $port_handle "SENSITIVITY"];
-				if { [string compare -nocase $sensitivity "EDGE_RISING"] != 0 } {
-					error "xps_timer version 1.01b must be patched to rising edge IRQ sensitivity. \
-						Please see Xilinx Answer Record 33880 at http://www.xilinx.com/support/answers/33880.htm \
-						and follow the instructions there."
-				}
-			}
-			#"C_COUNT_WIDTH C_ONE_TIMER_ONLY"]
-
-			# axi_timer runs at bus frequency, whereas plb and opb timers run at cpu fruquency. The timer driver
-			# in microblaze kernel uses the 'clock-frequency' property, if there is one available; otherwise it
-			# uses cpu frequency. For axi_timer, generate the 'clock-frequency' property with bus frequency as
-			# it's value
-			if { $type == "axi_timer"} {
-				set freq [get_clock_frequency $slave "S_AXI_ACLK"]
-				set ip_tree [tree_append $ip_tree [list "clock-frequency" int $freq]]
-			}
-			lappend node $ip_tree
-		}
-		"axi_sysace" -
-		"xps_sysace" -
-		"opb_sysace" {
-			set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "sysace" [default_parameters $slave] ]
-			#"MEM_WIDTH"]
-			set sysace_width [xget_hw_parameter_value $slave "C_MEM_WIDTH"]
-			if { $sysace_width == "8" } {
-				set ip_tree [tree_append $ip_tree [list "8-bit" empty empty]]
-			} elseif { $sysace_width == "16" } {
-				set ip_tree [tree_append $ip_tree [list "16-bit" empty empty]]
-			} else {
-				error "Unsuported Systemace memory width"
-			}
-			variable sysace_count
-			set ip_tree [tree_append $ip_tree [list "port-number" int $sysace_count]]
-			incr sysace_count
-			lappend node $ip_tree
-		}
-		"opb_ethernet" -
-		"plb_ethernet" -
-		"opb_ethernetlite" -
-		"xps_ethernetlite" -
-		"axi_ethernetlite" -
-		"plb_temac" {
-			#
-			# Add this temac channel to the alias list
-			#
-			variable ethernet_count
-			variable alias_node_list
-			lappend alias_node_list [list ethernet$ethernet_count aliasref $name $ethernet_count]
-			incr ethernet_count
-
-			# 'network' type
-			set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "ethernet" [default_parameters $slave]]
-			set ip_tree [tree_append $ip_tree [list "device_type" string "network"]]
-			set ip_tree [tree_append $ip_tree [list "local-mac-address" bytesequence [list 0x00 0x0a 0x35 0x00 0x00 $mac_count]]]
-			incr mac_count
-
-			if {$type == "xps_ethernetlite" || $type == "axi_ethernetlite"} {
-				if {[parameter_exists $slave "C_INCLUDE_MDIO"]} {
-					set has_mdio [scan_int_parameter_value $slave "C_INCLUDE_MDIO"]
-					if {$has_mdio == 1} {
-						set phy_name "phy$phy_count"
-						set ip_tree [tree_append $ip_tree [list "phy-handle" labelref $phy_name]]
-						set ip_tree [tree_append $ip_tree [gen_mdiotree $slave]]
-					}
-				}
-			}
-
-			lappend node $ip_tree
-		}
-		"xps_ll_temac" {
-			# We need to handle this specially, to notify the driver
-			# about the connected LL connection, and the dual cores.
-			lappend node [slave_ll_temac $slave $intc]
-		}
-		"axi_ethernet_buffer" -
-		"axi_ethernet" {
-			set name [xget_hw_name $slave]
-			set type [xget_hw_value $slave]
-			set baseaddr [scan_int_parameter_value $slave "C_BASEADDR"]
-			set highaddr [expr $baseaddr + 0x3ffff]
-
-			variable ethernet_count
-			variable alias_node_list
-			set alias_node [list ethernet$ethernet_count aliasref $name $ethernet_count]
-			lappend alias_node_list $alias_node
-			incr ethernet_count
-
-			set ip_tree [slaveip_basic $slave $intc "" [format_ip_name "axi-ethernet" $baseaddr $name]]
-			set ip_tree [tree_append $ip_tree [list "device_type" string "network"]]
-			set ip_tree [tree_append $ip_tree [list "local-mac-address" bytesequence [list 0x00 0x0a 0x35 0x00 0x00 $mac_count]]]
-			incr mac_count
-			set phy_name "phy$phy_count"
-			set ip_tree [tree_append $ip_tree [list "phy-handle" labelref $phy_name]]
-
-			set ip_tree [tree_append $ip_tree [gen_reg_property $name $baseaddr $highaddr]]
-			set ip_tree [gen_interrupt_property $ip_tree $slave $intc [format "INTERRUPT"]]
-			set ip_name [lindex $ip_tree 0]
-			set ip_node [lindex $ip_tree 2]
-			# Generate the common parameters.
-			set ip_node [gen_params $ip_node $slave [list "C_PHY_TYPE" "C_TYPE" "C_PHYADDR" "C_INCLUDE_IO" "C_HALFDUP"]]
-			set ip_node [gen_params $ip_node $slave [list "C_TXMEM" "C_RXMEM" "C_TXCSUM" "C_RXCSUM" "C_MCAST_EXTEND" "C_STATS" "C_AVB"]]
-			set ip_node [gen_params $ip_node $slave [list "C_TXVLAN_TRAN" "C_RXVLAN_TRAN" "C_TXVLAN_TAG" "C_RXVLAN_TAG" "C_TXVLAN_STRP" "C_RXVLAN_STRP"]]
-			set ip_tree [list $ip_name tree $ip_node]
-			set mhs_handle [xget_hw_parent_handle $slave]
-			# See what the axi ethernet is connected to.
-			set axiethernet_busif_handle [xget_hw_busif_handle $slave "AXI_STR_RXD"]
-			set axiethernet_name [xget_hw_value $axiethernet_busif_handle]
-			set axiethernet_ip_handle [xget_hw_connected_busifs_handle $mhs_handle $axiethernet_name "TARGET"]
-			set axiethernet_ip_handle_name [xget_hw_name $axiethernet_ip_handle]
-			set connected_ip_handle [xget_hw_parent_handle $axiethernet_ip_handle]
-			set connected_ip_name [xget_hw_name $connected_ip_handle]
-			set connected_ip_type [xget_hw_value $connected_ip_handle]
-			set ip_tree [tree_append $ip_tree [list "axistream-connected" labelref $connected_ip_name]]
-			set ip_tree [tree_append $ip_tree [list "axistream-control-connected" labelref $connected_ip_name]]
-
-			set freq [get_clock_frequency $slave "S_AXI_ACLK"]
-			set ip_tree [tree_append $ip_tree [list "clock-frequency" int $freq]]
-
-			set ip_tree [tree_append $ip_tree [gen_mdiotree $slave]]
-
-			lappend node $ip_tree
-		}
-		"axi_dma" {
-			set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "" [default_parameters $slave]]
-			set mhs_handle [xget_hw_parent_handle $slave]
-			# See what the axi dma is connected to.
-			set axidma_busif_handle [xget_hw_busif_handle $slave "M_AXIS_MM2S"]
-			set axidma_name [xget_hw_value $axidma_busif_handle]
-			set axidma_ip_handle [xget_hw_connected_busifs_handle $mhs_handle $axidma_name "TARGET"]
-			set axidma_ip_handle_name [xget_hw_name $axidma_ip_handle]
-			set connected_ip_handle [xget_hw_parent_handle $axidma_ip_handle]
-			set connected_ip_name [xget_hw_name $connected_ip_handle]
-			set connected_ip_type [xget_hw_value $connected_ip_handle]
-			set ip_tree [tree_append $ip_tree [list "axistream-connected" labelref $connected_ip_name]]
-			set ip_tree [tree_append $ip_tree [list "axistream-control-connected" labelref $connected_ip_name]]
-			lappend node $ip_tree
-		}
-		# FIXME - this need to be check because can break axi ethernet implementation
-		"axi_dma-merged" {
-			set axiethernetfound 0
-			variable dma_device_id
-			set xdma "axi-dma"
-			set mhs_handle [xget_hw_parent_handle $slave]
-			set axidma_busif_handle [xget_hw_busif_handle $slave "M_AXIS_MM2S"]
-			set axidma_name [xget_hw_value $axidma_busif_handle]
-			set axidma_ip_handle [xget_hw_connected_busifs_handle $mhs_handle $axidma_name "TARGET"]
-			set axidma_ip_handle_name [xget_hw_name $axidma_ip_handle]
-			set connected_ip_handle [xget_hw_parent_handle $axidma_ip_handle]
-			set connected_ip_name [xget_hw_name $connected_ip_handle]
-			set connected_ip_type [xget_hw_value $connected_ip_handle]
-			if {[string compare $connected_ip_type "axi_ethernet"] == 0} {
-				set axiethernetfound 1
-			}
-			if {$axiethernetfound != 1} {
-				set hw_name [xget_hw_name $slave]
-
-				set baseaddr [scan_int_parameter_value $slave "C_BASEADDR"]
-				set highaddr [scan_int_parameter_value $slave "C_HIGHADDR"]
-
-				set mytree [list [format_ip_name "axidma" $baseaddr $hw_name] tree {}]
-
-				set tx_chan [scan_int_parameter_value $slave "C_INCLUDE_MM2S"]
-				if {$tx_chan == 1} {
-					set chantree [dma_channel_config $xdma $baseaddr "MM2S" $intc $slave $dma_device_id]
-					set mytree [tree_append $mytree $chantree]
-				}
+# Source handlers/<family>.tcl, once per interpreter
+proc load_handler_family {family} {
+	variable handler_dir
+	variable handler_families_loaded
 
-				set rx_chan [scan_int_parameter_value $slave "C_INCLUDE_S2MM"]
-				if {$rx_chan == 1} {
-					set chantree [dma_channel_config $xdma [expr $baseaddr + 0x30] "S2MM" $intc $slave $dma_device_id]
-					set mytree [tree_append $mytree $chantree]
-				}
+	if {[info exists handler_families_loaded($family)]} {
+		return
+	}
+	set handler_families_loaded($family) 1
+	set filepath [file join $handler_dir "$family.tcl"]
+	if {![file isfile $filepath]} {
+		return
+	}
+	namespace eval [namespace current] [list source $filepath]
+}
 
-				set mytree [tree_append $mytree [list \#size-cells int 1]]
-				set mytree [tree_append $mytree [list \#address-cells int 1]]
-				set mytree [tree_append $mytree [list compatible stringtuple [list "xlnx,axi-dma"]]]
-
-				set stsctrl 1
-				set sgdmamode1 1
-				set sgdmamode [xget_hw_parameter_handle $slave "C_INCLUDE_SG"]
-				if {$sgdmamode != ""} {
-					set sgdmamode1 [scan_int_parameter_value $slave "C_INCLUDE_SG"]
-					if {$sgdmamode1 == 0} {
-						set stsctrl 0
-						set mytree [tree_append $mytree [list "xlnx,sg-include-stscntrl-strm" hexint $stsctrl]]
-					} else {
-						set stsctrl [xget_hw_parameter_handle $slave "C_SG_INCLUDE_STSCNTRL_STRM"]
-						if {$stsctrl != ""} {
-							set stsctrl [scan_int_parameter_value $slave "C_SG_INCLUDE_STSCNTRL_STRM"]
-						} else {
-							set stsctrl 0
-						}
-						set mytree [tree_append $mytree [list "xlnx,sg-include-stscntrl-strm" hexint $stsctrl]]
-					}
-				} else {
-					set stsctrl [xget_hw_parameter_handle $slave "C_SG_INCLUDE_STSCNTRL_STRM"]
-					if {$stsctrl != ""} {
-						set stsctrl [scan_int_parameter_value $slave "C_SG_INCLUDE_STSCNTRL_STRM"]
-					} else {
-						set stsctrl 0
-					}
-					set mytree [tree_append $mytree [list "xlnx,sg-include-stscntrl-strm" hexint $stsctrl]]
-				}
-				set mytree [tree_append $mytree [gen_ranges_property $slave $baseaddr $highaddr $baseaddr]]
-				set mytree [tree_append $mytree [gen_reg_property $hw_name $baseaddr $highaddr]]
+proc slave_handler_info {type} {
+	variable slave_handler_info
 
-				lappend node $mytree
-			}
+	if {[info exists slave_handler_info($type)]} {
+		return $slave_handler_info($type)
+	}
+	return {}
+}
 
-			if {$axiethernetfound == 1} {
-				if {[catch {lappend node [slaveip_intr $slave $intc [interrupt_list $slave] "" [default_parameters $slave] "" ]} {error}]} {
-					debug warning $error
-				}
-			}
-			incr dma_device_id
+# Source file with additional handlers, once per run
+# The context keeps handler_file_types, the IP types the file registered
+# or changed, and handler_file_content, the file the cached nodes of
+# those types are keyed on.
+proc load_handler_file {filepath} {
+	variable slave_handlers
+	variable slave_handler_info
+	context_var handler_file_types handler_file_content
+
+	if {[string match "" $filepath] || ![visited_add handler_files [file normalize $filepath]]} {
+		return
+	}
+	if {[catch {open $filepath r} fd]} {
+		error "Handler file $filepath not found"
+	}
+	append handler_file_content [read $fd]
+	close $fd
+	debug info "Loading IP handlers from $filepath"
+	set before [array get slave_handlers]
+	set before_info [array get slave_handler_info]
+	namespace eval [namespace current] [list source $filepath]
+
+	array set handlers $before
+	array set info $before_info
+	foreach type [array names slave_handlers] {
+		if {![info exists handlers($type)] || $handlers($type) != $slave_handlers($type)
+			|| $info($type) != $slave_handler_info($type)} {
+			lappend handler_file_types $type
 		}
-		"axi_vdma" {
-			variable vdma_device_id
-			set xdma "axi-vdma"
-			set hw_name [xget_hw_name $slave]
+	}
+}
 
-			set baseaddr [scan_int_parameter_value $slave "C_BASEADDR"]
-			set highaddr [scan_int_parameter_value $slave "C_HIGHADDR"]
+# Generic handler driven by the registry metadata
+#     register_slave_handler my_core gen_slave_generic {compatible "vendor,my-core-1.0"}
+proc gen_slave_generic {node slave intc name type} {
+	array set info {devicetype "" params "" prefix "" compatible ""}
+	array set info [slave_handler_info $type]
+	lappend node [slaveip_intr $slave $intc [interrupt_list $slave] $info(devicetype) "[default_parameters $slave] $info(params)" $info(prefix) "" $info(compatible)]
+	return $node
+}
 
-			set mytree [list [format_ip_name "axivdma" $baseaddr $hw_name] tree {}]
-			set tx_chan [scan_int_parameter_value $slave "C_INCLUDE_MM2S"]
-			if {$tx_chan == 1} {
-				set chantree [dma_channel_config $xdma $baseaddr "MM2S" $intc $slave $vdma_device_id]
-				set mytree [tree_append $mytree $chantree]
-			}
+# IPs which are described elsewhere (memory node) or not at all
+proc gen_slave_skip {node slave intc name type} {
+	return $node
+}
 
-			set rx_chan [scan_int_parameter_value $slave "C_INCLUDE_S2MM"]
-			if {$rx_chan == 1} {
-				set chantree [dma_channel_config $xdma [expr $baseaddr + 0x30] "S2MM" $intc $slave $vdma_device_id]
-				set mytree [tree_append $mytree $chantree]
-			}
+# Interrupt controllers
+proc gen_slave_intc {node slave intc name type} {
+	# Interrupt controllers, cascaded ones report the controller their
+	# IRQ output is connected to
+	set tree [gen_intc $slave $intc "interrupt-controller" "C_NUM_INTR_INPUTS C_KIND_OF_INTR"]
+	lappend node [gen_interrupt_property $tree $slave $intc [list "IRQ"]]
+	return $node
+}
 
-			set mytree [tree_append $mytree [list \#size-cells int 1]]
-			set mytree [tree_append $mytree [list \#address-cells int 1]]
-			set mytree [tree_append $mytree [list compatible stringtuple [list "xlnx,axi-vdma"]]]
+# Microblaze debug module
+proc gen_slave_mdm {node slave intc name type} {
+	# Microblaze debug
 
-			set tmp [xget_hw_parameter_handle $slave "C_INCLUDE_SG"]
+	# Check if uart feature is enabled
+	set use_uart [hw_parameter_value $slave "C_USE_UART"]
+	if { "$use_uart" == "1" } {
+		set irq [check_console_irq $slave $intc]
 
-			if {$tmp != ""} {
-				set tmp [scan_int_parameter_value $slave "C_INCLUDE_SG"]
-				set mytree [tree_append $mytree [list "xlnx,include-sg" hexint $tmp]]
+		context_var alias_node_list
+		context_var consoleip
+		if { $irq != "-1"} {
+			set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "serial" [default_parameters $slave] "" "" "xlnx,xps-uartlite-1.00.a" ]
+			if {[string match -nocase $name $consoleip]} {
+				lappend alias_node_list [list serial0 aliasref $name 0]
+				tree_lappend ip_tree [list "port-number" int 0]
 			} else {
-				# older core always has SG
-				set mytree [tree_append $mytree [list "xlnx,include-sg" hexint 1]]
+				context_var serial_count
+				incr serial_count
+				lappend alias_node_list [list serial$serial_count aliasref $name $serial_count]
+				tree_lappend ip_tree [list "port-number" int $serial_count]
 			}
-
-			set tmp [scan_int_parameter_value $slave "C_NUM_FSTORES"]
-			set mytree [tree_append $mytree [list "xlnx,num-fstores" hexint $tmp]]
-
-			set tmp [scan_int_parameter_value $slave "C_FLUSH_ON_FSYNC"]
-			set mytree [tree_append $mytree [list "xlnx,flush-fsync" hexint $tmp]]
-
-			set mytree [tree_append $mytree [gen_ranges_property $slave $baseaddr $highaddr $baseaddr]]
-			set mytree [tree_append $mytree [gen_reg_property $hw_name $baseaddr $highaddr]]
-
-			lappend node $mytree
-			incr vdma_device_id
+		} else {
+			set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "serial" [default_parameters $slave] "" "" "xlnx,xps-uartlite-1.00.a" ]
 		}
-		"axi_cdma" {
-			set hw_name [xget_hw_name $slave]
-
-			set baseaddr [scan_int_parameter_value $slave "C_BASEADDR"]
-			set highaddr [scan_int_parameter_value $slave "C_HIGHADDR"]
-
-			set mytree [list [format_ip_name "axicdma" $baseaddr $hw_name] tree {}]
-			set namestring "dma-channel"
-			set channame [format_name [format "%s@%x" $namestring $baseaddr]]
+	} else {
+		# EDK 11.4 disables PLB connection when USE_UART is disabled that's why whole node won't be generated
+		# Only bus connected IPs are generated
+		set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "debug" [default_parameters $slave] "" "" "" ]
+		#"C_MB_DBG_PORTS C_UART_WIDTH C_USE_UART"
+	}
+	lappend node $ip_tree
+	return $node
+}
 
-			set chan {}
-			lappend chan [list compatible stringtuple [list "xlnx,axi-cdma-channel"]]
-			set tmp [scan_int_parameter_value $slave "C_INCLUDE_DRE"]
-			lappend chan [list "xlnx,include-dre" hexint $tmp]
+# UART Lite
+proc gen_slave_uartlite {node slave intc name type} {
+	#
+	# Add this uartlite device to the alias list
+	#
+	check_console_irq $slave $intc
 
-			set tmp [scan_int_parameter_value $slave "C_USE_DATAMOVER_LITE"]
-			lappend chan [list "xlnx,lite-mode" hexint $tmp]
+	set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "serial" [default_parameters $slave] ]
+	tree_lappend ip_tree [list "device_type" string "serial"]
 
-			set tmp [scan_int_parameter_value $slave "C_M_AXI_DATA_WIDTH"]
-			lappend chan [list "xlnx,datawidth" hexint $tmp]
+	context_var alias_node_list
+	context_var consoleip
+	if {[string match -nocase $name $consoleip]} {
+		lappend alias_node_list [list serial0 aliasref $name 0]
+		tree_lappend ip_tree [list "port-number" int 0]
+	} else {
+		context_var serial_count
+		incr serial_count
+		lappend alias_node_list [list serial$serial_count aliasref $name $serial_count]
+		tree_lappend ip_tree [list "port-number" int $serial_count]
+	}
 
-			set tmp [scan_int_parameter_value $slave "C_M_AXI_MAX_BURST_LEN"]
-			lappend chan [list "xlnx,max-burst-len" hexint $tmp]
+	tree_lappend ip_tree [list "current-speed" int [xget_sw_parameter_value $slave "C_BAUDRATE"]]
+	if { $type == "opb_uartlite"} {
+		tree_lappend ip_tree [list "clock-frequency" int [get_clock_frequency $slave "SOPB_Clk"]]
+	} elseif { $type == "xps_uartlite" } {
+		tree_lappend ip_tree [list "clock-frequency" int [get_clock_frequency $slave "SPLB_Clk"]]
+	} elseif { $type == "axi_uartlite" } {
+		tree_lappend ip_tree [list "clock-frequency" int [get_clock_frequency $slave "S_AXI_ACLK"]]
+	}
+	lappend node $ip_tree
+	#"BAUDRATE DATA_BITS CLK_FREQ ODD_PARITY USE_PARITY"]
+	return $node
+}
 
+# 16550 UARTs
+proc gen_slave_uart16550 {node slave intc name type} {
+	#
+	# Add this uart device to the alias list
+	#
+	check_console_irq $slave $intc
 
-			set chantree [list $channame tree $chan]
-			set chantree [gen_interrupt_property $chantree $slave $intc [list "cdma_introut"]]
+	context_var alias_node_list
+	context_var consoleip
+	if {[string match -nocase $name $consoleip]} {
+		lappend alias_node_list [list serial0 aliasref $name 0]
+	} else {
+		context_var serial_count
+		incr serial_count
+		lappend alias_node_list [list serial$serial_count aliasref $name $serial_count]
+	}
 
-			set mytree [tree_append $mytree $chantree]
+	set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "serial" [default_parameters $slave] "" "" [list "ns16550a"] ]
+	tree_lappend ip_tree [list "device_type" string "serial"]
+	tree_lappend ip_tree [list "current-speed" int "115200"]
+
+	# The 16550 cores usually use the bus clock as the baud
+	# reference, but can also take an external reference clock.
+	if { $type == "opb_uart16550"} {
+		set freq [get_clock_frequency $slave "OPB_Clk"]
+	} elseif { $type == "plb_uart16550"} {
+		set freq [get_clock_frequency $slave "PLB_Clk"]
+	} elseif { $type == "xps_uart16550"} {
+		set freq [get_clock_frequency $slave "SPLB_Clk"]
+	} elseif { $type == "axi_uart16550"} {
+		set freq [get_clock_frequency $slave "S_AXI_ACLK"]
+	}
+	set has_xin [scan_int_parameter_value $slave "C_HAS_EXTERNAL_XIN"]
+	if { $has_xin == "1" } {
+		set freq [get_clock_frequency $slave "xin"]
+	}
+	tree_lappend ip_tree [list "clock-frequency" int $freq]
 
-			set mytree [tree_append $mytree [list \#size-cells int 1]]
-			set mytree [tree_append $mytree [list \#address-cells int 1]]
-			set mytree [tree_append $mytree [list compatible stringtuple [list "xlnx,axi-cdma"]]]
+	tree_lappend ip_tree [list "reg-shift" int "2"]
+	if { $type == "axi_uart16550"} {
+		tree_lappend ip_tree [list "reg-offset" hexint [expr 0x1000]]
+	} else {
+		tree_lappend ip_tree [list "reg-offset" hexint [expr 0x1003]]
+	}
+	lappend node $ip_tree
+	#"BAUDRATE DATA_BITS CLK_FREQ ODD_PARITY USE_PARITY"]
+	return $node
+}
 
-			set tmp [scan_int_parameter_value $slave "C_INCLUDE_SG"]
-			set mytree [tree_append $mytree [list "xlnx,include-sg" hexint $tmp]]
+# Timebase watchdog
+proc gen_slave_timebase_wdt {node slave intc name type} {
+	set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "" [default_parameters $slave] ]
+	if { $type == "xps_timebase_wdt" } {
+		tree_lappend ip_tree [list "clock-frequency" int [get_clock_frequency $slave "SPLB_Clk"]]
+	} elseif { $type == "axi_timebase_wdt" } {
+		tree_lappend ip_tree [list "clock-frequency" int [get_clock_frequency $slave "S_AXI_ACLK"]]
+	}
+	lappend node $ip_tree
+	return $node
+}
 
-			set mytree [tree_append $mytree [gen_ranges_property $slave $baseaddr $highaddr $baseaddr]]
-			set mytree [tree_append $mytree [gen_reg_property $hw_name $baseaddr $highaddr]]
+# AXI/XPS/OPB timers, the first one can be the system timer
+proc gen_slave_timer {node slave intc name type} {
+	context_var timer
+	if {[ string match -nocase $name $timer ]} {
+		set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "system_timer" [default_parameters $slave] ]
+		set one_timer_only [hw_parameter_value $slave "C_ONE_TIMER_ONLY"]
+		if { $one_timer_only == "1" } {
+			error "Linux requires dual channel timer, but $name is set to single channel. Please configure the $name to dual channel"
+		}
+		set irq [get_intr $slave $intc "Interrupt"]
+		if { $irq == "-1" } {
+			error "Linux requires dual channel timer with interrupt connected. Please configure the $name to interrupt"
+		}
+		context_var microblaze_system_timer
+		set microblaze_system_timer $timer
+	} else {
+		set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "timer" [default_parameters $slave] ]
+	}
 
-			lappend node $mytree
-		}
-		"axi_tft" -
-		"xps_tft" {
-			lappend node [slaveip_dcr_or_plb $slave $intc "tft" [default_parameters $slave]]
-		}
-		"logi3d" -
-		"logiwin" -
-		"logibmp" {
-			lappend node [slaveip_intr $slave $intc [interrupt_list $slave] "" "[default_parameters $slave]" "REGS_"]
-		}
-		"logibayer" -
-		"logicvc" {
-			set params "C_VMEM_BASEADDR C_VMEM_HIGHADDR"
-			lappend node [slaveip_intr $slave $intc [interrupt_list $slave] "" "[default_parameters $slave] $params" "REGS_"]
-		}
-		"logibitblt" {
-			set params "C_BB_BASEADDR C_BB_HIGHADDR"
-			lappend node [slaveip_intr $slave $intc [interrupt_list $slave] "" "[default_parameters $slave] $params" "REGS_"]
-		}
+	# for version 1.01b of the xps timer, make sure that it has the patch applied to the h/w
+	# so that it's using an edge interrupt rather than a falling as described in AR 33880
+	# this is tracking a h/w bug in EDK 11.4 that should be fixed in the future
 
-		"plb_tft_cntlr_ref" -
-		"plb_dvi_cntlr_ref" {
-			# We handle this specially, since it is a DCR slave.
-			lappend node [slaveip_dcr $slave $intc "tft" [default_parameters $slave] "DCR_"]
-		}
-		"opb_ps2_dual_ref" {
-			# We handle this specially, to report the two independent
-			# ports.
-			set tree [compound_slave $slave]
-			set baseaddr [scan_int_parameter_value $slave "C_BASEADDR"]
-			set highaddr [scan_int_parameter_value $slave "C_HIGHADDR"]
-			set tree [tree_append $tree [gen_ranges_property $slave $baseaddr $highaddr 0]]
-			set tree [tree_append $tree [slaveip_in_compound_intr $slave $intc "Sys_Intr1" "ps2" "" 0 0x1000 0x40]]
-			set tree [tree_append $tree [slaveip_in_compound_intr $slave $intc "Sys_Intr2" "ps2" "" 1 0x1000 0x40]]
-			lappend node $tree
-		}
-		"xps_ps2" {
-			set baseaddr [scan_int_parameter_value $slave "C_BASEADDR"]
-			set highaddr [scan_int_parameter_value $slave "C_HIGHADDR"]
-			set is_dual [scan_int_parameter_value $slave "C_IS_DUAL"]
-
-			if {$is_dual == 1} {
-				# We handle this specially, to report the two independent
-				# ports.
-				set tree [compound_slave $slave]
-				set tree [tree_append $tree [gen_ranges_property $slave $baseaddr $highaddr 0]]
-				set tree [tree_append $tree [slaveip_in_compound_intr $slave $intc "IP2INTC_Irpt_1" "ps2" "" 0 0x1000 0x40]]
-				set tree [tree_append $tree [slaveip_in_compound_intr $slave $intc "IP2INTC_Irpt_2" "ps2" "" 1 0x1000 0x40]]
-				lappend node $tree
-			} else {
-				lappend node [slaveip_intr $slave $intc "IP2INTC_Irpt_1" "ps2" ""]
-			}
-		}
-		"opb_ac97_controller_ref" {
-			# We should handle this specially, to report the two
-			# interrupts in the right order.
-			lappend node [slaveip_intr $slave $intc "Playback_Interrupt Record_Interrupt" "ac97" ""]
-		}
-		"opb_gpio" -
-		"xps_gpio" -
-		"axi_gpio" {
-			# save gpio names and width for gpio reset code
-			global gpio_names
-			lappend gpio_names [list [xget_hw_name $slave] [scan_int_parameter_value $slave "C_GPIO_WIDTH"]]
-			# We should handle this specially, to report two ports.
-			set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "gpio" [default_parameters $slave]]
-			set ip_tree [tree_append $ip_tree [list "#gpio-cells" int "2"]]
-			set ip_tree [tree_append $ip_tree [list "gpio-controller" empty empty]]
-			lappend node $ip_tree
-		}
-		"opb_iic" -
-		"xps_iic" -
-		"axi_iic" {
-			# We should handle this specially, to report two ports.
-			lappend node [slaveip_intr $slave $intc [interrupt_list $slave] "i2c" [default_parameters $slave]]
-		}
-		"xps_spi" -
-		"axi_quad_spi" -
-		"axi_spi" {
-			# We will handle SPI FLASH here
-			global flash_memory flash_memory_bank
-			set tree [slaveip_intr $slave $intc [interrupt_list $slave] "spi" [default_parameters $slave] "" ]
-
-			if {[string match -nocase $flash_memory $name]} {
-				# Add the address-cells and size-cells to make the DTC compiler stop outputing warning
-				set tree [tree_append $tree [list "#address-cells" int "1"]]
-				set tree [tree_append $tree [list "#size-cells" int "0"]]
-				# If it is a SPI FLASH, we will add a SPI Flash
-				# subnode to the SPI controller
-				set subnode {}
-				# Set the SPI Flash chip select
-				lappend subnode [list "reg" hexinttuple [list $flash_memory_bank]]
-				# Set the SPI Flash clock freqeuncy
-				if { $type == "xps_spi" } {
-					set sys_clk [get_clock_frequency $slave "SPLB_Clk"]
-				} else {
-					set sys_clk [get_clock_frequency $slave "S_AXI_ACLK"]
-				}
-				set sck_ratio [scan_int_parameter_value $slave "C_SCK_RATIO"]
-				set sck [expr { $sys_clk / $sck_ratio }]
-				lappend subnode [list [format_name "spi-max-frequency"] int $sck]
-				set tree [tree_append $tree [list [format_ip_name $type $flash_memory_bank "primary_flash"] tree $subnode]]
-			}
-			lappend node $tree
+	set hw_ver [hw_parameter_value $slave "HW_VER"]
+	if { $hw_ver == "1.01.b" && $type == "xps_timer" } {
+		set port_handle [hw_port_handle $slave "Interrupt"]
+		set sensitivity [hw_subproperty_value $port_handle "SENSITIVITY"];
+		if { [string compare -nocase $sensitivity "EDGE_RISING"] != 0 } {
+			error "xps_timer version 1.01b must be patched to rising edge IRQ sensitivity. \
+				Please see Xilinx Answer Record 33880 at http://www.xilinx.com/support/answers/33880.htm \
+				and follow the instructions there."
 		}
-		"xps_usb_host" {
-			lappend node [slaveip_intr $slave $intc [interrupt_list $slave] "usb" [default_parameters $slave] "SPLB_" "" [list "usb-ehci"]]
-		}
-		"ps7_dma" {
-			set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" "arm,primecell arm,pl330"]
-			# use TCL table
-			set ip_tree [zynq_irq $ip_tree $intc $name]
-			set ip_tree [tree_append $ip_tree [list "#dma-cells" int "1"]]
-			set ip_tree [tree_append $ip_tree [list "#dma-channels" int "8"]]
-			set ip_tree [tree_append $ip_tree [list "#dma-requests" int "4"]]
-			set ip_tree [tree_append $ip_tree [list "arm,primecell-periphid" hexint "0x00041330"]];
-
-			lappend node $ip_tree
-		}
-		"ps7_slcr" {
-			set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" "xlnx,zynq-slcr"]
-			# use TCL table
-			set ip_tree [zynq_irq $ip_tree $intc $name]
-
-			set clock_tree [list "clocks" tree {}]
-			set clock_tree [tree_append $clock_tree [list "#address-cells" int "1"]]
-			set clock_tree [tree_append $clock_tree [list "#size-cells" int "0"]]
-
-			# PS_CLK node creation
-			set subclk_tree [list "ps_clk: ps_clk" tree {}]
-			set subclk_tree [tree_append $subclk_tree [list "#clock-cells" int "0"]]
-			set subclk_tree [tree_append $subclk_tree [list "compatible" stringtuple "fixed-clock"]]
-			set subclk_tree [tree_append $subclk_tree [list "clock-output-names" stringtuple "ps_clk"]]
-			set subclk_tree [tree_append $subclk_tree [list "clock-frequency" int "33333333"]]
-			set clock_tree [tree_append $clock_tree $subclk_tree]
-
-			set subclk_tree [list "armpll: armpll" tree {}]
-			set subclk_tree [tree_append $subclk_tree [list "#clock-cells" int "0"]]
-			set subclk_tree [tree_append $subclk_tree [list "compatible" stringtuple "xlnx,zynq-pll"]]
-			set subclk_tree [tree_append $subclk_tree [list "clocks" labelref "ps_clk"]]
-			set subclk_tree [tree_append $subclk_tree [list "reg" hexinttuple [list "0x100" "0x110" "0x10c"]]]
-			set subclk_tree [tree_append $subclk_tree [list "lockbit" int "0"]]
-			set subclk_tree [tree_append $subclk_tree [list "clock-output-names" stringtuple "armpll"]]
-			set clock_tree [tree_append $clock_tree $subclk_tree]
-
-			set subclk_tree [list "ddrpll: ddrpll" tree {}]
-			set subclk_tree [tree_append $subclk_tree [list "#clock-cells" int "0"]]
-			set subclk_tree [tree_append $subclk_tree [list "compatible" stringtuple "xlnx,zynq-pll"]]
-			set subclk_tree [tree_append $subclk_tree [list "clocks" labelref "ps_clk"]]
-			set subclk_tree [tree_append $subclk_tree [list "reg" hexinttuple [list "0x104" "0x114" "0x10c"]]]
-			set subclk_tree [tree_append $subclk_tree [list "lockbit" int "1"]]
-			set subclk_tree [tree_append $subclk_tree [list "clock-output-names" stringtuple "ddrpll"]]
-			set clock_tree [tree_append $clock_tree $subclk_tree]
-
-			set subclk_tree [list "iopll: iopll" tree {}]
-			set subclk_tree [tree_append $subclk_tree [list "#clock-cells" int "0"]]
-			set subclk_tree [tree_append $subclk_tree [list "compatible" stringtuple "xlnx,zynq-pll"]]
-			set subclk_tree [tree_append $subclk_tree [list "clocks" labelref "ps_clk"]]
-			set subclk_tree [tree_append $subclk_tree [list "reg" hexinttuple [list "0x108" "0x118" "0x10c"]]]
-			set subclk_tree [tree_append $subclk_tree [list "lockbit" int "2"]]
-			set subclk_tree [tree_append $subclk_tree [list "clock-output-names" stringtuple "iopll"]]
-			set clock_tree [tree_append $clock_tree $subclk_tree]
-
-			set ip_tree [tree_append $ip_tree $clock_tree]
-
-			lappend node $ip_tree
-		}
-		"ps7_can" -
-		"ps7_iop_bus_config" -
-		"ps7_qspi_linear" -
-		"ps7_ddrc" -
-		"ps7_dev_cfg" {
-			set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" ""]
-			# use TCL table
-			set ip_tree [zynq_irq $ip_tree $intc $name]
-
-			lappend node $ip_tree
-		}
-		"ps7_gpio" {
-			set count 32
-			set ip_tree [slaveip $slave $intc "" "" "S_AXI_" ""]
-			set ip_tree [tree_append $ip_tree [list "emio-gpio-width" int [xget_sw_parameter_value $slave "C_EMIO_GPIO_WIDTH"]]]
-			set gpiomask [xget_sw_parameter_value $slave "C_MIO_GPIO_MASK"]
-			set mask [expr {$gpiomask & 0xffffffff}]
-			set ip_tree [tree_append $ip_tree [list "gpio-mask-low" hexint $mask]]
-			set mask [expr {$gpiomask>>$count}]
-			set mask [expr {$mask & 0xffffffff}]
-			set ip_tree [tree_append $ip_tree [list "gpio-mask-high" hexint $mask]]
-			set ip_tree [zynq_irq $ip_tree $intc $name]
-
-			set ip_tree [tree_append $ip_tree [list "#gpio-cells" int "2"]]
-			set ip_tree [tree_append $ip_tree [list "gpio-controller" empty empty]]
-
-			lappend node $ip_tree
-		}
-		"ps7_i2c" {
-			set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" ""]
-			# use TCL table
-			set ip_tree [zynq_irq $ip_tree $intc $name]
-
-			variable ps7_i2c_count
-			variable ps7_cortexa9_clk
-			set ip_tree [tree_append $ip_tree [list "input-clk" int [expr $ps7_cortexa9_clk/6]]]
-			set ip_tree [tree_append $ip_tree [list "i2c-clk" int 400000]]
-			set ip_tree [tree_append $ip_tree [list "bus-id" int $ps7_i2c_count]]
-			incr ps7_i2c_count
-
-			lappend node $ip_tree
-		}
-		"ps7_ttc" {
-			set ip_tree [slaveip $slave $intc "" "" "S_AXI_" "cdns,ttc"]
-			# use TCL table
-			set ip_tree [zynq_irq $ip_tree $intc $name]
-
-			lappend node $ip_tree
-		}
-		"ps7_scutimer" {
-			set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" ""]
-			# use TCL table
-			set ip_tree [zynq_irq $ip_tree $intc $name]
-
-			set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" "arm,cortex-a9-twd-timer"]
-			set ip_tree [zynq_irq $ip_tree $intc $name]
-
-			lappend node $ip_tree
-		}
-		"ps7_qspi" {
-			set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" ""]
-			# use TCL table
-			set ip_tree [zynq_irq $ip_tree $intc $name]
-
-			variable ps7_spi_count
-			set ip_tree [tree_append $ip_tree [list "speed-hz" int [xget_sw_parameter_value $slave "C_QSPI_CLK_FREQ_HZ"]]]
-			set ip_tree [tree_append $ip_tree [list "bus-num" int $ps7_spi_count]]
-			set ip_tree [tree_append $ip_tree [list "num-chip-select" int 1]]
-			set qspi_mode [xget_sw_parameter_value $slave "C_QSPI_MODE"]
-			if { $qspi_mode == 2} {
-				set is_dual 1
-			} else {
-				set is_dual 0
-			}
-			set ip_tree [tree_append $ip_tree [list "is-dual" int $is_dual]]
-			incr ps7_spi_count
+	}
+	#"C_COUNT_WIDTH C_ONE_TIMER_ONLY"]
+
+	# axi_timer runs at bus frequency, whereas plb and opb timers run at cpu fruquency. The timer driver
+	# in microblaze kernel uses the 'clock-frequency' property, if there is one available; otherwise it
+	# uses cpu frequency. For axi_timer, generate the 'clock-frequency' property with bus frequency as
+	# it's value
+	if { $type == "axi_timer"} {
+		set freq [get_clock_frequency $slave "S_AXI_ACLK"]
+		tree_lappend ip_tree [list "clock-frequency" int $freq]
+	}
+	lappend node $ip_tree
+	return $node
+}
 
-			# We will handle SPI FLASH here
-			global flash_memory flash_memory_bank
+# GPIO
+proc gen_slave_gpio {node slave intc name type} {
+	# save gpio names and width for gpio reset code
+	context_var gpio_names
+	lappend gpio_names [list [hw_name $slave] [scan_int_parameter_value $slave "C_GPIO_WIDTH"]]
+	# We should handle this specially, to report two ports.
+	set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "gpio" [default_parameters $slave]]
+	tree_lappend ip_tree [list "#gpio-cells" int "2"]
+	tree_lappend ip_tree [list "gpio-controller" empty empty]
+	lappend node $ip_tree
+	return $node
+}
 
-			if {[string match -nocase $flash_memory $name]} {
-				# Add the address-cells and size-cells to make the DTC compiler stop outputing warning
-				set ip_tree [tree_append $ip_tree [list "#address-cells" int "1"]]
-				set ip_tree [tree_append $ip_tree [list "#size-cells" int "0"]]
-				# If it is a SPI FLASH, we will add a SPI Flash
-				# subnode to the SPI controller
-				set subnode {}
-				# Set the SPI Flash chip select
-				lappend subnode [list "reg" hexinttuple [list $flash_memory_bank]]
-				# Set the SPI Flash clock frequency, assume it will be
-				# 1/4 of the QSPI controller frequency.
-				# Note this is not the actual maximum SPI flash frequency
-				# as we can't know.
-				lappend subnode [list [format_name "spi-max-frequency"] int [expr [xget_sw_parameter_value $slave "C_QSPI_CLK_FREQ_HZ"]/4]]
-				set ip_tree [tree_append $ip_tree [list [format_ip_name $type $flash_memory_bank "primary_flash"] tree $subnode]]
-			}
-
-			lappend node $ip_tree
-		}
-		"ps7_wdt" {
-			set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" ""]
-			# use TCL table
-			set ip_tree [zynq_irq $ip_tree $intc $name]
-
-			set ip_tree [tree_append $ip_tree [list "device_type" string "watchdog"]]
-			set ip_tree [tree_append $ip_tree [list "reset" int 0]]
-			set ip_tree [tree_append $ip_tree [list "timeout" int 10]]
-
-			lappend node $ip_tree
-		}
-		"ps7_scuwdt" {
-			set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" ""]
-			# use TCL table
-			set ip_tree [zynq_irq $ip_tree $intc $name]
-
-			set ip_tree [tree_append $ip_tree [list "device_type" string "watchdog"]]
-
-			lappend node $ip_tree
-		}
-		"ps7_usb" {
-			set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" ""]
-			# use TCL table
-			set ip_tree [zynq_irq $ip_tree $intc $name]
-
-			set ip_tree [tree_append $ip_tree [list "dr_mode" string "host"]]
-			set ip_tree [tree_append $ip_tree [list "phy_type" string "ulpi"]]
-
-			lappend node $ip_tree
-		}
-		"ps7_spi" {
-			set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" ""]
-			# use TCL table
-			set ip_tree [zynq_irq $ip_tree $intc $name]
-
-			variable ps7_spi_count
-			set ip_tree [tree_append $ip_tree [list "speed-hz" int [xget_sw_parameter_value $slave "C_SPI_CLK_FREQ_HZ"]]]
-			set ip_tree [tree_append $ip_tree [list "bus-num" int $ps7_spi_count]]
-			set ip_tree [tree_append $ip_tree [list "num-chip-select" int 4]]
-			incr ps7_spi_count
-			# We will handle SPI FLASH here
-			global flash_memory flash_memory_bank
-
-			if {[string match -nocase $flash_memory $name]} {
-				# Add the address-cells and size-cells to make the DTC compiler stop outputing warning
-				set ip_tree [tree_append $ip_tree [list "#address-cells" int "1"]]
-				set ip_tree [tree_append $ip_tree [list "#size-cells" int "0"]]
-				# If it is a SPI FLASH, we will add a SPI Flash
-				# subnode to the SPI controller
-				set subnode {}
-				# Set the SPI Flash chip select
-				lappend subnode [list "reg" hexinttuple [list $flash_memory_bank]]
-				# Set the SPI Flash clock freqeuncy
-				# hardcode this spi-max-frequency (based on board_zc770_xm010.c)
-				lappend subnode [list [format_name "spi-max-frequency"] int 75000000]
-				set ip_tree [tree_append $ip_tree [list [format_ip_name $type $flash_memory_bank "primary_flash"] tree $subnode]]
-			}
+# IIC
+proc gen_slave_iic {node slave intc name type} {
+	# We should handle this specially, to report two ports.
+	lappend node [slaveip_intr $slave $intc [interrupt_list $slave] "i2c" [default_parameters $slave]]
+	return $node
+}
 
-			lappend node $ip_tree
-		}
-		"ps7_sdio" {
-			set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" "generic-sdhci"]
-			# FIXME linux sdhci requires clock-frequency even if we use common clock framework
-			set ip_tree [tree_append $ip_tree [list "clock-frequency" int [xget_sw_parameter_value $slave "C_SDIO_CLK_FREQ_HZ"]]]
-			set ip_tree [zynq_irq $ip_tree $intc $name]
-			lappend node $ip_tree
+# SPI
+proc gen_slave_spi {node slave intc name type} {
+	# We will handle SPI FLASH here
+	context_var flash_memory flash_memory_bank
+	set tree [slaveip_intr $slave $intc [interrupt_list $slave] "spi" [default_parameters $slave] "" ]
+
+	if {[string match -nocase $flash_memory $name]} {
+		# Add the address-cells and size-cells to make the DTC compiler stop outputing warning
+		tree_lappend tree [list "#address-cells" int "1"]
+		tree_lappend tree [list "#size-cells" int "0"]
+		# If it is a SPI FLASH, we will add a SPI Flash
+		# subnode to the SPI controller
+		set subnode {}
+		# Set the SPI Flash chip select
+		lappend subnode [list "reg" hexinttuple [list $flash_memory_bank]]
+		# Set the SPI Flash clock freqeuncy
+		if { $type == "xps_spi" } {
+			set sys_clk [get_clock_frequency $slave "SPLB_Clk"]
+		} else {
+			set sys_clk [get_clock_frequency $slave "S_AXI_ACLK"]
 		}
-		"ps7_smcc" {
-			set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" "xlnx,ps7-smc"]
-
-			# use TCL table
-			set ip_tree [zynq_irq $ip_tree $intc $type]
-
-			variable ps7_smcc_list
-			if {![string match "" $ps7_smcc_list]} {
-				set ip_tree [tree_append $ip_tree [list "#address-cells" int "1"]]
-				set ip_tree [tree_append $ip_tree [list "#size-cells" int "1"]]
-				set ip_tree [tree_append $ip_tree [list ranges empty empty]]
+		set sck_ratio [scan_int_parameter_value $slave "C_SCK_RATIO"]
+		set sck [expr { $sys_clk / $sck_ratio }]
+		lappend subnode [list [format_name "spi-max-frequency"] int $sck]
+		tree_lappend tree [list [format_ip_name $type $flash_memory_bank "primary_flash"] tree $subnode]
+	}
+	lappend node $tree
+	return $node
+}
 
-				set ip_tree [tree_append $ip_tree $ps7_smcc_list]
-			}
+# AXI to AXI bridge
+proc gen_slave_axi2axi_connector {node slave intc name type} {
+	# FIXME: multiple ranges!
+	set baseaddr [scan_int_parameter_value $slave "C_S_AXI_RNG00_BASEADDR"]
+	set tree [bus_bridge $slave $intc $baseaddr "M_AXI"]
 
-			lappend node $ip_tree
-		}
-		"ps7_nand" {
-			# just C_S_AXI_BASEADDR  C_S_AXI_HIGHADDR C_NAND_CLK_FREQ_HZ C_NAND_MODE C_INTERCONNECT_S_AXI_MASTERS HW_VER INSTANCE
-			set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" ""]
+	if {[llength $tree] != 0} {
+		set ranges_list [default_ranges $slave "C_S_AXI_NUM_ADDR_RANGES" "C_S_AXI_RNG%02d_BASEADDR" "C_S_AXI_RNG%02d_HIGHADDR"]
+		tree_lappend tree [gen_ranges_property_list $slave $ranges_list [tree_cells $tree]]
+		lappend node $tree
+	}
+	return $node
+}
 
-			# FIXME: set reg size to 16MB. This is a workaround for 14.4
-			# tools provides the wrong high address of NAND
-			set baseaddr [scan_int_parameter_value $slave "C_S_AXI_BASEADDR"]
-			set ip_tree [tree_node_update $ip_tree "reg" [list "reg" hexinttuple [list $baseaddr "16777216" ]]]
+# Other Microblaze CPUs
+proc gen_slave_microblaze {node slave intc name type} {
+	debug ip "Other Microblaze CPU $name=$type"
+	lappend node [gen_microblaze $slave [default_parameters $slave]]
+	return $node
+}
 
-			global flash_memory
-			if {[ string match -nocase $name $flash_memory ]} {
-				set ip_tree [change_nodename $ip_tree $name "primary_flash"]
+# *Most* IP should be handled by this default handler. The node is
+# composed from BASEADDR/HIGHADDR parameter pairs of the IP.
+proc gen_slave_default {node slave intc name type} {
+	# *Most* IP should be handled by this default case.
+	# check if is any parameter BASEADDR
+	set ip_params [hw_parameter_handle $slave "*"]
+	set address_array {}
+	set ranges_list {}
+	puts [hw_name $slave]
+	foreach par_name $ip_params {
+		# check all
+		set addrtype [hw_subproperty_value $par_name "ADDRESS"]
+		if {[string compare -nocase $addrtype "BASE"] == 0} {
+			set base [hw_name $par_name]
+			set high [hw_subproperty_value $par_name "PAIR"]
+			set baseaddr [scan_int_parameter_value $slave $base]
+			set highaddr [scan_int_parameter_value $slave $high]
+			if { "${baseaddr}" < "${highaddr}" } {
+				lappend address_array $par_name
+				# Also compound ranges list with all BASEADDR and HIGHADDR pairs
+				lappend ranges_list [list $baseaddr $highaddr $baseaddr]
 			}
-
-			variable ps7_smcc_list
-
-			set ps7_smcc_list "$ps7_smcc_list $ip_tree"
-		}
-		"ps7_nor" -
-		"ps7_sram" {
-			# NOTE: For 14.4, the ps7_sram_* is refer to NOR flash not SRAM
-			global flash_memory
-			if {[ string match -nocase $name $flash_memory ]} {
-				set ip_tree [slaveip $slave $intc "flash" [default_parameters $slave] "S_AXI_" "cfi-flash"]
-				set ip_tree [change_nodename $ip_tree $name "primary_flash"]
-			} else {
-				set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" "cfi-flash"]
-			}
-
-			set ip_tree [tree_append $ip_tree [list "bank-width" int 1]]
-
-			regsub -all "ps7_sram" $ip_tree "ps7_nor" ip_tree
-			regsub -all "ps7-sram" $ip_tree "ps7-nor" ip_tree
-
-			variable ps7_smcc_list
-			set ps7_smcc_list "$ps7_smcc_list $ip_tree"
-		}
-		"ps7_scugic" {
-			# FIXME this node should be provided by SDK and not to compose it by hand
-
-			# just test code to show all interrupts
-#			set port_handles [xget_hw_port_handle $slave "*"]
-#			foreach i $port_handles {
-#				set signals [xget_hw_port_value $slave [xget_hw_name $i]]
-#				puts "$i [xget_hw_name $i] -- $signals --"
-#			}
-
-			# Replace _ with - in type to be compatible
-			regsub -all "_" $type "-" type
-
-			# Add interrupt distributor because it is not detected
-			set tree [list "$name: $type@f8f01000" tree \
-					[list \
-						[gen_compatible_property $name $type [xget_hw_parameter_value $slave "HW_VER"] "arm,cortex-a9-gic arm,gic" ] \
-						[list "reg" hexinttuple [list "0xF8F01000" "0x1000" "0xF8F00100" "0x100"] ] \
-						[list "#interrupt-cells" inttuple "3" ] \
-						[list "#address-cells" inttuple "2" ] \
-						[list "#size-cells" inttuple "1" ] \
-						[list "interrupt-controller" empty empty ] \
-						[list "linux,phandle" hexinttuple "0x1" ] \
-						[list "phandle" hexinttuple "0x1" ] \
-					] \
-				]
-			lappend node $tree
-
-#			lappend node [gen_intc $slave "" "interrupt-controller" [default_parameters $slave] "S_AXI_" "arm,gic"]
-		}
-		"ps7_pl310" {
-			set tree [list "ps7_pl310_0: ps7-pl310@f8f02000" tree \
-					[list \
-						[gen_compatible_property "ps7_pl310" "ps7_pl310" "1.00.a" "arm,pl310-cache" ] \
-						[list "cache-unified" empty empty ] \
-						[list "cache-level" inttuple "2" ] \
-						[list "reg" hexinttuple [list "0xF8F02000" "0x1000"] ] \
-						[list "arm,data-latency" inttuple [list "3" "2" "2"] ] \
-						[list "arm,tag-latency" inttuple [list "2" "2" "2"] ] \
-					] \
-				]
-			set tree [zynq_irq $tree $intc $name]
-			lappend node $tree
-		}
-		"ps7_xadc" {
-			set tree [list "ps7_xadc: ps7-xadc@f8007100" tree \
-					[list \
-						[gen_compatible_property "ps7_xadc" "ps7_xadc" "1.00.a" ] \
-						[list "reg" hexinttuple [list "0xF8007100" "0x20"] ] \
-					] \
-				]
-			set tree [zynq_irq $tree $intc $name]
-			lappend node $tree
 		}
-		"ps7_trace" -
-		"ps7_ddr" {
-			# Do nothing
-		}
-		"ps7_ethernet" {
-			variable ethernet_count
-			variable alias_node_list
-			set alias_node [list ethernet$ethernet_count aliasref $name $ethernet_count]
-			lappend alias_node_list $alias_node
-			incr ethernet_count
-
-			set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" ""]
-			set ip_tree [zynq_irq $ip_tree $intc $name]
-			set ip_tree [tree_append $ip_tree [list "local-mac-address" bytesequence [list 0x00 0x0a 0x35 0x00 0x00 $mac_count]]]
-			incr mac_count
-
-			set ip_tree [tree_append $ip_tree [list "#address-cells" int "1"]]
-			set ip_tree [tree_append $ip_tree [list "#size-cells" int "0"]]
-			set phy_name "phy$phy_count"
-			set ip_tree [tree_append $ip_tree [list "phy-handle" labelref $phy_name]]
-
-			set mdio_tree [list "mdio" tree {}]
-			set mdio_tree [tree_append $mdio_tree [list \#size-cells int 0]]
-			set mdio_tree [tree_append $mdio_tree [list \#address-cells int 1]]
-			set phya 7
-			set phy_chip "marvell,88e1116r"
-			set mdio_tree [tree_append $mdio_tree [gen_phytree $slave $phya $phy_chip]]
-
-			set phya [is_gmii2rgmii_conv_present $slave]
-			if { $phya != "-1" } {
-				set phy_name "phy$phy_count"
-				set ip_tree [tree_append $ip_tree [list "gmii2rgmii-phy-handle" labelref $phy_name]]
-				set phy_chip "xlnx,gmii2rgmii"
-				set mdio_tree [tree_append $mdio_tree [gen_phytree $slave $phya $phy_chip]]
-			}
-			set ip_tree [tree_append $ip_tree $mdio_tree]
-
-			variable ps7_cortexa9_1x_clk
-			set ip_tree [tree_append $ip_tree [list "xlnx,ptp-enet-clock" int $ps7_cortexa9_1x_clk]]
-
-			set phymode [scan_int_parameter_value $slave "C_ETH_MODE"]
-			if { $phymode == 0 } {
-				set ip_tree [tree_append $ip_tree [list "phy-mode" string "gmii"]]
-			} else {
-				set ip_tree [tree_append $ip_tree [list "phy-mode" string "rgmii-id"]]
-			}
-
-			lappend node $ip_tree
-		}
-		"axi_fifo_mm_s" {
-			set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "" [default_parameters $slave]]
-			lappend node $ip_tree
-		}
-		"ps7_ram" {
-			if {"$name" == "ps7_ram_0"} {
-				set ip_tree [slaveip $slave $intc "" "" "S_AXI_" "xlnx,ps7-ocm"]
-				set ip_tree [tree_node_update $ip_tree "reg" [list "reg" hexinttuple [list "0xfffc0000" "262144" ]]]
-				# use TCL table
-				set ip_tree [zynq_irq $ip_tree $intc $name]
-
-				lappend node $ip_tree
-			}
-		}
-		"plb_bram_if_cntlr" -
-		"opb_bram_if_cntlr" -
-		"axi_bram_ctrl" -
-		"opb_cypress_usb" -
-		"plb_ddr" -
-		"plb_ddr2" -
-		"opb_sdram" -
-		"opb_ddr" -
-		"mch_opb_ddr" -
-		"mch_opb_ddr2" -
-		"mch_opb_sdram" -
-		"ppc440mc_ddr2" -
-		"axi_s6_ddrx" -
-		"axi_v6_ddrx" -
-		"axi_7series_ddrx" -
-		"mig_7series" {
-			# Do nothing..  this is handled by the 'memory' special case.
-		}
-		"opb_emc" -
-		"plb_emc" -
-		"mch_opb_emc" -
-		"xps_mch_emc" {
-			global main_memory main_memory_bank
-			# Handle flash memories with 'banks'. Generate one flash node
-			# for each bank, if necessary.  If not connected to flash,
-			# then do nothing.
-			set count [scan_int_parameter_value $slave "C_NUM_BANKS_MEM"]
-			if { [llength $count] == 0 } {
-				set count 1
-			}
-			for {set x 0} {$x < $count} {incr x} {
-
-				# Make sure we didn't already register this guy as the main memory.
-				# see main handling in gen_memories
-				if {[ string match -nocase $name $main_memory ] && $x == $main_memory_bank } {
-					continue;
-				}
-				global flash_memory flash_memory_bank
-				set baseaddr_prefix [format "MEM%d_" $x]
-				set tree [slaveip_intr $slave $intc [interrupt_list $slave] "flash" [default_parameters $slave] $baseaddr_prefix "" "cfi-flash"]
-
-				# Flash needs a bank-width attribute.
-				set datawidth [scan_int_parameter_value $slave [format "C_%sWIDTH" $baseaddr_prefix]]
-				set tree [tree_append $tree [list "bank-width" int "[expr ($datawidth/8)]"]]
-
-				# If it is a set as the system Flash memory, change the name of this node to PetaLinux standard system Flash emmory name
-				if {[ string match -nocase $name $flash_memory ] && $x == $flash_memory_bank} {
-					set tree [change_nodename $tree $name "primary_flash"]
-				}
-				lappend node $tree
-			}
-		}
-		"axi_emc" {
-			# Handle flash memories with 'banks'. Generate one flash node
-			# for each bank, if necessary.  If not connected to flash,
-			# then do nothing.
-			set count [scan_int_parameter_value $slave "C_NUM_BANKS_MEM"]
-			if { [llength $count] == 0 } {
-				set count 1
-			}
-			for {set x 0} {$x < $count} {incr x} {
-
-				set synch_mem [scan_int_parameter_value $slave [format "C_MEM%d_TYPE" $x]]
-				# C_MEM$x_TYPE = 2 or 3 indicates the bank handles
-				# a flash device and it should be listed as a
-				# slave in fdt.
-				# C_MEM$x_TYPE = 0, 1 or 4 indicates the bank handles
-				# SRAM and it should be listed as a memory in
-				# fdt.
-
-				global main_memory main_memory_bank
-				# Make sure we didn't already register this guy as the main memory.
-				# see main handling in gen_memories
-				if {[ string match -nocase $name $main_memory ] && $x == $main_memory_bank } {
-					if { $synch_mem == 0 || $synch_mem == 1 || $synch_mem == 4 } {
-						continue;
-					}
-				}
-
-				set baseaddr_prefix [format "S_AXI_MEM%d_" $x]
-				if { $synch_mem == 2 || $synch_mem == 3 } {
-					set tree [slaveip_intr $slave $intc [interrupt_list $slave] "flash" [default_parameters $slave] $baseaddr_prefix "" "cfi-flash"]
-				} else {
-					set tree [slaveip_intr $slave $intc [interrupt_list $slave] "memory" [default_parameters $slave] $baseaddr_prefix "" ""]
-				}
-
-				# Flash needs a bank-width attribute.
-				set datawidth [scan_int_parameter_value $slave [format "C_MEM%d_WIDTH" $x]]
-				set tree [tree_append $tree [list "bank-width" int "[expr ($datawidth/8)]"]]
+	}
 
-				# If it is a set as the system Flash memory, change the name of this node to PetaLinux standard system Flash emmory name
-				global flash_memory flash_memory_bank
-				if {[ string match -nocase $name $flash_memory ] && $x == $flash_memory_bank} {
-					set tree [change_nodename $tree $name "primary_flash"]
-				}
-				lappend node $tree
-			}
-		}
-		"mpmc" {
-			# We should handle this specially, to report the DMA
-			# ports.  This is a hack that happens to work for the
-			# design I have.  Note that we don't use the default
-			# parameters here because of the slew of parameters the
-			# mpmc has.
-			lappend node [slave_mpmc $slave $intc]
-		}
-		"opb2plb_bridge" {
-			# Hmm.. how do we represent this?
-			#	lappend node [bus_bridge $slave $intc "MPLB" "C_RNG"]
-		}
-		"plb2opb_bridge" -
-		"plbv46_opb_bridge" {
-			set baseaddr [scan_int_parameter_value $slave "C_RNG0_BASEADDR"]
-			set tree [bus_bridge $slave $intc $baseaddr "MOPB"]
-			set ranges_list [default_ranges $slave "C_NUM_ADDR_RNG" "C_RNG%d_BASEADDR" "C_RNG%d_HIGHADDR"]
-			set tree [tree_append $tree [gen_ranges_property_list $slave $ranges_list]]
-			lappend node $tree
-		}
-		"plbv46_axi_bridge" {
-			# Fix me -- how do we represent this?
-		}
-		"axi_plbv46_bridge" {
-			set baseaddr [scan_int_parameter_value $slave "C_S_AXI_RNG1_BASEADDR"]
-			set tree [bus_bridge $slave $intc $baseaddr "MPLB"]
-			set ranges_list [default_ranges $slave "C_S_AXI_NUM_ADDR_RANGES" "C_S_AXI_RNG%d_BASEADDR" "C_S_AXI_RNG%d_HIGHADDR" "1"]
-			set tree [tree_append $tree [gen_ranges_property_list $slave $ranges_list]]
+	switch [llength $address_array] {
+		"0" {
+			# maybe just IP just with interrupt line
+			set name [hw_name $slave]
+			set type [hw_value $slave]
+			set tree [slaveip_basic $slave $intc [default_parameters $slave] [format_ip_name $type "0" $name] ""]
+			set tree [gen_interrupt_property $tree $slave $intc [interrupt_list $slave]]
 			lappend node $tree
 		}
-		"plbv46_plbv46_bridge" {
-			# FIXME: multiple ranges!
-			set baseaddr [scan_int_parameter_value $slave "C_RNG0_BASEADDR"]
-			set tree [bus_bridge $slave $intc $baseaddr "MPLB"]
-			set ranges_list [default_ranges $slave "C_NUM_ADDR_RNG" "C_RNG%d_BASEADDR" "C_RNG%d_HIGHADDR"]
-			set tree [tree_append $tree [gen_ranges_property_list $slave $ranges_list]]
+		"1" {
+			# address_array has only one baseaddr which means that it is single node
+			set par_name $address_array
+			set base [hw_name $par_name]
+			set high [hw_subproperty_value $par_name "PAIR"]
+			set baseaddr [scan_int_parameter_value $slave $base]
+			set highaddr [scan_int_parameter_value $slave $high]
+			set tree [slaveip_explicit_baseaddr $slave $intc "" [default_parameters $slave] $baseaddr $highaddr ""]
+			set tree [gen_interrupt_property $tree $slave $intc [interrupt_list $slave]]
 			lappend node $tree
 		}
-		"opb_opb_lite" {
-			# FIXME: multiple ranges!
-			set baseaddr [scan_int_parameter_value $slave "C_DEC0_BASEADDR"]
-			set tree [bus_bridge $slave $intc $baseaddr "MOPB"]
-			set ranges_list [default_ranges $slave "C_NUM_DECODES" "C_DEC%d_BASEADDR" "C_DEC%d_HIGHADDR"]
-			set tree [tree_append $tree [gen_ranges_property_list $slave $ranges_list]]
-			lappend node $tree
-		}
-		"opb2dcr_bridge" -
-		"plbv46_dcr_bridge" {
-			set baseaddr [scan_int_parameter_value $slave "C_BASEADDR"]
-			set highaddr [scan_int_parameter_value $slave "C_HIGHADDR"]
-			set slavetree [slaveip_intr $slave $intc [interrupt_list $slave] "" [default_parameters $slave] ""]
-			set slavetree [tree_append $slavetree [list dcr-controller empty empty]]
-			set slavetree [tree_append $slavetree [list dcr-access-method string mmio]]
-			set slavetree [tree_append $slavetree [list dcr-mmio-stride int 4]]
-			set slavetree [tree_append $slavetree [gen_reg_property $name $baseaddr $highaddr "dcr-mmio-range"]]
-			lappend node $slavetree
-			set tree [bus_bridge $slave $intc 0 "MDCR"]
-
-			# Backward compatibility to not break older style tft driver
-			# connected through opb2dcr bridge.
-			set ranges [gen_ranges_property $slave $baseaddr $highaddr 0]
-			set tree [tree_append $tree $ranges]
-
+		default {
+			# Use the first BASEADDR parameter to be in node name - order is directed by mpd
+			set tree [slaveip_basic $slave $intc [default_parameters $slave] [format_ip_name $type [lindex $ranges_list 0 0] $name] ""]
+			tree_lappend tree [list \#size-cells int 1]
+			tree_lappend tree [list \#address-cells int 1]
+			tree_lappend tree [gen_ranges_property_list $slave $ranges_list]
+			set tree [gen_interrupt_property $tree $slave $intc [interrupt_list $slave]]
 			lappend node $tree
 		}
-		"axi_pcie" {
-			set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "" [default_parameters $slave] ]
-			set ip_tree [tree_append $ip_tree [list \#address-cells int 3]]
-			set ip_tree [tree_append $ip_tree [list \#size-cells int 2]]
-			# 64-bit high address.
-			set high_64bit 0x00000000
-			set ranges {}
-			set ranges_list [axipcie_ranges $slave "C_AXIBAR_NUM" "C_AXIBAR_%d" "C_AXIBAR2PCIEBAR_%d" "C_AXIBAR_HIGHADDR_%d"]
-			foreach range $ranges_list {
-				set range_type [lindex $range 0]
-				set axi_baseaddr [lindex $range 1]
-				set child_baseaddr [lindex $range 1]
-				set pcie_baseaddr [lindex $range 2]
-				set axi_highaddr [lindex $range 3]
-				set size [validate_ranges_property $slave $axi_baseaddr $axi_highaddr $child_baseaddr]
-				lappend ranges $range_type $high_64bit $pcie_baseaddr $axi_baseaddr $high_64bit $size
-			}
-			set ip_tree [tree_append $ip_tree [list "ranges" hexinttuple $ranges]]
-			lappend node $ip_tree
-		}
-		"pcie_ipif_slave" {
-			# We can automatically generate the ranges property, but that's about it
-			# the interrupt-map encodes board-level info that cannot be
-			# derived from the MHS.
-			# Default handling for all params first
-			set ip_tree [slaveip_pcie_ipif_slave $slave $intc "pcie_ipif_slave" [default_parameters $slave]]
-
-			# Standard stuff required fror the pci OF bindings
-			set ip_tree [tree_append $ip_tree [list "#size-cells" int "2"]]
-			set ip_tree [tree_append $ip_tree [list "#address-cells" int "3"]]
-			set ip_tree [tree_append $ip_tree [list "#interrupt-cells" int "1"]]
-			set ip_tree [tree_append $ip_tree [list "device_type" string "pci"]]
-			# Generate ranges property.  Lots of assumptions here - 32 bit address space being the main one
-			set ranges ""
-
-			set ipifbar [ scan_int_parameter_value $slave "C_MEM1_BASEADDR" ]
-			set ipif_highaddr [ scan_int_parameter_value $slave "C_MEM1_HIGHADDR" ]
-			set space_code "0x02000000"
-
-			set ranges [lappend ranges $space_code 0 $ipifbar $ipifbar 0 [ expr $ipif_highaddr - $ipifbar + 1 ]]
-
-			set ip_tree [tree_append $ip_tree [ list "ranges" hexinttuple $ranges ]]
-
-			# Now the interrupt-map-mask etc
-			set ip_tree [tree_append $ip_tree [ list "interrupt-map-mask" hexinttuple "0xff00 0x0 0x0 0x7" ]]
-
-			# Make sure the user knows they've still got more work to do
-			# If we were prepared to add a custom PARAMETER to the MLD then we could do moer here, but for now this is
-			# the best we can do
-			debug warning "WARNING: Cannot automatically populate PCI interrupt-map property - this must be completed manually"
-			lappend node $ip_tree
-		}
-		"plbv46_pci" {
-			# We can automatically generate the ranges property, but that's about it
-			# the interrupt-map encodes board-level info that cannot be
-			# derived from the MHS.
-			# Default handling for all params first
-			set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "plbv46-pci" [default_parameters $slave]]
-
-			# Standard stuff required fror the pci OF bindings
-			set ip_tree [tree_append $ip_tree [list "#size-cells" int "2"]]
-			set ip_tree [tree_append $ip_tree [list "#address-cells" int "3"]]
-			set ip_tree [tree_append $ip_tree [list "#interrupt-cells" int "1"]]
-			set ip_tree [tree_append $ip_tree [list "device_type" string "pci"]]
-			# Generate ranges property.  Lots of assumptions here - 32 bit address space being the main one
-			set ranges ""
-			set ipifbar_num [ scan_int_parameter_value $slave "C_IPIFBAR_NUM"]
-			for {set i 0} {$i < $ipifbar_num} {incr i} {
-				set ipif_spacetype [ scan_int_parameter_value $slave [ format "C_IPIF_SPACETYPE_%i" $i ] ]
-				set ipifbar [ scan_int_parameter_value $slave [ format "C_IPIFBAR_%i" $i ] ]
-				set ipif_highaddr [ scan_int_parameter_value $slave [ format "C_IPIF_HIGHADDR_%i" $i ] ]
-				set ipifbar2pcibar [ scan_int_parameter_value $slave [ format "C_IPIFBAR2PCIBAR_%i" $i ] ]
-				# A quick DRC to make sure the IPIFBAR and IPIFBAR2PCIBAR match
-				# This is a limitation of the kernel PCI layer rather than anything else
-				if { $ipifbar != $ipifbar2pcibar } {
-					debug warning "WARNING: $name:  C_IPIFBAR_$i and C_IPIBAR2PCIBAR_$i don't match"
-				}
-				# Different magic number depending upon the type of address space
-				switch $ipif_spacetype {
-					"0" {
-						# IO space
-						set space_code "0x01000000"
-						debug warning "WARNING: $name BAR $i: PCI I/O spaces not supported in Linux kernel PCI drivers"
-					}
-					"1" {
-						# mem space
-						set space_code "0x02000000"
-					}
-				}
-				set ranges [lappend ranges $space_code 0 $ipifbar2pcibar $ipifbar 0 [ expr $ipif_highaddr - $ipifbar + 1 ]]
-			}
-			set ip_tree [tree_append $ip_tree [ list "ranges" hexinttuple $ranges ]]
-
-			# Now the interrupt-map-mask etc
-			set ip_tree [tree_append $ip_tree [ list "interrupt-map-mask" hexinttuple "0xff00 0x0 0x0 0x7" ]]
+	}
+	return $node
+}
 
-			# Make sure the user knows they've still got more work to do
-			# If we were prepared to add a custom PARAMETER to the MLD then we could do moer here, but for now this is
-			# the best we can do
-			debug warning "WARNING: Cannot automatically populate PCI interrupt-map property - this must be completed manually"
-			lappend node $ip_tree
-		}
-		"axi2axi_connector" {
-			# FIXME: multiple ranges!
-			set baseaddr [scan_int_parameter_value $slave "C_S_AXI_RNG00_BASEADDR"]
-			set tree [bus_bridge $slave $intc $baseaddr "M_AXI"]
+# Built-in IP type -> handler table
+register_slave_handler {opb_intc xps_intc axi_intc} gen_slave_intc {family intc}
+register_slave_handler {mdm opb_mdm} gen_slave_mdm {family debug}
+register_slave_handler {xps_uartlite opb_uartlite axi_uartlite} gen_slave_uartlite {family uart}
+register_slave_handler {xps_uart16550 plb_uart16550 opb_uart16550 axi_uart16550} gen_slave_uart16550 {family uart}
+register_slave_handler {ps7_uart} gen_slave_ps7_uart {family zynq}
+register_slave_handler {xps_timebase_wdt axi_timebase_wdt} gen_slave_timebase_wdt {family timer}
+register_slave_handler {xps_timer opb_timer axi_timer} gen_slave_timer {family timer}
+register_slave_handler {axi_sysace xps_sysace opb_sysace} gen_slave_sysace {family sysace}
+register_slave_handler {opb_ethernet plb_ethernet opb_ethernetlite xps_ethernetlite axi_ethernetlite plb_temac} gen_slave_ethernet {family ethernet}
+register_slave_handler {xps_ll_temac} gen_slave_ll_temac {family ethernet}
+register_slave_handler {axi_ethernet_buffer axi_ethernet} gen_slave_axi_ethernet {family ethernet}
+register_slave_handler {axi_dma} gen_slave_axi_dma {family dma}
+register_slave_handler {axi_dma-merged} gen_slave_axi_dma_merged {family dma}
+register_slave_handler {axi_vdma} gen_slave_axi_vdma {family dma}
+register_slave_handler {axi_cdma} gen_slave_axi_cdma {family dma}
+register_slave_handler {axi_tft xps_tft} gen_slave_tft {family tft}
+register_slave_handler {logi3d logiwin logibmp} gen_slave_logi {family logicvc}
+register_slave_handler {logibayer logicvc} gen_slave_logicvc {family logicvc}
+register_slave_handler {logibitblt} gen_slave_logibitblt {family logicvc}
+register_slave_handler {plb_tft_cntlr_ref plb_dvi_cntlr_ref} gen_slave_tft_cntlr_ref {family tft}
+register_slave_handler {opb_ps2_dual_ref} gen_slave_ps2_dual_ref {family ps2}
+register_slave_handler {xps_ps2} gen_slave_ps2 {family ps2}
+register_slave_handler {opb_ac97_controller_ref} gen_slave_ac97 {family ac97}
+register_slave_handler {opb_gpio xps_gpio axi_gpio} gen_slave_gpio {family gpio}
+register_slave_handler {opb_iic xps_iic axi_iic} gen_slave_iic {family iic}
+register_slave_handler {xps_spi axi_quad_spi axi_spi} gen_slave_spi {family spi}
+register_slave_handler {xps_usb_host} gen_slave_usb_host {family usb}
+register_slave_handler {ps7_dma} gen_slave_ps7_dma {family zynq}
+register_slave_handler {ps7_slcr} gen_slave_ps7_slcr {family zynq}
+register_slave_handler {ps7_can ps7_iop_bus_config ps7_qspi_linear ps7_ddrc ps7_dev_cfg} gen_slave_ps7_basic {family zynq}
+register_slave_handler {ps7_gpio} gen_slave_ps7_gpio {family zynq}
+register_slave_handler {ps7_i2c} gen_slave_ps7_i2c {family zynq}
+register_slave_handler {ps7_ttc} gen_slave_ps7_ttc {family zynq}
+register_slave_handler {ps7_scutimer} gen_slave_ps7_scutimer {family zynq}
+register_slave_handler {ps7_qspi} gen_slave_ps7_qspi {family zynq}
+register_slave_handler {ps7_wdt} gen_slave_ps7_wdt {family zynq}
+register_slave_handler {ps7_scuwdt} gen_slave_ps7_scuwdt {family zynq}
+register_slave_handler {ps7_usb} gen_slave_ps7_usb {family zynq}
+register_slave_handler {ps7_spi} gen_slave_ps7_spi {family zynq}
+register_slave_handler {ps7_sdio} gen_slave_ps7_sdio {family zynq}
+register_slave_handler {ps7_smcc} gen_slave_ps7_smcc {family zynq}
+register_slave_handler {ps7_nand} gen_slave_ps7_nand {family zynq}
+register_slave_handler {ps7_nor ps7_sram} gen_slave_ps7_nor {family zynq}
+register_slave_handler {ps7_scugic} gen_slave_ps7_scugic {family zynq}
+register_slave_handler {ps7_pl310} gen_slave_ps7_pl310 {family zynq}
+register_slave_handler {ps7_xadc} gen_slave_ps7_xadc {family zynq}
+register_slave_handler {ps7_trace ps7_ddr} gen_slave_skip {family zynq}
+register_slave_handler {ps7_ethernet} gen_slave_ps7_ethernet {family zynq}
+register_slave_handler {axi_fifo_mm_s} gen_slave_axi_fifo_mm_s {family fifo}
+register_slave_handler {ps7_ram} gen_slave_ps7_ram {family zynq}
+register_slave_handler {plb_bram_if_cntlr opb_bram_if_cntlr axi_bram_ctrl opb_cypress_usb plb_ddr plb_ddr2 opb_sdram opb_ddr mch_opb_ddr mch_opb_ddr2 mch_opb_sdram ppc440mc_ddr2 axi_s6_ddrx axi_v6_ddrx axi_7series_ddrx mig_7series} gen_slave_skip {family memory}
+register_slave_handler {opb_emc plb_emc mch_opb_emc xps_mch_emc} gen_slave_emc {family emc}
+register_slave_handler {axi_emc} gen_slave_axi_emc {family emc}
+register_slave_handler {mpmc} gen_slave_mpmc {family mpmc}
+register_slave_handler {opb2plb_bridge} gen_slave_skip {family opb_plb}
+register_slave_handler {plb2opb_bridge plbv46_opb_bridge} gen_slave_plb2opb_bridge {family opb_plb}
+register_slave_handler {plbv46_axi_bridge} gen_slave_skip {family opb_plb}
+register_slave_handler {axi_plbv46_bridge} gen_slave_axi_plbv46_bridge {family opb_plb}
+register_slave_handler {plbv46_plbv46_bridge} gen_slave_plbv46_plbv46_bridge {family opb_plb}
+register_slave_handler {opb_opb_lite} gen_slave_opb_opb_lite {family opb_plb}
+register_slave_handler {opb2dcr_bridge plbv46_dcr_bridge} gen_slave_dcr_bridge {family opb_plb}
+register_slave_handler {axi_pcie} gen_slave_axi_pcie {family pci}
+register_slave_handler {pcie_ipif_slave} gen_slave_pcie_ipif_slave {family pci}
+register_slave_handler {plbv46_pci} gen_slave_plbv46_pci {family pci}
+register_slave_handler {axi2axi_connector} gen_slave_axi2axi_connector {family bridge}
+register_slave_handler {microblaze} gen_slave_microblaze {family cpu}
+register_slave_handler {ppc405} gen_slave_ppc405 {family ppc}
+register_slave_handler {axi_epc xps_epc} gen_slave_epc {family epc}
+
+# Built-in registrations, restored at the start of every run so handlers
+# registered from one run's handler_file don't leak into the next
+variable slave_handlers_builtin [array get slave_handlers]
+variable slave_handler_info_builtin [array get slave_handler_info]
+
+proc clear_registered_handlers {} {
+	variable slave_handlers
+	variable slave_handler_info
+	variable slave_handlers_builtin
+	variable slave_handler_info_builtin
+
+	array unset slave_handlers
+	array set slave_handlers $slave_handlers_builtin
+	array unset slave_handler_info
+	array set slave_handler_info $slave_handler_info_builtin
+}
 
-			if {[llength $tree] != 0} {
-				set ranges_list [default_ranges $slave "C_S_AXI_NUM_ADDR_RANGES" "C_S_AXI_RNG%02d_BASEADDR" "C_S_AXI_RNG%02d_HIGHADDR"]
-				set tree [tree_append $tree [gen_ranges_property_list $slave $ranges_list]]
-				lappend node $tree
-			}
-		}
-		"microblaze" {
-			debug ip "Other Microblaze CPU $name=$type"
-			lappend node [gen_microblaze $slave [default_parameters $slave]]
-		}
-		"ppc405" {
-			debug ip "Other PowerPC405 CPU $name=$type"
-			lappend node [gen_ppc405 $slave [default_parameters $slave]]
+# Append node(s) of slave IP to node through the handler of its type
+proc gener_slave {node slave intc {force_type ""}} {
+	if { [llength $force_type] != 0 } {
+		set name $force_type
+		set type $force_type
+	} else {
+		# If we haven't already generated this ip
+		if {![visited_add periphery $slave]} {
+			return $node
 		}
-		"axi_epc" -
-		"xps_epc" {
-			set tree [compound_slave $slave "C_PRH0_BASEADDR"]
+		set name [hw_name $slave]
+		set type [hw_value $slave]
 
-			set epc_peripheral_num [xget_hw_parameter_value $slave "C_NUM_PERIPHERALS"]
-			for {set x 0} {$x < ${epc_peripheral_num}} {incr x} {
-				set subnode [slaveip_intr $slave $intc [interrupt_list $slave] "" "" "PRH${x}_" ]
-				set subnode [change_nodename $subnode $name "${name}_p${x}"]
-				set tree [tree_append $tree $subnode]
-			}
-			lappend node $tree
+		# Ignore IP through overides
+		# Command: "ip -ignore <IP name> "
+		if {[override_ignored $name]} {
+			puts "Ignoring $name"
+			return $node
 		}
-		default {
-			# *Most* IP should be handled by this default case.
-			# check if is any parameter BASEADDR
-			set ip_params [xget_hw_parameter_handle $slave "*"]
-			set address_array {}
-			set ranges_list {}
-			puts [xget_hw_name $slave]
-			foreach par_name $ip_params {
-				# check all
-				set addrtype [xget_hw_subproperty_value $par_name "ADDRESS"]
-				if {[string compare -nocase $addrtype "BASE"] == 0} {
-					set base [xget_hw_name $par_name]
-					set high [xget_hw_subproperty_value $par_name "PAIR"]
-					set baseaddr [scan_int_parameter_value $slave $base]
-					set highaddr [scan_int_parameter_value $slave $high]
-					if { "${baseaddr}" < "${highaddr}" } {
-						lappend address_array $par_name
-						# Also compound ranges list with all BASEADDR and HIGHADDR pairs
-						lappend ranges_list [list $baseaddr $highaddr $baseaddr]
-					}
-				}
-			}
+	}
 
-			switch [llength $address_array] {
-				"0" {
-					# maybe just IP just with interrupt line
-					set name [xget_hw_name $slave]
-					set type [xget_hw_value $slave]
-					set tree [slaveip_basic $slave $intc [default_parameters $slave] [format_ip_name $type "0" $name] ""]
-					set tree [gen_interrupt_property $tree $slave $intc [interrupt_list $slave]]
-					lappend node $tree
-				}
-				"1" {
-					# address_array has only one baseaddr which means that it is single node
-					set par_name $address_array
-					set base [xget_hw_name $par_name]
-					set high [xget_hw_subproperty_value $par_name "PAIR"]
-					set baseaddr [scan_int_parameter_value $slave $base]
-					set highaddr [scan_int_parameter_value $slave $high]
-					set tree [slaveip_explicit_baseaddr $slave $intc "" [default_parameters $slave] $baseaddr $highaddr ""]
-					set tree [gen_interrupt_property $tree $slave $intc [interrupt_list $slave]]
-					lappend node $tree
-				}
-				default {
-					# Use the first BASEADDR parameter to be in node name - order is directed by mpd
-					set tree [slaveip_basic $slave $intc [default_parameters $slave] [format_ip_name $type [lindex $ranges_list 0 0] $name] ""]
-					set tree [tree_append $tree [list \#size-cells int 1]]
-					set tree [tree_append $tree [list \#address-cells int 1]]
-					set tree [tree_append $tree [gen_ranges_property_list $slave $ranges_list]]
-					set tree [gen_interrupt_property $tree $slave $intc [interrupt_list $slave]]
-					lappend node $tree
-				}
-			}
-		}
+	# Nodes generated before were already overridden
+	set count [llength $node]
+	set handler [slave_handler $type]
+	set start [profile_begin]
+	set node [$handler $node $slave $intc $name $type]
+	profile_end slave $type $start
+	set new [lrange $node $count end]
+	# Forced types have no hardware instance
+	if { [llength $force_type] == 0 } {
+		set new [gen_clocks_property $new $slave $name]
 	}
-	return [dts_override $node]
+	return [concat [lrange $node 0 [expr {$count - 1}]] [dts_override $new]]
 }
 
 proc memory {slave baseaddr_prefix params} {
-	set name [xget_hw_name $slave]
-	set type [xget_hw_value $slave]
-	set par [xget_hw_parameter_handle $slave "*"]
-	set hw_ver [xget_hw_parameter_value $slave "HW_VER"]
+	set name [hw_name $slave]
+	set type [hw_value $slave]
+	set par [hw_parameter_handle $slave "*"]
+	set hw_ver [hw_parameter_value $slave "HW_VER"]
 
 	set ip_node {}
 
@@ -2579,19 +2996,19 @@ proc memory {slave baseaddr_prefix params} {
 
 proc gen_cortexa9 {tree hwproc_handle intc params} {
 	set out ""
-	variable cpunumber
-	variable ps7_cortexa9_clk
-	variable ps7_cortexa9_1x_clk
+	context_var cpunumber
+	context_var ps7_cortexa9_clk
+	context_var ps7_cortexa9_1x_clk
 	set cpus_node {}
 
-	set mhs_handle [xget_hw_parent_handle $hwproc_handle]
+	set mhs_handle [hw_parent_handle $hwproc_handle]
 	set lprocs [xget_cortexa9_handles $mhs_handle]
 
 	# add both the cortex a9 processors to the cpus node
 	foreach hw_proc $lprocs {
-		set cpu_name [xget_hw_name $hw_proc]
-		set cpu_type [xget_hw_value $hw_proc]
-		set hw_ver [xget_hw_parameter_value $hw_proc "HW_VER"]
+		set cpu_name [hw_name $hw_proc]
+		set cpu_type [hw_value $hw_proc]
+		set hw_ver [hw_parameter_value $hw_proc "HW_VER"]
 
 		set proc_node {}
 		lappend proc_node [list "device_type" string "cpu"]
@@ -2601,10 +3018,7 @@ proc gen_cortexa9 {tree hwproc_handle intc params} {
 		set ps7_cortexa9_clk [xget_sw_parameter_value $hwproc_handle "C_CPU_CLK_FREQ_HZ"]
 		set ps7_cortexa9_1x_clk [xget_sw_parameter_value $hwproc_handle "C_CPU_1X_CLK_FREQ_HZ"]
 		lappend proc_node [list "reg" int $cpunumber]
-		lappend proc_node [list "i-cache-size" hexint [expr 0x8000]]
-		lappend proc_node [list "i-cache-line-size" hexint 32]
-		lappend proc_node [list "d-cache-size" hexint [expr 0x8000]]
-		lappend proc_node [list "d-cache-line-size" hexint 32]
+		set proc_node [concat $proc_node [cpu_cache_properties $cpu_type]]
 		set proc_node [gen_params $proc_node $hw_proc $params]
 		lappend cpus_node [list [format_ip_name "cpu" $cpunumber $cpu_name] "tree" "$proc_node"]
 
@@ -2618,33 +3032,65 @@ proc gen_cortexa9 {tree hwproc_handle intc params} {
 	# Add PMU node
 	set ip_tree [list "pmu" tree ""]
 	set ip_tree [zynq_irq $ip_tree $intc "ps7_pmu"]
-	set ip_tree [tree_append $ip_tree [list "reg" hexinttuple [list "0xF8891000" "0x1000" "0xF8893000" "0x1000"] ] ]
-	set ip_tree [tree_append $ip_tree [list "compatible" stringtuple "arm,cortex-a9-pmu"]]
+	tree_lappend ip_tree [list "reg" hexinttuple [concat [reg_cells "0xF8891000" "0x1000"] [reg_cells "0xF8893000" "0x1000"]] ]
+	tree_lappend ip_tree [list "compatible" stringtuple "arm,cortex-a9-pmu"]
 	lappend tree "$ip_tree"
 
 	return $tree
 }
 
-proc xget_cortexa9_handles { mhs_handle } {
-	set ipinst_list [xget_hw_ipinst_handle $mhs_handle "*"]
-	set lprocs ""
-	foreach ipinst $ipinst_list {
-		set ipname [xget_value $ipinst "OPTION" "IPNAME"]
-		if {[string compare -nocase $ipname "ps7_cortexa9"] == 0} {
-			lappend lprocs $ipinst
-		}
+# Cache geometry of the hard processors, which have no cache parameters:
+# {size line_size ways} of the instruction and the data cache
+variable cache_geometry
+array set cache_geometry {
+	ps7_cortexa9 {{32768 32 4} {32768 32 4}}
+	ppc405 {{16384 32 2} {16384 32 2}}
+	ppc440 {{32768 32 64} {32768 32 64}}
+	ps7_pl310 {524288 32 8}
+}
+
+# Zynq PL310 RAM latencies and prefetch setup, as programmed by the FSBL
+variable pl310_config {
+	arm,data-latency {3 2 2}
+	arm,tag-latency {2 2 2}
+	prefetch-data 1
+	prefetch-instr 1
+}
+
+# Cache size, line size and number of sets properties,
+# geometry: {size line_size ways}
+proc cache_properties {prefix geometry} {
+	set size [lindex $geometry 0]
+	set line [lindex $geometry 1]
+	set ways [lindex $geometry 2]
+
+	set props {}
+	lappend props [list $prefix-size hexint $size]
+	lappend props [list $prefix-line-size hexint $line]
+	if {$line > 0 && $ways > 0 && $size > 0} {
+		lappend props [list $prefix-sets hexint [expr $size / ($line * $ways)]]
 	}
+	return $props
+}
+
+proc cpu_cache_properties {type} {
+	variable cache_geometry
 
-	return $lprocs
+	set geometry $cache_geometry($type)
+	return [concat [cache_properties "i-cache" [lindex $geometry 0]] [cache_properties "d-cache" [lindex $geometry 1]]]
+}
+
+proc xget_cortexa9_handles { mhs_handle } {
+	return [hw_ips_of_type $mhs_handle "ps7_cortexa9"]
 }
 
 proc gen_ppc405 {tree hwproc_handle params} {
 	set out ""
-	variable cpunumber
+	context_var cpunumber
 
-	set cpu_name [xget_hw_name $hwproc_handle]
-	set cpu_type [xget_hw_value $hwproc_handle]
-	set hw_ver [xget_hw_parameter_value $hwproc_handle "HW_VER"]
+	set cpu_name [hw_name $hwproc_handle]
+	set cpu_type [hw_value $hwproc_handle]
+	set hw_ver [hw_parameter_value $hwproc_handle "HW_VER"]
 
 	set cpus_node {}
 	set proc_node {}
@@ -2665,10 +3111,7 @@ proc gen_ppc405 {tree hwproc_handle params} {
 	# timebase is the same as the processor clock.
 	lappend proc_node [list timebase-frequency int $clk]
 	lappend proc_node [list reg int $cpunumber]
-	lappend proc_node [list i-cache-size hexint [expr 0x4000]]
-	lappend proc_node [list i-cache-line-size hexint 32]
-	lappend proc_node [list d-cache-size hexint [expr 0x4000]]
-	lappend proc_node [list d-cache-line-size hexint 32]
+	set proc_node [concat $proc_node [cpu_cache_properties ppc405]]
 	set proc_node [gen_params $proc_node $hwproc_handle $params]
 	lappend proc_node [list dcr-controller empty empty]
 	lappend proc_node [list dcr-access-method string native]
@@ -2684,11 +3127,11 @@ proc gen_ppc405 {tree hwproc_handle params} {
 
 proc gen_ppc440 {tree hwproc_handle intc params} {
 	set out ""
-	variable cpunumber
+	context_var cpunumber
 
-	set cpu_name [xget_hw_name $hwproc_handle]
-	set cpu_type [xget_hw_value $hwproc_handle]
-	set hw_ver [xget_hw_parameter_value $hwproc_handle "HW_VER"]
+	set cpu_name [hw_name $hwproc_handle]
+	set cpu_type [hw_value $hwproc_handle]
+	set hw_ver [hw_parameter_value $hwproc_handle "HW_VER"]
 
 	set cpus_node {}
 	set proc_node {}
@@ -2709,10 +3152,7 @@ proc gen_ppc440 {tree hwproc_handle intc params} {
 	# timebase is the same as the processor clock.
 	lappend proc_node [list timebase-frequency int $clk]
 	lappend proc_node [list reg int $cpunumber]
-	lappend proc_node [list i-cache-size hexint [expr 0x8000]]
-	lappend proc_node [list i-cache-line-size hexint 32]
-	lappend proc_node [list d-cache-size hexint [expr 0x8000]]
-	lappend proc_node [list d-cache-line-size hexint 32]
+	set proc_node [concat $proc_node [cpu_cache_properties ppc440]]
 	set proc_node [gen_params $proc_node $hwproc_handle $params]
 	lappend proc_node [list dcr-controller empty empty]
 	lappend proc_node [list dcr-access-method string native]
@@ -2731,8 +3171,8 @@ proc gen_ppc440 {tree hwproc_handle intc params} {
 
 		set sdma_name [format_ip_name sdma $baseaddr "DMA$x"]
 		set sdma_tree [list $sdma_name tree {}]
-		set sdma_tree [tree_append $sdma_tree [gen_reg_property $sdma_name $baseaddr $highaddr "dcr-reg"]]
-		set sdma_tree [tree_append $sdma_tree [gen_compatible_property $sdma_name "ll_dma" "1.00.a"]]
+		tree_lappend sdma_tree [gen_reg_property $sdma_name $baseaddr $highaddr "dcr-reg"]
+		tree_lappend sdma_tree [gen_compatible_property $sdma_name "ll_dma" "1.00.a"]
 		set sdma_tree [gen_interrupt_property $sdma_tree $hwproc_handle $intc [list [format "DMA%dRXIRQ" $x] [format "DMA%dTXIRQ" $x]]]
 
 		lappend proc_node $sdma_tree
@@ -2749,10 +3189,10 @@ proc gen_ppc440 {tree hwproc_handle intc params} {
 
 proc gen_microblaze {tree hwproc_handle params} {
 	set out ""
-	variable cpunumber
+	context_var cpunumber
 
-	set cpu_name [xget_hw_name $hwproc_handle]
-	set cpu_type [xget_hw_value $hwproc_handle]
+	set cpu_name [hw_name $hwproc_handle]
+	set cpu_type [hw_value $hwproc_handle]
 
 	set icache_size [scan_int_parameter_value $hwproc_handle "C_CACHE_BYTE_SIZE"]
 	set icache_base [scan_int_parameter_value $hwproc_handle "C_ICACHE_BASEADDR"]
@@ -2764,7 +3204,7 @@ proc gen_microblaze {tree hwproc_handle params} {
 	# is in bytes.
 	set icache_line_size [expr 4*[scan_int_parameter_value $hwproc_handle "C_ICACHE_LINE_LEN"]]
 	set dcache_line_size [expr 4*[scan_int_parameter_value $hwproc_handle "C_DCACHE_LINE_LEN"]]
-	set hw_ver [xget_hw_parameter_value $hwproc_handle "HW_VER"]
+	set hw_ver [hw_parameter_value $hwproc_handle "HW_VER"]
 
 	set cpus_node {}
 	set proc_node {}
@@ -2778,17 +3218,16 @@ proc gen_microblaze {tree hwproc_handle params} {
 	lappend proc_node [list clock-frequency int $clk]
 	lappend proc_node [list timebase-frequency int $clk]
 	lappend proc_node [list reg int 0]
+	# Microblaze caches are direct mapped
 	if { [llength $icache_size] != 0 } {
 		lappend proc_node [list i-cache-baseaddr hexint $icache_base]
 		lappend proc_node [list i-cache-highaddr hexint $icache_high]
-		lappend proc_node [list i-cache-size hexint $icache_size]
-		lappend proc_node [list i-cache-line-size hexint $icache_line_size]
+		set proc_node [concat $proc_node [cache_properties "i-cache" [list $icache_size $icache_line_size 1]]]
 	}
 	if { [llength $dcache_size] != 0 } {
 		lappend proc_node [list d-cache-baseaddr hexint $dcache_base]
 		lappend proc_node [list d-cache-highaddr hexint $dcache_high]
-		lappend proc_node [list d-cache-size hexint $dcache_size]
-		lappend proc_node [list d-cache-line-size hexint $dcache_line_size]
+		set proc_node [concat $proc_node [cache_properties "d-cache" [list $dcache_size $dcache_line_size 1]]]
 	}
 
 	#-----------------------------
@@ -2807,20 +3246,121 @@ proc gen_microblaze {tree hwproc_handle params} {
 }
 
 proc get_first_mem_controller { memory_nodes } {
-	foreach order "ps7_ddr axi_v6_ddrx axi_7series_ddrx axi_s6_ddrx mpmc" {
+	foreach order "ps7_ddr axi_v6_ddrx axi_7series_ddrx mig_7series axi_s6_ddrx mpmc ppc440mc_ddr2" {
 		foreach node $memory_nodes {
 			if { "[lindex $node 0]" == "$order" } {
 				return $node
 			}
 		}
 	}
+	return [lindex $memory_nodes 0]
+}
+
+# Order memory nodes for the merged and split layouts: the main memory
+# first, LMB BRAM only if there is no other memory
+proc order_mem_controllers { memory_nodes main_memory } {
+	set main {}
+	set others {}
+	set lmb {}
+	foreach node $memory_nodes {
+		set label [lindex [split [lindex $node 1 0] ":"] 0]
+		if {[string equal -nocase $label $main_memory]} {
+			lappend main $node
+		} elseif {"[lindex $node 0]" == "lmb_bram_if_cntlr"} {
+			lappend lmb $node
+		} else {
+			lappend others $node
+		}
+	}
+	set nodes [concat $main $others]
+	if {[llength $nodes] == 0} {
+		return $lmb
+	}
+	return $nodes
+}
+
+# One memory node with the reg entries of all memory nodes
+proc merge_mem_nodes { memory_nodes } {
+	set reg {}
+	foreach node $memory_nodes {
+		foreach prop [lindex $node 1 2] {
+			if {"[lindex $prop 0]" == "reg"} {
+				set reg [concat $reg [lindex $prop 2]]
+			}
+		}
+	}
+	set subnode {}
+	lappend subnode [list "device_type" string "memory"]
+	lappend subnode [list "reg" hexinttuple $reg]
+	return [list [lindex $memory_nodes 0 1 0] tree $subnode]
+}
+
+# BRAM controllers on the system bus, which gen_memories never uses as
+# main memory
+variable sram_types {axi_bram_ctrl plb_bram_if_cntlr opb_bram_if_cntlr}
+
+# mmio-sram node for on-chip memory, so that drivers can allocate from it
+# through the genalloc pool of the Linux sram driver
+proc sram_node {name baseaddr highaddr {other_compatibles {}}} {
+	set subnode {}
+	lappend subnode [list "compatible" stringtuple [concat $other_compatibles "mmio-sram"]]
+	lappend subnode [gen_reg_property $name $baseaddr $highaddr]
+	lappend subnode [list \#address-cells int 1]
+	lappend subnode [list \#size-cells int 1]
+	lappend subnode [list "ranges" hexinttuple [concat 0 [encode_cells $baseaddr [lindex [cells_current] 0]] [expr $highaddr - $baseaddr + 1]]]
+	return [list [format_ip_name "sram" $baseaddr $name] tree $subnode]
+}
+
+proc gen_srams {tree hwproc_handle} {
+	variable sram_types
+	context_var sram_nodes
+
+	if {![info exists sram_nodes] || ![string is true -strict $sram_nodes]} {
+		return $tree
+	}
+	set mhs_handle [hw_parent_handle $hwproc_handle]
+	foreach slave [hw_ips_of_type $mhs_handle $sram_types] {
+		set name [hw_name $slave]
+		if {[override_ignored $name]} {
+			continue
+		}
+		if {"[hw_value $slave]" == "axi_bram_ctrl"} {
+			set prefix "S_AXI_"
+		} else {
+			set prefix ""
+		}
+		set baseaddr [scan_int_parameter_value $slave [format "C_%sBASEADDR" $prefix]]
+		set highaddr [scan_int_parameter_value $slave [format "C_%sHIGHADDR" $prefix]]
+		lappend tree [sram_node $name $baseaddr $highaddr]
+	}
+	return $tree
 }
 
+# IP types handled by gen_memories
+variable memory_types {lmb_bram_if_cntlr opb_sdram mig_7series ppc440mc_ddr2
+	axi_s6_ddrx ps7_ddr axi_v6_ddrx axi_7series_ddrx opb_cypress_usb plb_ddr
+	plb_ddr2 plb_emc opb_ddr opb_emc mch_opb_ddr mch_opb_ddr2 mch_opb_emc
+	mch_opb_sdram xps_mch_emc axi_emc mpmc}
+
 proc gen_memories {tree hwproc_handle} {
-	global main_memory main_memory_bank
-	global main_memory_start main_memory_size
-	set mhs_handle [xget_hw_parent_handle $hwproc_handle]
-	set ip_handles [xget_hw_ipinst_handle $mhs_handle "*"]
+	variable memory_types
+	context_var main_memory main_memory_bank
+	context_var main_memory_start main_memory_size
+	context_var memory_layout
+	if {![info exists memory_layout] || [llength $memory_layout] == 0} {
+		set layout "single"
+	} else {
+		set layout [string tolower $memory_layout]
+	}
+	if {[lsearch -exact {single merged split} $layout] < 0} {
+		error "Unknown memory_layout $memory_layout, expected single, merged or split"
+	}
+	# Only the single layout is limited to the main memory controller
+	if {$layout == "single" && ![string match "" $main_memory] && ![string match -nocase "none" $main_memory]} {
+		set only_main 1
+	} else {
+		set only_main 0
+	}
 	set memory_count 0
 	set baseaddr [expr ${main_memory_start}]
 	set memsize [expr ${main_memory_size}]
@@ -2829,20 +3369,28 @@ proc gen_memories {tree hwproc_handle} {
 		set subnode {}
 		set devtype "memory"
 		lappend subnode [list "device_type" string "${devtype}"]
-		lappend subnode [list "reg" hexinttuple [list $baseaddr $memsize]]
+		lappend subnode [list "reg" hexinttuple [reg_cells $baseaddr $memsize]]
 		lappend tree [list [format_ip_name "${devtype}" $baseaddr "system_memory"] tree $subnode]
 		incr memory_count
 		return $tree
 	}
-	set mhs_handle [xget_hw_parent_handle $hwproc_handle]
-	set ip_handles [xget_hw_ipinst_handle $mhs_handle "*"]
+	set mhs_handle [hw_parent_handle $hwproc_handle]
+	if {$only_main} {
+		set ip_handles [hw_ipinst_handle $mhs_handle $main_memory]
+	} else {
+		set ip_handles [hw_ips_of_type $mhs_handle $memory_types]
+	}
 	set memory_count 0
 	set memory_nodes {}
+	visited_clear memory
 	foreach slave $ip_handles {
-		set name [xget_hw_name $slave]
-		set type [xget_hw_value $slave]
+		if {![visited_add memory $slave]} {
+			continue
+		}
+		set name [hw_name $slave]
+		set type [hw_value $slave]
 
-		if {![string match "" $main_memory] && ![string match -nocase "none" $main_memory]} {
+		if {$only_main} {
 			if {![string match $name $main_memory]} {
 				continue;
 			}
@@ -2860,8 +3408,7 @@ proc gen_memories {tree hwproc_handle} {
 			"plb_bram_if_cntlr" -
 			"opb_bram_if_cntlr" {
 				# Ignore these, since they aren't big enough to be main
-				# memory, and we can't currently handle non-contiguous memory
-				# regions.
+				# memory. gen_srams reports them as sram nodes.
 			}
 			"opb_sdram" -
 			"mig_7series" {
@@ -2897,7 +3444,7 @@ proc gen_memories {tree hwproc_handle} {
 				set highaddr [scan_int_parameter_value $slave "C_S_AXI_HIGHADDR"]
 				set highaddr [expr $highaddr + 1]
 				lappend subnode [list "device_type" string "memory"]
-				lappend subnode [list "reg" hexinttuple [list $baseaddr $highaddr]]
+				lappend subnode [list "reg" hexinttuple [reg_cells $baseaddr $highaddr]]
 				lappend node [list [format_ip_name "memory" $baseaddr $name] tree $subnode]
 				lappend memory_nodes $node
 				incr memory_count
@@ -2952,7 +3499,7 @@ proc gen_memories {tree hwproc_handle} {
 					if { $synch_mem == 2 || $synch_mem == 3 } {
 						continue;
 					}
-					lappend node [memory $slave [format "S_AXI_MEM%d_" $x] ""]
+					set node [list $type [memory $slave [format "S_AXI_MEM%d_" $x] ""]]
 					lappend memory_nodes $node
 					incr memory_count
 				}
@@ -2991,34 +3538,242 @@ proc gen_memories {tree hwproc_handle} {
 	if {$memory_count == 0} {
 		error "No memory nodes found!"
 	}
-	if {$memory_count > 1} {
-		debug warning "Warning!: More than one memory found.  Note that most platforms don't support non-contiguous memory maps!"
-		debug warning "Warning!: Try to find out the main memory controller!"
-		set memory_node [get_first_mem_controller $memory_nodes]
-	} else {
-		set memory_node [lindex $memory_nodes 0]
-	}
-
-	# Skip type because only one memory node is selected
-	lappend tree [lindex $memory_node 1]
-
-	return $tree
+	switch -exact -- $layout {
+		"merged" {
+			lappend tree [merge_mem_nodes [order_mem_controllers $memory_nodes $main_memory]]
+		}
+		"split" {
+			foreach memory_node [order_mem_controllers $memory_nodes $main_memory] {
+				lappend tree [lindex $memory_node 1]
+			}
+		}
+		default {
+			if {$memory_count > 1} {
+				debug warning "Warning!: More than one memory found.  Note that most platforms don't support non-contiguous memory maps!"
+				debug warning "Warning!: Try to find out the main memory controller or set memory_layout to merged or split!"
+				set memory_node [get_first_mem_controller $memory_nodes]
+			} else {
+				set memory_node [lindex $memory_nodes 0]
+			}
+
+			# Skip type because only one memory node is selected
+			lappend tree [lindex $memory_node 1]
+		}
+	}
+
+	return [gen_srams $tree $hwproc_handle]
 }
 
 # Return 1 if the given interface of the given slave is connected to a bus.
 proc bus_is_connected {slave face} {
-	set busif_handle [xget_hw_busif_handle $slave $face]
+	set busif_handle [hw_busif_handle $slave $face]
 	if {[llength $busif_handle] == 0} {
 		error "Bus handle $face not found!"
 	}
-	set bus_name [xget_hw_value $busif_handle]
+	set bus_name [hw_value $busif_handle]
 
-	set mhs_handle [xget_hw_parent_handle $slave]
-	set bus_handle [xget_hw_ipinst_handle $mhs_handle $bus_name]
+	set mhs_handle [hw_parent_handle $slave]
+	set bus_handle [hw_ipinst_handle $mhs_handle $bus_name]
 
 	return [llength $bus_handle]
 }
 
+# Incremental regeneration
+# When enabled, the subtree gener_slave builds for every IP is stored in a
+# cache file next to the DTS together with a fingerprint of its inputs:
+# type, parameters, nets and port subproperties, resolved interrupts,
+# point-to-point peers (AXI stream, LocalLink), run options and the
+# generator state (counters, processor clocks) at the time of the call and
+# the processor parameters. Unchanged IPs reuse the cached subtree, the bus
+# nodes around them are always rebuilt. Bridges are never cached.
+variable slave_cache_file ""
+variable slave_cache_format 1
+variable slave_cache
+array set slave_cache {}
+variable slave_cache_new
+array set slave_cache_new {}
+# Counters read and updated by gener_slave
+variable slave_cache_state {serial_count sysace_count ethernet_count phy_count mac_count vdma_device_id dma_device_id ps7_spi_count ps7_i2c_count ps7_smcc_list microblaze_system_timer}
+# IP types which look at other IPs beyond their direct peers
+variable slave_cache_skip {ps7_ethernet}
+
+proc slave_cache_load {filepath} {
+	variable slave_cache_file
+	variable slave_cache_format
+	variable device_tree_generator_version
+	variable slave_cache
+	variable slave_cache_new
+
+	array unset slave_cache
+	array set slave_cache {}
+	array unset slave_cache_new
+	array set slave_cache_new {}
+	set slave_cache_file $filepath
+	if {[string match "" $filepath] || ![file isfile $filepath]} {
+		return
+	}
+	if {[catch {
+		set cfile [open $filepath r]
+		set data [read $cfile]
+		close $cfile
+		if {[lindex $data 0] != $slave_cache_format || [lindex $data 1] != $device_tree_generator_version} {
+			debug info "Ignoring cache $filepath from different generator"
+			return
+		}
+		foreach {name entry} [lindex $data 2] {
+			if {[llength $entry] == 5} {
+				set slave_cache($name) $entry
+			}
+		}
+	} error]} {
+		debug warning "Warning!: Ignoring broken cache $filepath: $error"
+		array unset slave_cache
+		array set slave_cache {}
+	}
+	debug info "Loaded [array size slave_cache] cached nodes from $filepath"
+}
+
+proc slave_cache_save {} {
+	variable slave_cache_file
+	variable slave_cache_format
+	variable device_tree_generator_version
+	variable slave_cache_new
+
+	if {[string match "" $slave_cache_file]} {
+		return
+	}
+	set entries {}
+	foreach name [lsort [array names slave_cache_new]] {
+		lappend entries $name $slave_cache_new($name)
+	}
+	write_file_atomic $slave_cache_file [list $slave_cache_format $device_tree_generator_version $entries]
+}
+
+# Inputs of the IP which can change generated subtree
+proc slave_fingerprint {slave intc} {
+	variable slave_cache_state
+	context_var consoleip overrides timer flash_memory flash_memory_bank
+	context_var main_memory main_memory_bank main_memory_start main_memory_size main_memory_offset
+	context_var sram_nodes clock_nodes ps7_cortexa9_clk ps7_cortexa9_1x_clk
+	context_var processor_fingerprint
+
+	set fp {}
+	foreach var "consoleip overrides timer flash_memory flash_memory_bank main_memory main_memory_bank main_memory_start main_memory_size main_memory_offset sram_nodes clock_nodes ps7_cortexa9_clk ps7_cortexa9_1x_clk" {
+		if {[info exists $var]} {
+			lappend fp [set $var]
+		} else {
+			lappend fp {}
+		}
+	}
+	foreach var $slave_cache_state {
+		context_var $var
+		lappend fp [set $var]
+	}
+	lappend fp [hw_name $intc]
+	# Handlers read clock frequencies and CPUs from the processor
+	if {[string match "" $processor_fingerprint]} {
+		set processor_fingerprint [slave_ip_fingerprint [xget_handle [xget_libgen_proc_handle] "IPINST"]]
+	}
+	lappend fp $processor_fingerprint
+	# reg and ranges are encoded with the cells of the bus
+	lappend fp [cells_current]
+	# xlnx,* parameters reported for the type, from the param_emission
+	# policy or the content of its file
+	lappend fp [param_allowed [hw_value $slave]]
+	# Compatible strings of the type, from compatible_file too
+	lappend fp [compatible_entries [hw_value $slave]]
+	# Handlers registered from the handler_file
+	context_var handler_file_types handler_file_content
+	if {[lsearch -exact $handler_file_types [hw_value $slave]] != -1} {
+		lappend fp $handler_file_content
+	} else {
+		lappend fp {}
+	}
+	lappend fp [slave_ip_fingerprint $slave]
+
+	# Resolved interrupt controllers and numbers
+	foreach port [interrupt_list $slave] {
+		lappend fp $port [irq_route $slave $intc $port]
+	}
+
+	# IPs connected point-to-point through bus interfaces
+	set mhs_handle [hw_parent_handle $slave]
+	foreach busif [hw_busif_handle $slave "*"] {
+		set net [hw_value $busif]
+		if {[string match "" $net] || [llength [hw_ipinst_handle $mhs_handle $net]] != 0} {
+			continue
+		}
+		foreach peer [hw_net_busifs $net] {
+			set peer_ip [hw_parent_handle $peer]
+			if {$peer_ip != $slave} {
+				lappend fp [slave_ip_fingerprint $peer_ip]
+			}
+		}
+	}
+	return $fp
+}
+
+proc slave_ip_fingerprint {ip} {
+	variable hw_export_port_subproperties
+
+	set fp [list [hw_name $ip] [hw_value $ip]]
+	foreach handle [concat [hw_parameter_handle $ip "*"] [hw_busif_handle $ip "*"]] {
+		lappend fp [hw_name $handle] [hw_value $handle]
+	}
+	# Clock frequencies and interrupt sensitivities are read from the
+	# subproperties of the ports
+	foreach handle [hw_port_handle $ip "*"] {
+		lappend fp [hw_name $handle] [hw_value $handle] [hw_export_subproperties $handle $hw_export_port_subproperties]
+	}
+	return $fp
+}
+
+# gener_slave with caching. Returns node with subtree(s) of slave appended.
+proc gener_slave_cached {node slave intc} {
+	variable slave_cache_file
+	variable slave_cache
+	variable slave_cache_new
+	variable slave_cache_state
+	variable slave_cache_skip
+	context_var bus_count
+	context_var alias_node_list
+	context_var gpio_names
+
+	if {[string match "" $slave_cache_file] || [visited_exists periphery $slave]} {
+		return [gener_slave $node $slave $intc]
+	}
+	set name [hw_name $slave]
+	set fingerprint [slave_fingerprint $slave $intc]
+	if {[info exists slave_cache($name)] && [lindex $slave_cache($name) 0] == $fingerprint} {
+		set entry $slave_cache($name)
+		visited_add periphery $slave
+		foreach {var value} [lindex $entry 2] {
+			context_var $var
+			set $var $value
+		}
+		set alias_node_list [concat $alias_node_list [lindex $entry 3]]
+		set gpio_names [concat $gpio_names [lindex $entry 4]]
+		set slave_cache_new($name) $entry
+		debug info "Reusing cached node of $name"
+		return [concat $node [lindex $entry 1]]
+	}
+
+	set count $bus_count
+	set alias_count [llength $alias_node_list]
+	set gpio_count [llength $gpio_names]
+	set delta [gener_slave {} $slave $intc]
+	if {$count == $bus_count && [lsearch -exact $slave_cache_skip [hw_value $slave]] == -1} {
+		set state {}
+		foreach var $slave_cache_state {
+			context_var $var
+			lappend state $var [set $var]
+		}
+		set slave_cache_new($name) [list $fingerprint $delta $state \
+			[lrange $alias_node_list $alias_count end] [lrange $gpio_names $gpio_count end]]
+	}
+	return [concat $node $delta]
+}
+
 # Populates a bus node with components connected to the given slave
 # and adds it to the given tree
 #
@@ -3033,24 +3788,23 @@ proc bus_is_connected {slave face} {
 # bus.
 proc bus_bridge {slave intc_handle baseaddr face {handle ""} {ps_ifs ""} {force_ips ""}} {
 	debug handles "+++++++++++ $slave ++++++++"
-	set busif_handle [xget_hw_busif_handle $slave $face]
+	set busif_handle [hw_busif_handle $slave $face]
 	if {[llength $handle] != 0} {
 		set busif_handle $handle
 	}
  	if {[llength $busif_handle] == 0} {
 		error "Bus handle $face not found!"
 	}
-	set bus_name [xget_hw_value $busif_handle]
-	global buses
-	if {[lsearch $buses $bus_name] >= 0} {
+	set bus_name [hw_value $busif_handle]
+	if {![visited_add buses $bus_name]} {
 		return {}
 	}
-	lappend buses $bus_name
 	debug ip "IP connected to bus: $bus_name"
 	debug handles "bus_handle: $busif_handle"
+	cells_push [bus_cells $bus_name]
 
-	set mhs_handle [xget_hw_parent_handle $slave]
-	set bus_handle [xget_hw_ipinst_handle $mhs_handle $bus_name]
+	set mhs_handle [hw_parent_handle $slave]
+	set bus_handle [hw_ipinst_handle $mhs_handle $bus_name]
 
 #FIXME remove compatible_list property and add simple-bus in  gen_compatible_property function
 	set compatible_list {}
@@ -3062,7 +3816,7 @@ proc bus_bridge {slave intc_handle baseaddr face {handle ""} {ps_ifs ""} {force_
 		set devicetype $bus_type
 	} else {
 		debug handles "Bus handle $face connected through a bus..."
-		set bus_type [xget_hw_value $bus_handle]
+		set bus_type [hw_value $bus_handle]
 		switch $bus_type {
 			"plb_v34" -
 			"plb_v46" {
@@ -3090,12 +3844,12 @@ proc bus_bridge {slave intc_handle baseaddr face {handle ""} {ps_ifs ""} {force_
 				set devicetype $bus_type
 			}
 		}
-		set hw_ver [xget_hw_parameter_value $bus_handle "HW_VER"]
+		set hw_ver [hw_parameter_value $bus_handle "HW_VER"]
 
 		set master_ifs [xget_hw_connected_busifs_handle $mhs_handle $bus_name "master"]
 		foreach if $master_ifs {
-			set ip_handle [xget_hw_parent_handle $if]
-			debug ip "-master [xget_hw_name $if] [xget_hw_value $if] [xget_hw_name $ip_handle]"
+			set ip_handle [hw_parent_handle $if]
+			debug ip "-master [hw_name $if] [hw_value $if] [hw_name $ip_handle]"
 			debug handles "  handle: $ip_handle"
 
 			# Note that bus masters do not need to be traversed, so we don't
@@ -3105,22 +3859,23 @@ proc bus_bridge {slave intc_handle baseaddr face {handle ""} {ps_ifs ""} {force_
 	}
 
 	set bus_ip_handles {}
+	visited_clear bus_ips
 	# Compose peripherals & cleaning
 
 	foreach if $slave_ifs {
-		set ip_handle [xget_hw_parent_handle $if]
-		debug ip "-slave [xget_hw_name $if] [xget_hw_value $if] [xget_hw_name $ip_handle]"
+		set ip_handle [hw_parent_handle $if]
+		debug ip "-slave [hw_name $if] [hw_value $if] [hw_name $ip_handle]"
 		debug handles "  handle: $ip_handle"
 
 		# Do not generate ps7_dma type with name ps7_dma_ns
-		if { "[xget_hw_value $ip_handle]" == "ps7_dma" &&  "[xget_hw_name $ip_handle]" == "ps7_dma_ns" } {
+		if { "[hw_value $ip_handle]" == "ps7_dma" &&  "[hw_name $ip_handle]" == "ps7_dma_ns" } {
 			continue
 		}
 
 		# If its not already in the list, and its not the bridge, then
 		# append it.
 		if {$ip_handle != $slave} {
-			if {[lsearch $bus_ip_handles $ip_handle] == -1} {
+			if {[visited_add bus_ips $ip_handle]} {
 				lappend bus_ip_handles $ip_handle
 			}
 		}
@@ -3129,28 +3884,25 @@ proc bus_bridge {slave intc_handle baseaddr face {handle ""} {ps_ifs ""} {force_
 	# MS This is specific function for AXI zynq IPs - I hope it will be removed
 	# soon by providing M_AXI_GP0 interface
 	foreach if $ps_ifs {
-		debug ip "-slave [xget_hw_name $if]"
+		debug ip "-slave [hw_name $if]"
 		debug handles "  handle: $if"
 
 		# Do not generate ps7_dma type with name ps7_dma_ns
-		if { "[xget_hw_value $if]" == "ps7_dma" &&  "[xget_hw_name $if]" == "ps7_dma_ns" } {
+		if { "[hw_value $if]" == "ps7_dma" &&  "[hw_name $if]" == "ps7_dma_ns" } {
 			continue
 		}
 
 		# If its not already in the list, and its not the bridge, then
 		# append it.
 		if {$if != $slave} {
-			if {[lsearch $bus_ip_handles $if] == -1} {
+			if {[visited_add bus_ips $if]} {
 				lappend bus_ip_handles $if
 			} else {
-				debug ip "IP $if [xget_hw_name $if] is already appended - skip it"
+				debug ip "IP $if [hw_name $if] is already appended - skip it"
 			}
 		}
 	}
 
-	# A list of all the IP that have been generated already.
-	variable periphery_array
-
 	set mdm {}
 	set uartlite {}
 	set fulluart {}
@@ -3158,11 +3910,11 @@ proc bus_bridge {slave intc_handle baseaddr face {handle ""} {ps_ifs ""} {force_
 	set sorted_ip {}
 	set console_type ""
 
-	global consoleip
+	context_var consoleip
 	# Sort all serial IP to be nice in the alias list
 	foreach ip $bus_ip_handles {
-		set name [xget_hw_name $ip]
-		set type [xget_hw_value $ip]
+		set name [hw_name $ip]
+		set type [hw_value $ip]
 
 		# Save console type for alias sorting
 		if { [string match "$name" "$consoleip"] } {
@@ -3193,13 +3945,9 @@ proc bus_bridge {slave intc_handle baseaddr face {handle ""} {ps_ifs ""} {force_
 	# Start generating the node for the bus.
 	set bus_node {}
 
-	# Populate with all the slaves.
+	# Populate with all the slaves. gener_slave skips already generated ones.
 	foreach ip $sorted_ip {
-		# If we haven't already generated this ip
-		if {[lsearch $periphery_array $ip] == -1} {
-			set bus_node [gener_slave $bus_node $ip $intc_handle]
-			lappend periphery_array $ip
-		}
+		set bus_node [gener_slave_cached $bus_node $ip $intc_handle]
 	}
 
 	# Force nodes to bus $force_ips is list of IP types
@@ -3214,22 +3962,156 @@ proc bus_bridge {slave intc_handle baseaddr face {handle ""} {ps_ifs ""} {force_
 		lappend bus_node $led
 	}
 
-	lappend bus_node [list \#size-cells int 1]
-	lappend bus_node [list \#address-cells int 1]
+	set bus_node [concat $bus_node [cells_properties]]
 	lappend bus_node [gen_compatible_property $bus_name $bus_type $hw_ver $compatible_list]
+	cells_pop
 
-	variable bus_count
+	context_var bus_count
 	set baseaddr $bus_count
 	incr bus_count
 	return [list [format_ip_name $devicetype $baseaddr $bus_name] tree $bus_node]
 }
 
+# Clock nets found by the clock port summary
+# clock_nets($net) - frequency of the net
+# clock_nets(parent,$net) - net of the input port of the clock generator
+# driving $net, if the generator derives $net from it
+variable clock_nets
+array set clock_nets {}
+
+proc clock_nets_clear {} {
+	variable clock_nets
+
+	array unset clock_nets
+	array set clock_nets {}
+}
+
+# Nets without a driver in the design are external clocks
+proc clock_net_add {net frequency} {
+	variable clock_nets
+
+	if {[string is integer -strict $frequency]} {
+		set clock_nets($net) $frequency
+	}
+}
+
+proc clock_net_driver {net ip inport} {
+	variable clock_nets
+
+	if {[llength $inport] != 0} {
+		set parent [hw_port_value $ip $inport]
+		if {[llength $parent] != 0} {
+			set clock_nets(parent,$net) $parent
+		}
+	}
+}
+
+proc clock_nodes_enabled {} {
+	context_var clock_nodes
+
+	return [expr {[info exists clock_nodes] && [string is true -strict $clock_nodes]}]
+}
+
+proc clock_label {net} {
+	return "clock_[string tolower $net]"
+}
+
+proc gcd {a b} {
+	while {$b != 0} {
+		set t [expr {$a % $b}]
+		set a $b
+		set b $t
+	}
+	return $a
+}
+
+# fixed-clock node for every clock net driven by a clock output, or
+# fixed-factor-clock if the output is derived from another clock net
+proc gen_clock_nodes {} {
+	variable clock_nets
+
+	if {![clock_nodes_enabled]} {
+		return {}
+	}
+	set clocks {}
+	foreach net [lsort [array names clock_nets]] {
+		if {[string match "parent,*" $net]} {
+			continue
+		}
+		set frequency $clock_nets($net)
+		set clk {}
+		lappend clk [list "#clock-cells" int 0]
+		lappend clk [list "clock-output-names" stringtuple [list $net]]
+		if {[info exists clock_nets(parent,$net)] && [info exists clock_nets($clock_nets(parent,$net))]} {
+			set parent $clock_nets(parent,$net)
+			set parent_frequency $clock_nets($parent)
+			set div [gcd $frequency $parent_frequency]
+			lappend clk [list "compatible" stringtuple [list "fixed-factor-clock"]]
+			lappend clk [list "clocks" labelref [clock_label $parent]]
+			lappend clk [list "clock-mult" int [expr {$frequency / $div}]]
+			lappend clk [list "clock-div" int [expr {$parent_frequency / $div}]]
+		} else {
+			lappend clk [list "compatible" stringtuple [list "fixed-clock"]]
+			lappend clk [list "clock-frequency" int $frequency]
+		}
+		lappend clocks [list "[clock_label $net]: [format_name $net]" tree $clk]
+	}
+	if {[llength $clocks] == 0} {
+		return {}
+	}
+	return [list "clocks" tree $clocks]
+}
+
+# Add clocks and clock-names for the clock inputs of slave to its node
+# among nodes, unless the handler already described the clocks
+proc gen_clocks_property {nodes slave name} {
+	variable clock_nets
+
+	if {![clock_nodes_enabled] || [llength $nodes] == 0} {
+		return $nodes
+	}
+	set labels {}
+	set names {}
+	foreach port [lsort [hw_port_handle $slave "*"]] {
+		if {[string toupper [hw_subproperty_value $port "SIGIS"]] != "CLK"} {
+			continue
+		}
+		if {[string toupper [hw_subproperty_value $port "DIR"]] == "O"} {
+			continue
+		}
+		set net [hw_value $port]
+		if {[llength $net] == 0 || ![info exists clock_nets($net)]} {
+			continue
+		}
+		lappend labels [clock_label $net]
+		lappend names [string tolower [hw_name $port]]
+	}
+	if {[llength $labels] == 0} {
+		return $nodes
+	}
+	set index 0
+	foreach tree $nodes {
+		if {[lindex [fdt_node_name [lindex $tree 0]] 0] == $name} {
+			foreach prop [lindex $tree 2] {
+				if {[lindex $prop 0] == "clocks"} {
+					return $nodes
+				}
+			}
+			tree_lappend tree [list "clocks" labelreftuple $labels]
+			tree_lappend tree [list "clock-names" stringtuple $names]
+			return [lreplace $nodes $index $index $tree]
+		}
+		incr index
+	}
+	return $nodes
+}
+
 # Return the clock frequency attribute of the port of the given ip core.
 proc get_clock_frequency {ip_handle portname} {
 	set clk ""
-	set clkhandle [xget_hw_port_handle $ip_handle $portname]
+	set clkhandle [hw_port_handle $ip_handle $portname]
 	if {[string compare -nocase $clkhandle ""] != 0} {
-		set clk [xget_hw_subproperty_value $clkhandle "CLK_FREQ_HZ"]
+		set clk [hw_subproperty_value $clkhandle "CLK_FREQ_HZ"]
 	}
 	return $clk
 }
@@ -3237,11 +4119,11 @@ proc get_clock_frequency {ip_handle portname} {
 # Return a sorted list of all the port names that we think are
 # interrupts (i.e. those tagged in the mpd with SIGIS=INTERRUPT)
 proc interrupt_list {ip_handle} {
-	set port_handles [xget_hw_port_handle $ip_handle "*"]
+	set port_handles [hw_port_handle $ip_handle "*"]
 	set interrupt_ports {}
 	foreach port $port_handles {
-		set name [xget_value $port "NAME"]
-		set sigis [xget_hw_subproperty_value $port "SIGIS"]
+		set name [hw_name $port]
+		set sigis [hw_subproperty_value $port "SIGIS"]
 		if {[string match $sigis "INTERRUPT"]} {
 			lappend interrupt_ports $name
 		}
@@ -3272,14 +4154,37 @@ proc default_ranges {ip_handle num_ranges_name range_base_name_template range_hi
 	return $ranges_list
 }
 
-proc axipcie_ranges {ip_handle num_ranges_name axi_base_name_template pcie_base_name_template axi_high_name_template} {
+# PCI address space codes of ranges and dma-ranges
+variable pci_space_mem32 0x02000000
+variable pci_space_mem64 0x03000000
+
+# The axi_pcie windows are plain non-prefetchable memory, C_AXIBAR_AS_n
+# only selects 64-bit addressing, so non-prefetchable endpoint BARs can
+# be assigned to them.
+proc pci_space_code {is_64bit} {
+	variable pci_space_mem32
+	variable pci_space_mem64
+
+	set code $pci_space_mem32
+	if {$is_64bit == "1"} {
+		set code $pci_space_mem64
+	}
+	return [format 0x%08x $code]
+}
+
+proc axipcie_ranges {ip_handle num_ranges_name axi_base_name_template pcie_base_name_template axi_high_name_template {axi_as_name_template ""}} {
 	set count [scan_int_parameter_value $ip_handle $num_ranges_name]
 	if { [llength $count] == 0 } {
 		set count 1
 	}
 	set ranges_list {}
 	for {set x 0} {$x < $count} {incr x} {
-		set range_type 0x02000000
+		# BARs with 64-bit PCIe addresses are 64-bit memory
+		set is_64bit 0
+		if {$axi_as_name_template != "" && [parameter_exists $ip_handle [format $axi_as_name_template $x]]} {
+			set is_64bit [scan_int_parameter_value $ip_handle [format $axi_as_name_template $x]]
+		}
+		set range_type [pci_space_code $is_64bit]
 		set axi_baseaddr [scan_int_parameter_value $ip_handle [format $axi_base_name_template $x]]
 		set pcie_baseaddr [scan_int_parameter_value $ip_handle [format $pcie_base_name_template $x]]
 		set axi_highaddr [scan_int_parameter_value $ip_handle [format $axi_high_name_template $x]]
@@ -3288,15 +4193,136 @@ proc axipcie_ranges {ip_handle num_ranges_name axi_base_name_template pcie_base_
 	return $ranges_list
 }
 
+# Parameter emission policy
+# param_emission MLD parameter: "default" reports all parameters from
+# default_parameters, "minimal" only those which Linux drivers read and
+# anything else is a file with "<IP type> <parameter>..." lines which
+# replace the minimal list of that type. An IP type can use its own policy
+# through the "params <IP type> default|minimal" override.
+# param_minimal($type) - parameters used by drivers, * for all of them
+variable param_minimal
+array set param_minimal {
+	microblaze *
+	ppc405_virtex4 *
+	ppc440_virtex5 *
+	ps7_cortexa9 *
+	opb_intc {C_NUM_INTR_INPUTS C_KIND_OF_INTR}
+	xps_intc {C_NUM_INTR_INPUTS C_KIND_OF_INTR}
+	axi_intc {C_NUM_INTR_INPUTS C_KIND_OF_INTR}
+	opb_timer {C_ONE_TIMER_ONLY C_COUNT_WIDTH}
+	xps_timer {C_ONE_TIMER_ONLY C_COUNT_WIDTH}
+	axi_timer {C_ONE_TIMER_ONLY C_COUNT_WIDTH}
+	xps_uartlite {C_BAUDRATE C_DATA_BITS C_USE_PARITY C_ODD_PARITY}
+	axi_uartlite {C_BAUDRATE C_DATA_BITS C_USE_PARITY C_ODD_PARITY}
+	mdm {C_USE_UART}
+	xps_gpio {C_GPIO_WIDTH C_GPIO2_WIDTH C_ALL_INPUTS C_ALL_INPUTS_2 C_IS_DUAL
+		C_DOUT_DEFAULT C_DOUT_DEFAULT_2 C_TRI_DEFAULT C_TRI_DEFAULT_2 C_INTERRUPT_PRESENT}
+	axi_gpio {C_GPIO_WIDTH C_GPIO2_WIDTH C_ALL_INPUTS C_ALL_INPUTS_2 C_IS_DUAL
+		C_DOUT_DEFAULT C_DOUT_DEFAULT_2 C_TRI_DEFAULT C_TRI_DEFAULT_2 C_INTERRUPT_PRESENT}
+	xps_ethernetlite {C_RX_PING_PONG C_TX_PING_PONG C_DUPLEX}
+	axi_ethernetlite {C_RX_PING_PONG C_TX_PING_PONG C_DUPLEX}
+	xps_spi {C_NUM_SS_BITS C_NUM_TRANSFER_BITS C_FIFO_EXIST C_SPI_MODE}
+	axi_spi {C_NUM_SS_BITS C_NUM_TRANSFER_BITS C_FIFO_EXIST C_SPI_MODE}
+	axi_quad_spi {C_NUM_SS_BITS C_NUM_TRANSFER_BITS C_FIFO_EXIST C_SPI_MODE}
+	xps_iic {C_GPO_WIDTH}
+	axi_iic {C_GPO_WIDTH}
+	axi_dma {C_INCLUDE_SG C_SG_LENGTH_WIDTH C_SG_INCLUDE_STSCNTRL_STRM}
+	axi_vdma {C_NUM_FSTORES C_FLUSH_ON_FSYNC C_INCLUDE_SG}
+	axi_cdma {C_INCLUDE_SG C_INCLUDE_DRE}
+	xps_timebase_wdt {C_WDT_INTERVAL C_WDT_ENABLE_ONCE}
+	axi_timebase_wdt {C_WDT_INTERVAL C_WDT_ENABLE_ONCE}
+	xps_usb2_device {C_INCLUDE_DMA}
+	axi_usb2_device {C_INCLUDE_DMA}
+	xps_ll_fifo {C_DATA_INTERFACE_TYPE}
+	axi_fifo_mm_s {C_DATA_INTERFACE_TYPE C_RX_FIFO_DEPTH C_TX_FIFO_DEPTH}
+	axi_pcie {C_INCLUDE_RC}
+}
+# param_file($type) - parameters listed in the param_emission file, read
+# once per run
+variable param_file
+array set param_file {}
+variable param_file_loaded ""
+
+proc clear_param_file {} {
+	variable param_file
+	variable param_file_loaded
+
+	array unset param_file
+	array set param_file {}
+	set param_file_loaded ""
+}
+
+proc load_param_file {filepath} {
+	variable param_file
+	variable param_file_loaded
+
+	if {[string equal $filepath $param_file_loaded]} {
+		return
+	}
+	if {[catch {open $filepath r} fd]} {
+		error "Parameter file $filepath not found"
+	}
+	debug info "Loading parameter list from $filepath"
+	set lines [split [read $fd] "\n"]
+	close $fd
+	array unset param_file
+	array set param_file {}
+	foreach line $lines {
+		set line [string trim $line]
+		if {[string match "" $line] || [string match "#*" $line]} {
+			continue
+		}
+		set param_file([lindex $line 0]) [lrange $line 1 end]
+	}
+	set param_file_loaded $filepath
+}
+
+# Return the parameters of type which can be reported, * for all of them
+proc param_allowed {type} {
+	variable param_minimal
+	variable param_file
+	variable override_index
+	context_var param_emission
+
+	if {[info exists override_index(params,$type)]} {
+		set policy $override_index(params,$type)
+	} elseif {[info exists param_emission] && ![string match "" $param_emission]} {
+		set policy $param_emission
+	} else {
+		set policy "default"
+	}
+	switch -exact -- $policy {
+		"default" {
+			return "*"
+		}
+		"minimal" {}
+		default {
+			load_param_file $policy
+			if {[info exists param_file($type)]} {
+				return $param_file($type)
+			}
+		}
+	}
+	if {[info exists param_minimal($type)]} {
+		return $param_minimal($type)
+	}
+	return {}
+}
+
 # Return a list of all the parameter names for the given ip that
 # should be reported in the device tree for generic IP. This list
 # includes all the parameter names, except those that are handled
 # specially, such as the instance name, baseaddr, etc.
+# Parameters which the emission policy doesn't allow are left out.
 proc default_parameters {ip_handle} {
-	set par_handles [xget_hw_parameter_handle $ip_handle "*"]
+	set allowed [param_allowed [hw_value $ip_handle]]
+	if {[llength $allowed] == 0} {
+		return {}
+	}
+	set par_handles [hw_parameter_handle $ip_handle "*"]
 	set params {}
 	foreach par $par_handles {
-		set par_name [xget_hw_name $par]
+		set par_name [hw_name $par]
 		# Ignore some parameters that are always handled specially
 		switch -glob $par_name {
 			"INSTANCE" -
@@ -3322,7 +4348,9 @@ proc default_parameters {ip_handle} {
 			"HW_VER" {}
 			default {
 				if { [ regexp {^C_.+} $par_name ] } {
-					lappend params $par_name
+					if {$allowed == "*" || [lsearch -exact $allowed $par_name] != -1} {
+						lappend params $par_name
+					}
 				}
 			}
 		}
@@ -3331,62 +4359,75 @@ proc default_parameters {ip_handle} {
 }
 
 proc parameter_exists {ip_handle name} {
-	set param_handle [xget_hw_parameter_handle $ip_handle $name]
+	set param_handle [hw_parameter_handle $ip_handle $name]
 	if {$param_handle == ""} {
 		return 0
 	}
 	return 1
 }
 
+# Decoded integer parameters of this run
+# int_param_cache($ip,$name) - value of parameter $name of IP $ip
+variable int_param_cache
+array set int_param_cache {}
+
 proc scan_int_parameter_value {ip_handle name} {
-	set param_handle [xget_hw_parameter_handle $ip_handle $name]
+	variable int_param_cache
+
+	if {[info exists int_param_cache($ip_handle,$name)]} {
+		return $int_param_cache($ip_handle,$name)
+	}
+	set param_handle [hw_parameter_handle $ip_handle $name]
 	if {$param_handle == ""} {
-		error "Can't find parameter $name in [xget_hw_name $ip_handle]"
+		error "Can't find parameter $name in [hw_name $ip_handle]"
 		return 0
 	}
-	set value [xget_hw_value $param_handle]
-	# tcl 8.4 doesn't handle binary literals..
-	if {[string match 0b* $value]} {
-		# Chop off the 0b
-		set tail [string range $value 2 [expr [string length $value]-1]]
-		# Pad to 32 bits, because binary scan ignores incomplete words
-		set list [split $tail ""]
-		for {} {[llength $list] < 32} {} {
-			set list [linsert $list 0 0]
-		}
-		set tail [join $list ""]
-		# Convert the remainder back to decimal
-		binary scan [binary format "B*" $tail] "I*" value
+	set value [decode_int_value [hw_value $param_handle]]
+	set int_param_cache($ip_handle,$name) $value
+	return $value
+}
+
+# Decode hex (0x), binary (0b) and decimal values, wider than 32 bits too.
+# Other values are an error, they are not evaluated as expressions.
+proc decode_int_value {value} {
+	set value [string trim $value]
+	if {[regexp -nocase {^0x([0-9a-f]+)$} $value match digits]} {
+		scan $digits %lx value
+		return $value
+	} elseif {[regexp -nocase {^0b([01]+)$} $value match digits]} {
+		# tcl 8.4 doesn't handle binary literals..
+		set value 0
+		foreach digit [split $digits ""] {
+			set value [expr {wide($value) * 2 + $digit}]
+		}
+		return $value
+	} elseif {[regexp {^-?[0-9]+$} $value]} {
+		# Leading zeros don't mean octal in EDK parameters
+		scan $value %ld value
+		return $value
 	}
-	return [expr $value]
+	error "Value \"$value\" is not an integer"
 }
 
 # generate structure for phy.
 # PARAMETER periph_type_overrides = {phy <IP_name> <phy_addr> <compatible>}
 proc gen_phytree {ip phya phy_chip} {
-	variable phy_count
+	context_var phy_count
 
-	global overrides
+	variable override_index
 
-	set name [xget_hw_name $ip]
-	set type [xget_hw_value $ip]
+	set name [hw_name $ip]
 
-	foreach over $overrides {
-		if {[lindex $over 0] == "phy"} {
-			if { [xget_hw_name $ip] == [lindex $over 1] } {
-				set phya [lindex $over 2]
-				set phy_chip [lindex $over 3]
-			} else {
-				puts "PHY: Not valid PHY addr for this ip: $name/$type"
-			}
-		}
+	if {[info exists override_index(phy,$name)]} {
+		set phya [lindex $override_index(phy,$name) 0]
+		set phy_chip [lindex $override_index(phy,$name) 1]
 	}
 
 	set phy_name [format_ip_name phy $phya "phy$phy_count"]
 	set phy_tree [list $phy_name tree {}]
-	set phy_tree [tree_append $phy_tree [list "reg" int $phya]]
-	set phy_tree [tree_append $phy_tree [list "device_type" string "ethernet-phy"]]
-	set phy_tree [tree_append $phy_tree [list "compatible" string "$phy_chip"]]
+	tree_lappend phy_tree [list "reg" int $phya]
+	tree_lappend phy_tree [list "device_type" string "ethernet-phy"]
+	tree_lappend phy_tree [list "compatible" string "$phy_chip"]
 
 	incr phy_count
 	return $phy_tree
@@ -3397,8 +4438,8 @@ proc gen_mdiotree {ip} {
 	set phya 7
 	set phy_chip "marvell,88e1111"
 	set mdio_tree [list "mdio" tree {}]
-	set mdio_tree [tree_append $mdio_tree [list \#size-cells int 0]]
-	set mdio_tree [tree_append $mdio_tree [list \#address-cells int 1]]
+	tree_lappend mdio_tree [list \#size-cells int 0]
+	tree_lappend mdio_tree [list \#address-cells int 1]
 	return [tree_append $mdio_tree [gen_phytree $ip $phya $phy_chip]]
 }
 
@@ -3459,11 +4500,11 @@ proc gen_params {node_list handle params {trimprefix "C_"} } {
 			}
 			lappend node_list [list [format_param_name $par_name $trimprefix] hexint $par_value]
 		} {err}]} {
-			set par_handle [xget_hw_parameter_handle $handle $par_name]
+			set par_handle [hw_parameter_handle $handle $par_name]
 			if {$par_handle == ""} {
 				debug warning "Warning: Unknown parameter name $par_name"
 			} else {
-				set par_value [xget_hw_value $par_handle]
+				set par_value [hw_value $par_handle]
 			}
 			lappend node_list [list [format_param_name $par_name $trimprefix] string $par_value]
 		}
@@ -3471,53 +4512,150 @@ proc gen_params {node_list handle params {trimprefix "C_"} } {
 	return $node_list
 }
 
+# Compatible strings by IP type, type_hwver or type_major version
+# compatible_list($key) - list of compatible names which follow the first one
+# Entries can be added or replaced with register_compatible or from the
+# compatible_file MLD parameter.
+variable compatible_list
+array set compatible_list [ list \
+	{opb_intc} {xps_intc_1.00.a} \
+	{opb_timer} {xps_timer_1.00.a} \
+	{xps_timer} {xps_timer_1.00.a} \
+	{axi_timer} {xps_timer_1.00.a} \
+	{mpmc} {mpmc_3.00.a} \
+	{plb_v46} {plb_v46_1.00.a} \
+	{plbv46_pci} {plbv46_pci_1.03.a} \
+	{xps_bram_if_cntlr} {xps_bram_if_cntlr_1.00.a} \
+	{axi_bram_ctrl} {xps_bram_if_cntlr_1.00.a} \
+	{xps_ethernetlite} {xps_ethernetlite_1.00.a} \
+	{axi_ethernetlite} {xps_ethernetlite_1.00.a} \
+	{xps_gpio} {xps_gpio_1.00.a} \
+	{axi_gpio} {xps_gpio_1.00.a} \
+	{xps_hwicap} {xps_hwicap_1.00.a} \
+	{xps_tft} {xps_tft_1.00.a} \
+	{axi_tft} {xps_tft_1.00.a} \
+	{xps_iic} {xps_iic_2.00.a} \
+	{axi_iic} {xps_iic_2.00.a} \
+	{xps_intc} {xps_intc_1.00.a} \
+	{axi_intc} {xps_intc_1.00.a} \
+	{xps_ll_temac} {xps_ll_temac_1.01.b xps_ll_temac_1.00.a} \
+	{xps_ll_fifo} {xps_ll_fifo_1.00.a} \
+	{axi_ethernet} {axi_ethernet_1.00.a} \
+	{axi_ethernet_buffer} {axi_ethernet_1.00.a} \
+	{axi_dma} {axi_dma_1.00.a} \
+	{xps_ps2} {xps_ps2_1.00.a} \
+	{xps_spi_2} {xps_spi_2.00.a} \
+	{axi_spi} {xps_spi_2.00.a} \
+	{axi_quad_spi} {xps_spi_2.00.a} \
+	{xps_uart16550_2} {xps_uart16550_2.00.a} \
+	{axi_uart16550} {xps_uart16550_2.00.a} \
+	{xps_uartlite} {xps_uartlite_1.00.a} \
+	{axi_uartlite} {xps_uartlite_1.00.a} \
+	{xps_timebase_wdt} {xps_timebase_wdt_1.00.a} \
+	{axi_timebase_wdt} {xps_timebase_wdt_1.00.a} \
+	{xps_can} {xps_can_1.00.a} \
+	{axi_can} {xps_can_1.00.a} \
+	{xps_sysace} {xps_sysace_1.00.a} \
+	{axi_sysace} {xps_sysace_1.00.a} \
+	{xps_usb_host} {xps_usb_host_1.00.a} \
+	{xps_usb2_device} {xps_usb2_device_4.00.a} \
+	{axi_usb2_device} {xps_usb2_device_4.00.a} \
+	{axi_pcie} {axi_pcie_1.05.a} \
+	{ps7_ddrc} {ps7-ddrc} \
+]
+
+# Built-in entries, restored at the start of every run so entries of one
+# run's compatible_file don't leak into the next
+variable compatible_list_builtin [array get compatible_list]
+
+# Resolved compatible lists before overrides are applied
+# compatible_memo($type,$hw_ver,$other_compatibles) - compatible list
+variable compatible_memo
+array set compatible_memo {}
+
+proc clear_registered_compatibles {} {
+	variable compatible_list
+	variable compatible_list_builtin
+	variable compatible_memo
+
+	array unset compatible_list
+	array set compatible_list $compatible_list_builtin
+	array unset compatible_memo
+	array set compatible_memo {}
+}
+
+# Entries of compatible_list for type, its versions included
+proc compatible_entries {type} {
+	variable compatible_list
+
+	set entries {}
+	foreach key [lsort [concat [array names compatible_list $type] [array names compatible_list "${type}_*"]]] {
+		lappend entries $key $compatible_list($key)
+	}
+	return $entries
+}
+
+proc register_compatible {key compatibles} {
+	variable compatible_list
+	variable compatible_memo
+
+	set compatible_list($key) $compatibles
+	array unset compatible_memo
+	array set compatible_memo {}
+}
+
+# Read compatible strings of in-house cores from filepath
+# One entry per line: <IP type>[_<HW version>] <compatible> [<compatible>...]
+# written like compatible_list entries, without the xlnx, prefix. Empty lines and lines starting with # are ignored.
+proc load_compatible_file {filepath} {
+	if {[string match "" $filepath] || ![visited_add compatible_files [file normalize $filepath]]} {
+		return
+	}
+	if {[catch {open $filepath r} fd]} {
+		error "Compatible file $filepath not found"
+	}
+	debug info "Loading compatible strings from $filepath"
+	set lines [split [read $fd] "\n"]
+	close $fd
+	foreach line $lines {
+		set line [string trim $line]
+		if {[string match "" $line] || [string match "#*" $line]} {
+			continue
+		}
+		if {[llength $line] < 2} {
+			error "Wrong compatible file entry in $filepath - $line"
+		}
+		register_compatible [lindex $line 0] [lrange $line 1 end]
+	}
+}
+
 proc gen_compatible_property {nodename type hw_ver {other_compatibles {}} } {
-	array set compatible_list [ list \
-		{opb_intc} {xps_intc_1.00.a} \
-		{opb_timer} {xps_timer_1.00.a} \
-		{xps_timer} {xps_timer_1.00.a} \
-		{axi_timer} {xps_timer_1.00.a} \
-		{mpmc} {mpmc_3.00.a} \
-		{plb_v46} {plb_v46_1.00.a} \
-		{plbv46_pci} {plbv46_pci_1.03.a} \
-		{xps_bram_if_cntlr} {xps_bram_if_cntlr_1.00.a} \
-		{axi_bram_ctrl} {xps_bram_if_cntlr_1.00.a} \
-		{xps_ethernetlite} {xps_ethernetlite_1.00.a} \
-		{axi_ethernetlite} {xps_ethernetlite_1.00.a} \
-		{xps_gpio} {xps_gpio_1.00.a} \
-		{axi_gpio} {xps_gpio_1.00.a} \
-		{xps_hwicap} {xps_hwicap_1.00.a} \
-		{xps_tft} {xps_tft_1.00.a} \
-		{axi_tft} {xps_tft_1.00.a} \
-		{xps_iic} {xps_iic_2.00.a} \
-		{axi_iic} {xps_iic_2.00.a} \
-		{xps_intc} {xps_intc_1.00.a} \
-		{axi_intc} {xps_intc_1.00.a} \
-		{xps_ll_temac} {xps_ll_temac_1.01.b xps_ll_temac_1.00.a} \
-		{xps_ll_fifo} {xps_ll_fifo_1.00.a} \
-		{axi_ethernet} {axi_ethernet_1.00.a} \
-		{axi_ethernet_buffer} {axi_ethernet_1.00.a} \
-		{axi_dma} {axi_dma_1.00.a} \
-		{xps_ps2} {xps_ps2_1.00.a} \
-		{xps_spi_2} {xps_spi_2.00.a} \
-		{axi_spi} {xps_spi_2.00.a} \
-		{axi_quad_spi} {xps_spi_2.00.a} \
-		{xps_uart16550_2} {xps_uart16550_2.00.a} \
-		{axi_uart16550} {xps_uart16550_2.00.a} \
-		{xps_uartlite} {xps_uartlite_1.00.a} \
-		{axi_uartlite} {xps_uartlite_1.00.a} \
-		{xps_timebase_wdt} {xps_timebase_wdt_1.00.a} \
-		{axi_timebase_wdt} {xps_timebase_wdt_1.00.a} \
-		{xps_can} {xps_can_1.00.a} \
-		{axi_can} {xps_can_1.00.a} \
-		{xps_sysace} {xps_sysace_1.00.a} \
-		{axi_sysace} {xps_sysace_1.00.a} \
-		{xps_usb_host} {xps_usb_host_1.00.a} \
-		{xps_usb2_device} {xps_usb2_device_4.00.a} \
-		{axi_usb2_device} {xps_usb2_device_4.00.a} \
-		{axi_pcie} {axi_pcie_1.05.a} \
-		{ps7_ddrc} {ps7-ddrc} \
-	]
+	variable compatible_memo
+
+	set key "$type,$hw_ver,$other_compatibles"
+	if {[info exists compatible_memo($key)]} {
+		set clist $compatible_memo($key)
+	} else {
+		set clist [resolve_compatible $type $hw_ver $other_compatibles]
+		set compatible_memo($key) $clist
+	}
+
+	# Command: "compatible -replace/-append <IP name> <compatible list>"
+	# or: "compatible <IP name> <compatible list>" where replace is used
+	set over [override_compatible $nodename]
+	if {[lindex $over 0] == "-append"} {
+		# Append it to the list
+		set clist [concat $clist [lindex $over 1]]
+	} elseif {[lindex $over 0] == "-replace"} {
+		# Replace the whole compatible property list
+		set clist [lindex $over 1]
+	}
+
+	return [list "compatible" stringtuple $clist]
+}
+
+proc resolve_compatible {type hw_ver other_compatibles} {
+	variable compatible_list
 
 	if {$hw_ver != ""} {
 		set namewithver [format "%s_%s" $type $hw_ver]
@@ -3542,48 +4680,11 @@ proc gen_compatible_property {nodename type hw_ver {other_compatibles {}} } {
 	} else {
 		set clist [list [format_xilinx_name "$type"]]
 	}
-	set clist [concat $clist $other_compatibles]
-
-	# Command: "compatible -replace/-append <IP name> <compatible list>"
-	# or: "compatible <IP name> <compatible list>" where replace is used
-	global overrides
-	foreach i $overrides {
-		# skip others overrides
-		if { [lindex "$i" 0] != "compatible" } {
-			continue;
-		}
-		# Compatible command have at least 4 elements in the list
-		if { [llength $i] < 3 } {
-			error "Wrong compatible override command string - $i"
-		}
-		# Check command and then IP name
-		if { [string match [lindex "$i" 1] "-append"] } {
-	                if { [string match [lindex "$i" 2] "$nodename"] } {
-				# Append it to the list
-				set compact [lrange "$i" 3 end]
-				set clist [concat $clist $compact]
-				break;
-			}
-		} elseif { [string match [lindex "$i" 1] "-replace"] } {
-	                if { [string match [lindex "$i" 2] "$nodename"] } {
-				# Replace the whole compatible property list
-				set clist [lrange "$i" 3 end]
-				break;
-			}
-		} else {
-	                if { [string match [lindex "$i" 1] "$nodename"] } {
-				# Replace behavior
-				set clist [lrange "$i" 2 end]
-				break;
-			}
-		}
-	}
-
-	return [list "compatible" stringtuple $clist]
+	return [concat $clist $other_compatibles]
 }
 
 proc validate_ranges_property {slave parent_baseaddr parent_highaddr child_baseaddr} {
-	set nodename [xget_hw_name $slave]
+	set nodename [hw_name $slave]
 	if { ![llength $parent_baseaddr] || ![llength $parent_highaddr] } {
 		error "Bad address range $nodename"
 	}
@@ -3597,45 +4698,262 @@ proc validate_ranges_property {slave parent_baseaddr parent_highaddr child_basea
 	return $size
 }
 
-proc gen_ranges_property {slave parent_baseaddr parent_highaddr child_baseaddr} {
-	set size [validate_ranges_property $slave $parent_baseaddr $parent_highaddr $child_baseaddr]
-	return [list "ranges" hexinttuple [list $child_baseaddr $parent_baseaddr $size]]
+# child_cells: {address_cells size_cells} of the node with the ranges
+proc gen_ranges_property {slave parent_baseaddr parent_highaddr child_baseaddr {child_cells {1 1}}} {
+	return [gen_ranges_property_list $slave [list [list $parent_baseaddr $parent_highaddr $child_baseaddr]] $child_cells]
 }
 
-proc gen_ranges_property_list {slave rangelist} {
+proc gen_ranges_property_list {slave rangelist {child_cells {1 1}}} {
+	set parent_cells [lindex [cells_current] 0]
 	set ranges {}
 	foreach range $rangelist {
 		set parent_baseaddr [lindex $range 0]
 		set parent_highaddr [lindex $range 1]
 		set child_baseaddr [lindex $range 2]
 		set size [validate_ranges_property $slave $parent_baseaddr $parent_highaddr $child_baseaddr]
-		lappend ranges $child_baseaddr $parent_baseaddr $size
+		set ranges [concat $ranges [encode_cells $child_baseaddr [lindex $child_cells 0]] \
+			[encode_cells $parent_baseaddr $parent_cells] \
+			[encode_cells $size [lindex $child_cells 1]]]
 	}
 	return [list "ranges" hexinttuple $ranges]
 }
 
+# Interrupts of the ports go to interrupts and interrupt-parent, or to
+# interrupts-extended when they are connected to several controllers
 proc gen_interrupt_property {tree slave intc interrupt_port_list} {
-	set intc_name [xget_hw_name $intc]
-	set interrupt_list {}
+	set parents {}
+	set specifiers {}
+	set indexes {}
+	set ports {}
+	if {[llength [override_irq [hw_name $slave]]] != 0} {
+		set ports [string tolower [interrupt_list $slave]]
+	}
 	foreach in $interrupt_port_list {
-		set irq [get_intr $slave $intc $in]
+		set route [irq_route $slave $intc $in]
+		if {[llength $route] == 0} {
+			continue
+		}
+		# Overrides are assigned across all interrupts of the IP, so
+		# subnodes which get some of them use their own values
+		set index [lsearch -exact $ports [string tolower $in]]
+		if {$index < 0} {
+			set index [llength $specifiers]
+		}
+		lappend indexes $index
+		set controller [lindex $route 0]
+		set irq_type [get_intr_type $controller $slave $in]
+		if { "[hw_value $controller]" == "ps7_scugic" } {
+			lappend specifiers [list 0 [lindex $route 1] $irq_type]
+		} else {
+			lappend specifiers [list [lindex $route 1] $irq_type]
+		}
+		lappend parents [hw_name $controller]
+	}
+	if {[llength $specifiers] == 0} {
+		return $tree
+	}
+	if {[llength [lsort -unique $parents]] == 1} {
+		tree_lappend tree [list "interrupts" inttuple [eval concat $specifiers]]
+		tree_lappend tree [list "interrupt-parent" labelref [lindex $parents 0]]
+	} else {
+		set cells {}
+		foreach parent $parents specifier $specifiers {
+			lappend cells "&$parent"
+			set cells [concat $cells $specifier]
+		}
+		tree_lappend tree [list "interrupts-extended" celltuple $cells]
+	}
+	return [gen_irq_hints $tree [hw_name $slave] $indexes]
+}
+
+# Interrupt affinity and priority
+# "irq <IP name> affinity <CPU>..." adds interrupt-affinity with the CPU
+# node of every interrupt of the IP, CPUs are instance names or numbers
+# and are used in turn, so "affinity 0 1" puts the first interrupt on CPU
+# 0 and the second on CPU 1. "irq <IP name> priority <priority>..." adds
+# xlnx,interrupt-priority the same way, 0 is the highest GIC priority.
+# The n-th interrupt is the n-th interrupt port of the IP in interrupt_list
+# order, also when it is reported on a subnode.
+# IP names can be glob patterns, later overrides win.
+# Both properties are hints for the boot code or a custom driver, Linux
+# only reads interrupt-affinity on arm,pmu nodes and never reads
+# xlnx,interrupt-priority.
+
+# Return {setting values ...} of the irq overrides of IP name
+proc override_irq {name} {
+	array set settings {}
+	foreach over [override_list "irq"] {
+		if {[string match [lindex $over 1] $name]} {
+			set settings([lindex $over 2]) [lrange $over 3 end]
+		}
+	}
+	return [array get settings]
+}
 
-		if {![string match $irq "-1"]} {
-			set irq_type [get_intr_type $intc $slave $in]
-			if { "[xget_hw_value $intc]" == "ps7_scugic" } {
-				lappend interrupt_list 0 $irq $irq_type
+# Labels of the CPU nodes for the values of an affinity override
+proc irq_affinity_cpus {values} {
+	set cpus {}
+	set procs {}
+	foreach value $values {
+		if {![string is integer -strict $value]} {
+			lappend cpus [string tolower $value]
+			continue
+		}
+		if {[llength $procs] == 0} {
+			set hwproc_handle [xget_handle [xget_libgen_proc_handle] "IPINST"]
+			if {[hw_value $hwproc_handle] == "ps7_cortexa9"} {
+				set procs [xget_cortexa9_handles [hw_parent_handle $hwproc_handle]]
 			} else {
-				lappend interrupt_list $irq $irq_type
+				set procs [list $hwproc_handle]
 			}
 		}
+		if {$value < 0 || $value >= [llength $procs]} {
+			error "Wrong irq affinity - CPU $value, there are [llength $procs] CPUs"
+		}
+		lappend cpus [hw_name [lindex $procs $value]]
+	}
+	return $cpus
+}
+
+# Add the irq override properties for the interrupts of IP name in the
+# tree, indexes are their numbers among all interrupts of the IP
+proc gen_irq_hints {tree name indexes} {
+	if {[llength $indexes] == 0} {
+		return $tree
+	}
+	array set settings [override_irq $name]
+	if {[info exists settings(affinity)]} {
+		set cpus [irq_affinity_cpus $settings(affinity)]
+		set refs {}
+		foreach i $indexes {
+			lappend refs [lindex $cpus [expr {$i % [llength $cpus]}]]
+		}
+		tree_lappend tree [list "interrupt-affinity" labelreftuple $refs]
 	}
-	if {[llength $interrupt_list] != 0} {
-		set tree [tree_append $tree [list "interrupts" inttuple $interrupt_list]]
-		set tree [tree_append $tree [list "interrupt-parent" labelref $intc_name]]
+	if {[info exists settings(priority)]} {
+		set values $settings(priority)
+		set priorities {}
+		foreach i $indexes {
+			lappend priorities [lindex $values [expr {$i % [llength $values]}]]
+		}
+		tree_lappend tree [list "xlnx,interrupt-priority" inttuple $priorities]
 	}
 	return $tree
 }
 
+# Address and size cells
+# The context keeps cells_stack, {address_cells size_cells} of the buses
+# being generated with the innermost last. reg is encoded with the cells of
+# the current bus, ranges with the cells of the child node and the bus.
+proc cells_valid {cells} {
+	if {[llength $cells] != 2} {
+		return 0
+	}
+	foreach cell $cells {
+		if {![string is integer -strict $cell] || $cell < 1 || $cell > 4} {
+			return 0
+		}
+	}
+	return 1
+}
+
+# Cells of the root node from the address_cells and size_cells parameters
+proc root_cells {} {
+	context_var address_cells size_cells
+
+	set cells {}
+	foreach var {address_cells size_cells} {
+		if {[info exists $var] && ![string match "" [set $var]]} {
+			lappend cells [set $var]
+		} else {
+			lappend cells 1
+		}
+	}
+	if {![cells_valid $cells]} {
+		error "Wrong address_cells/size_cells - $cells"
+	}
+	return $cells
+}
+
+# Cells of a bus node, the root cells unless the cells override is used
+proc bus_cells {bus_name} {
+	variable override_index
+
+	if {[info exists override_index(cells,$bus_name)]} {
+		return $override_index(cells,$bus_name)
+	}
+	return [root_cells]
+}
+
+proc cells_push {cells} {
+	context_var cells_stack
+
+	lappend cells_stack $cells
+}
+
+proc cells_pop {} {
+	context_var cells_stack
+
+	set cells_stack [lrange $cells_stack 0 end-1]
+}
+
+# Cells of the current bus
+proc cells_current {} {
+	context_var cells_stack
+
+	set cells [lindex $cells_stack end]
+	if {[llength $cells] == 0} {
+		return {1 1}
+	}
+	return $cells
+}
+
+# #size-cells and #address-cells properties of the current bus
+proc cells_properties {} {
+	set cells [cells_current]
+	return [list [list \#size-cells int [lindex $cells 1]] [list \#address-cells int [lindex $cells 0]]]
+}
+
+# Read {address_cells size_cells} set in a tree, 1 if not set
+proc tree_cells {tree} {
+	set cells {1 1}
+	foreach prop [lindex $tree 2] {
+		switch -exact -- [lindex $prop 0] {
+			"#address-cells" {
+				lset cells 0 [lindex $prop 2]
+			}
+			"#size-cells" {
+				lset cells 1 [lindex $prop 2]
+			}
+		}
+	}
+	return $cells
+}
+
+# Split value into count 32-bit cells, most significant first
+proc encode_cells {value count} {
+	if {$count == 1} {
+		return [list $value]
+	}
+	set out {}
+	for {set i [expr {$count - 1}]} {$i >= 0} {incr i -1} {
+		if {$i >= 2} {
+			lappend out 0
+		} else {
+			lappend out [expr {(wide($value) >> (32 * $i)) & 0xffffffff}]
+		}
+	}
+	return $out
+}
+
+# reg value with the cells of the current bus or with cells
+proc reg_cells {baseaddr size {cells ""}} {
+	if {[llength $cells] == 0} {
+		set cells [cells_current]
+	}
+	return [concat [encode_cells $baseaddr [lindex $cells 0]] [encode_cells $size [lindex $cells 1]]]
+}
+
 proc gen_reg_property {nodename baseaddr highaddr {name "reg"}} {
 	if { ![llength $baseaddr] || ![llength $highaddr] } {
 		error "Bad address range $nodename"
@@ -3651,12 +4969,12 @@ proc gen_reg_property {nodename baseaddr highaddr {name "reg"}} {
 	if { [format %x $size] < 0 } {
 		error "Bad highaddr for $nodename"
 	}
-	return [list $name hexinttuple [list $baseaddr $size]]
+	return [list $name hexinttuple [reg_cells $baseaddr $size]]
 }
 
 proc dts_override {root} {
 	#PARAMETER periph_type_overrides = {dts <IP_name> <parameter> <value_type> <value>}
-	global overrides
+	variable override_index
 
 	foreach iptree $root {
 		if {[lindex $iptree 1] != "tree"} {
@@ -3668,33 +4986,27 @@ proc dts_override {root} {
 		set hw_name [lindex $name_list 0]
 		set node [lindex $iptree 2]
 
-		foreach over $overrides {
-			if {[lindex $over 0] == "dts"} {
-				if { [llength $over] != 5 } {
-					error "Wrong compatible override command string - $over"
+		if {[info exists override_index(dts,$hw_name)]} {
+			foreach over $override_index(dts,$hw_name) {
+				set over_parameter [lindex $over 0]
+				set over_type [lindex $over 1]
+				set over_value [lindex $over 2]
+				set idx 0
+				set node_found 0
+				set new_node ""
+				foreach list $node {
+					set node_parameter [lindex $list 0]
+					if { $over_parameter == $node_parameter } {
+						set new_node "$over_parameter $over_type $over_value"
+						set node [lreplace $node $idx $idx $new_node ]
+						set node_found 1
+					}
+					incr idx
 				}
 
-				if { $hw_name == [lindex $over 1] } {
-					set over_parameter [lindex $over 2]
-					set over_type [lindex $over 3]
-					set over_value [lindex $over 4]
-					set idx 0
-					set node_found 0
-					set new_node ""
-					foreach list $node {
-						set node_parameter [lindex $list 0]
-						if { $over_parameter == $node_parameter } {
-							set new_node "$over_parameter $over_type $over_value"
-							set node [lreplace $node $idx $idx $new_node ]
-							set node_found 1
-						}
-						incr idx
-					}
-
-					if { $node_found == 0 } {
-						set new_node "$over_parameter $over_type $over_value"
-						set node [linsert $node $idx $new_node ]
-					}
+				if { $node_found == 0 } {
+					set new_node "$over_parameter $over_type $over_value"
+					set node [linsert $node $idx $new_node ]
 				}
 			}
 		}
@@ -3714,105 +5026,158 @@ proc dts_override {root} {
 }
 
 proc write_value {file indent type value} {
+	puts -nonewline $file [render_value $indent $type $value]
+}
+
+proc render_value {indent type value} {
+	set out ""
 	if {[catch {
 		if {$type == "int"} {
-			puts -nonewline $file "= <[format %d $value]>"
+			append out "= <[format %d $value]>"
 		} elseif {$type == "hexint"} {
-			# Mask down to 32-bits
-			puts -nonewline $file "= <0x[format %x [expr $value & 0xffffffff]]>"
+			append out "= <0x[format %x [cell_value $value]]>"
 		} elseif {$type == "empty"} {
 		} elseif {$type == "inttuple"} {
-			puts -nonewline $file "= < "
+			append out "= < "
 			foreach element $value {
-				puts -nonewline $file "[format %d $element] "
+				append out "[format %d $element] "
 			}
-			puts -nonewline $file ">"
+			append out ">"
 		} elseif {$type == "hexinttuple"} {
-			puts -nonewline $file "= < "
+			append out "= < "
 			foreach element $value {
-				# Mask down to 32-bits
-				puts -nonewline $file "0x[format %x [expr $element & 0xffffffff]] "
+				append out "0x[format %x [cell_value $element]] "
 			}
-			puts -nonewline $file ">"
+			append out ">"
 		} elseif {$type == "bytesequence"} {
-			puts -nonewline $file "= \[ "
+			append out "= \[ "
 			foreach element $value {
 				if {[expr $element > 255]} {
 					error {"Value $element is not a byte!"}
 				}
-				puts -nonewline $file "[format %02x $element] "
+				append out "[format %02x $element] "
 			}
-			puts -nonewline $file "\]"
+			append out "\]"
 		} elseif {$type == "labelref"} {
-			puts -nonewline $file "= <&$value>"
+			append out "= <&$value>"
+		} elseif {$type == "labelreftuple"} {
+			append out "= < "
+			foreach element $value {
+				append out "&$element "
+			}
+			append out ">"
 		} elseif {$type == "labelref-ext"} {
-			puts -nonewline $file "= < &"
+			append out "= < &"
+			foreach element $value {
+				append out "$element "
+			}
+			append out ">"
+		} elseif {$type == "celltuple"} {
+			# cells mixed with &label references
+			append out "= < "
 			foreach element $value {
-				puts -nonewline $file "$element "
+				if {[string index $element 0] == "&"} {
+					append out "$element "
+				} else {
+					append out "0x[format %x [cell_value $element]] "
+				}
 			}
-			puts -nonewline $file ">"
+			append out ">"
 		} elseif {$type == "aliasref"} {
-			puts -nonewline $file "= &$value"
+			append out "= &$value"
 		} elseif {$type == "string"} {
-			puts -nonewline $file "= \"$value\""
+			append out "= \"$value\""
 		} elseif {$type == "stringtuple"} {
-			puts -nonewline $file "= "
+			append out "= "
 			set first true
 			foreach element $value {
-				if {$first != true} { puts -nonewline $file ", " }
-				puts -nonewline $file "\"$element\""
+				if {$first != true} { append out ", " }
+				append out "\"$element\""
 				set first false
 			}
 		} elseif {$type == "tree"} {
-			puts $file "{"
-			write_tree $indent $file $value
-			puts -nonewline $file "} "
+			append out "{\n"
+			append out [render_tree $indent $value]
+			append out "} "
 		} else {
 			puts "unknown type $type"
 		}
 	} {error}]} {
 		puts $error
-		puts -nonewline $file "= \"$value\""
+		append out "= \"$value\""
 	}
-	puts $file ";"
+	append out ";\n"
+	return $out
 }
 
-# tree: a tree triple
+# treevar: name of variable with a tree triple
 # child_node: a tree triple
-# returns: tree with child_node appended to the list of child nodes
-proc tree_append {tree child_node} {
+# Appends child_node to the list of child nodes in place and returns the tree.
+# The tree is released before lappend, so the child list isn't copied.
+proc tree_lappend {treevar child_node} {
+	upvar $treevar tree
 	if {[lindex $tree 1] != "tree"} {
-		error {"tree_append called on $tree, which is not a tree."}
+		error "tree_lappend called on $tree, which is not a tree."
 	}
 	set name [lindex $tree 0]
 	set node [lindex $tree 2]
+	set tree {}
 	lappend node $child_node
-	return [list $name tree $node]
+	set tree [list $name tree $node]
+}
+
+# Mask value down to one 32-bit cell, warn if it doesn't fit
+proc cell_value {value} {
+	set cell [expr {$value & 0xffffffff}]
+	if {$value > 0xffffffff || $value < -0x80000000} {
+		debug warning "Warning!: [format 0x%lx $value] doesn't fit in a 32-bit cell, using [format 0x%x $cell]"
+	}
+	return $cell
 }
 
 # tree: a tree triple
+# child_node: a tree triple
+# returns: tree with child_node appended to the list of child nodes
+proc tree_append {tree child_node} {
+	return [tree_lappend tree $child_node]
+}
+
+# treevar: name of variable with a tree triple
 # child_node_name: name of the childe node that will be updated
 # new_child_node: the new child_node node
-proc tree_node_update {tree child_node_name new_child_node} {
+# Replaces the child nodes in place and returns the tree.
+proc tree_node_lset {treevar child_node_name new_child_node} {
+	upvar $treevar tree
 	if {[lindex $tree 1] != "tree"} {
-		error {"tree_append called on $tree, which is not a tree."}
+		error "tree_node_lset called on $tree, which is not a tree."
 	}
 	set name [lindex $tree 0]
 	set node [lindex $tree 2]
-	set new_node []
+	set tree {}
 
-	foreach p [lindex $tree 2] {
-		set node_name [lindex $p 0]
-		if { "[string compare $node_name $child_node_name ]" == "0" } {
-			lappend new_node $new_child_node
-		} else {
-			lappend new_node $p
+	set idx 0
+	foreach p $node {
+		if {[string equal [lindex $p 0] $child_node_name]} {
+			lset node $idx $new_child_node
 		}
+		incr idx
 	}
-	return [list $name tree $new_node]
+	set tree [list $name tree $node]
+}
+
+# tree: a tree triple
+# child_node_name: name of the childe node that will be updated
+# new_child_node: the new child_node node
+proc tree_node_update {tree child_node_name new_child_node} {
+	return [tree_node_lset tree $child_node_name $new_child_node]
 }
 
 proc write_nodes {indent file tree} {
+	puts -nonewline $file [render_nodes $indent $tree]
+}
+
+proc render_nodes {indent tree} {
+	set out ""
 	set tree [lsort -index 0 $tree]
 	foreach node $tree {
 		if { [string match [expr [llength $node] % 3]  "0"] && [expr [llength $node] > 0]} {
@@ -3821,22 +5186,28 @@ proc write_nodes {indent file tree} {
 				set name [lindex $node [expr $i * 3 ]]
 				set type [lindex $node [expr $i * 3 + 1]]
 				set value [lindex $node [expr $i * 3 + 2]]
-				puts -nonewline $file "[tt [expr $indent + 1]]$name "
-				write_value $file [expr $indent + 1] $type $value
+				append out "[tt [expr $indent + 1]]$name "
+				append out [render_value [expr $indent + 1] $type $value]
 			}
 		} elseif { [string match [llength $node] "4"] && [string match [lindex $node 1] "aliasref"] } {
 			set name [lindex $node 0]
 			set type [lindex $node 1]
 			set value [lindex $node 2]
-			puts -nonewline $file "[tt [expr $indent + 1]]$name "
-			write_value $file [expr $indent + 1] $type $value
+			append out "[tt [expr $indent + 1]]$name "
+			append out [render_value [expr $indent + 1] $type $value]
 		} else {
 			puts "Error_bad_tree_node length = [llength $node], $node"
 		}
 	}
+	return $out
 }
 
 proc write_tree {indent file tree} {
+	puts -nonewline $file [render_tree $indent $tree]
+}
+
+# Render tree into a string, properties first and then subnodes
+proc render_tree {indent tree} {
 	set trees {}
 	set nontrees {}
 	foreach node $tree {
@@ -3846,13 +5217,62 @@ proc write_tree {indent file tree} {
 			lappend nontrees $node
 		}
 	}
-	write_nodes $indent $file $nontrees
-	write_nodes $indent $file $trees
+	set out [render_nodes $indent $nontrees]
+	append out [render_nodes $indent $trees]
+	append out [tt $indent]
+	return $out
+}
 
-	puts -nonewline $file "[tt $indent]"
+# Label index of the final tree, filled by one walk of tree_index
+# tree_label_index($label) - full path of the node with the label
+# tree_path_index($path) - label of the node on the path, can be empty
+variable tree_label_index
+variable tree_path_index
+array set tree_label_index {}
+array set tree_path_index {}
+
+proc tree_index_clear {} {
+	variable tree_label_index
+	variable tree_path_index
+
+	array unset tree_label_index
+	array unset tree_path_index
+	array set tree_label_index {}
+	array set tree_path_index {}
+}
+
+# Index labels and paths of all nodes in the list of tree triples
+proc tree_index {tree {path /}} {
+	variable tree_label_index
+	variable tree_path_index
+
+	foreach node $tree {
+		if {[lindex $node 1] != "tree"} {
+			continue
+		}
+		set fullname [lindex $node 0]
+		set colon [string first ":" $fullname]
+		if {$colon >= 0} {
+			set nodelabel [string trim [string range $fullname 0 [expr {$colon - 1}]]]
+			set nodename [string trim [string range $fullname [expr {$colon + 1}] end]]
+		} else {
+			set nodelabel ""
+			set nodename [string trim $fullname]
+		}
+		if {$nodelabel != "" && ![info exists tree_label_index($nodelabel)]} {
+			set tree_label_index($nodelabel) $path$nodename
+		}
+		set tree_path_index($path$nodename) $nodelabel
+		tree_index [lindex $node 2] "$path$nodename/"
+	}
 }
 
 proc get_pathname_for_label {tree label {path /}} {
+	variable tree_label_index
+
+	if {$path == "/" && [info exists tree_label_index($label)]} {
+		return $tree_label_index($label)
+	}
 	foreach node $tree {
 		set fullname [lindex $node 0]
 		set type [lindex $node 1]
@@ -3870,6 +5290,585 @@ proc get_pathname_for_label {tree label {path /}} {
 	return ""
 }
 
+# Flattened device tree backend
+# Serializes the same tree triples as render_tree into a version 17 blob
+# (header, empty memory reserve map, structure block, strings block).
+# Labels referenced through labelref/labelref-ext get phandles and
+# aliasref properties are resolved to node paths.
+#
+# fdt_state(label,$label) - path of the node with $label
+# fdt_state(ref,$label) - $label is referenced
+# fdt_state(explicit,$path) - phandle already set by the node itself
+# fdt_state(phandle,$path) - phandle of the node at $path
+# fdt_state(used,$phandle) - phandle is taken
+# fdt_state(string,$name) - offset of $name in the strings block
+#
+# Overlays (fdt_state(overlay) set) reference labels of the base tree with
+# phandle 0xffffffff, listed in the __fixups__ node, and references of
+# their own nodes in __local_fixups__, so the loader can rewrite them.
+# fdt_state(where) - {path property} being encoded
+# fdt_state(fixup,$label) - path:property:offset of external references
+# fdt_state(localpaths) - paths with local references
+# fdt_state(localprops,$path) - properties of $path with local references
+# fdt_state(local,$path,$prop) - offsets of local references in $prop
+#
+# Base trees for overlays (fdt_state(symbols) set) give every labelled
+# node a phandle and list the labels with their paths in __symbols__,
+# like dtc -@.
+variable fdt_state
+array set fdt_state {}
+variable fdt_struct ""
+variable fdt_strings ""
+
+# structure block tokens
+variable fdt_begin_node 1
+variable fdt_end_node 2
+variable fdt_prop 3
+variable fdt_end 9
+
+# Split node name to label and name
+proc fdt_node_name {fullname} {
+	if {[regexp {^([^:]+):\s*(.*)$} $fullname match label name]} {
+		return [list [string trim $label] [string trim $name]]
+	}
+	return [list "" $fullname]
+}
+
+# Return property triples and subnode triples of tree in the same order
+# as render_tree writes them.
+proc fdt_split_tree {tree} {
+	set trees {}
+	set nontrees {}
+	foreach node $tree {
+		if { [string match [lindex $node 1] "tree"]} {
+			lappend trees $node
+		} else {
+			lappend nontrees $node
+		}
+	}
+	set props {}
+	set subnodes {}
+	foreach node [concat [lsort -index 0 $nontrees] [lsort -index 0 $trees]] {
+		if { [string match [expr [llength $node] % 3]  "0"] && [expr [llength $node] > 0]} {
+			foreach {name type value} $node {
+				if {$type == "tree"} {
+					lappend subnodes [list $name $type $value]
+				} else {
+					lappend props [list $name $type $value]
+				}
+			}
+		} elseif { [string match [llength $node] "4"] && [string match [lindex $node 1] "aliasref"] } {
+			lappend props [lrange $node 0 2]
+		} else {
+			debug warning "Warning: DTB skips bad tree node $node"
+		}
+	}
+	return [list $props $subnodes]
+}
+
+# Record labels, explicit phandles and label references
+proc fdt_scan_tree {tree path} {
+	variable fdt_state
+
+	set split [fdt_split_tree $tree]
+	foreach prop [lindex $split 0] {
+		set name [lindex $prop 0]
+		set type [lindex $prop 1]
+		set value [lindex $prop 2]
+		switch -exact $type {
+			"labelref" {
+				set fdt_state(ref,$value) 1
+			}
+			"labelreftuple" {
+				foreach element $value {
+					set fdt_state(ref,$element) 1
+				}
+			}
+			"labelref-ext" {
+				set fdt_state(ref,[lindex [eval concat $value] 0]) 1
+			}
+			"celltuple" {
+				foreach element $value {
+					if {[string index $element 0] == "&"} {
+						set fdt_state(ref,[string range $element 1 end]) 1
+					}
+				}
+			}
+		}
+		if {$name == "phandle" || $name == "linux,phandle"} {
+			if {![catch {set phandle [expr [lindex [eval concat $value] 0]]}]} {
+				set fdt_state(explicit,$path) $phandle
+				set fdt_state(phandle,$path) $phandle
+				set fdt_state(used,$phandle) 1
+			}
+		}
+	}
+	foreach node [lindex $split 1] {
+		set name [fdt_node_name [lindex $node 0]]
+		if {$path == "/"} {
+			set subpath "/[lindex $name 1]"
+		} else {
+			set subpath "$path/[lindex $name 1]"
+		}
+		if {[lindex $name 0] != ""} {
+			set fdt_state(label,[lindex $name 0]) $subpath
+		}
+		fdt_scan_tree [lindex $node 2] $subpath
+	}
+}
+
+proc fdt_assign_phandles {} {
+	variable fdt_state
+
+	set next 1
+	foreach key [lsort [array names fdt_state ref,*]] {
+		set label [string range $key 4 end]
+		if {![info exists fdt_state(label,$label)]} {
+			if {!$fdt_state(overlay)} {
+				debug warning "Warning: DTB reference to unknown label $label"
+			}
+			continue
+		}
+		set path $fdt_state(label,$label)
+		if {[info exists fdt_state(phandle,$path)]} {
+			continue
+		}
+		while {[info exists fdt_state(used,$next)]} {
+			incr next
+		}
+		set fdt_state(phandle,$path) $next
+		set fdt_state(used,$next) 1
+	}
+}
+
+proc fdt_label_phandle {label} {
+	variable fdt_state
+
+	if {![info exists fdt_state(label,$label)]} {
+		error "Unknown label $label"
+	}
+	return $fdt_state(phandle,$fdt_state(label,$label))
+}
+
+# Phandle cell of a reference to label at byte offset of the property
+# being encoded
+proc fdt_reference {label offset} {
+	variable fdt_state
+
+	if {!$fdt_state(overlay)} {
+		return [fdt_cell [fdt_label_phandle $label]]
+	}
+	set path [lindex $fdt_state(where) 0]
+	set prop [lindex $fdt_state(where) 1]
+	if {![info exists fdt_state(label,$label)]} {
+		lappend fdt_state(fixup,$label) "$path:$prop:$offset"
+		return [binary format I 0xffffffff]
+	}
+	if {![info exists fdt_state(localprops,$path)]} {
+		lappend fdt_state(localpaths) $path
+		set fdt_state(localprops,$path) {}
+	}
+	if {[lsearch -exact $fdt_state(localprops,$path) $prop] == -1} {
+		lappend fdt_state(localprops,$path) $prop
+	}
+	lappend fdt_state(local,$path,$prop) $offset
+	return [fdt_cell [fdt_label_phandle $label]]
+}
+
+# __local_fixups__ content for the node at path
+proc fdt_local_fixups {path} {
+	variable fdt_state
+
+	set tree {}
+	if {[info exists fdt_state(localprops,$path)]} {
+		foreach prop $fdt_state(localprops,$path) {
+			lappend tree [list $prop inttuple $fdt_state(local,$path,$prop)]
+		}
+	}
+	if {$path == "/"} {
+		set prefix "/"
+	} else {
+		set prefix "$path/"
+	}
+	set children {}
+	foreach local $fdt_state(localpaths) {
+		if {[string first $prefix $local] == 0 && $local != $path} {
+			lappend children [lindex [split [string range $local [string length $prefix] end] "/"] 0]
+		}
+	}
+	foreach child [lsort -unique $children] {
+		lappend tree [list $child tree [fdt_local_fixups "$prefix$child"]]
+	}
+	return $tree
+}
+
+proc fdt_emit_fixups {} {
+	variable fdt_state
+
+	set fixups {}
+	foreach key [lsort [array names fdt_state fixup,*]] {
+		lappend fixups [list [string range $key 6 end] stringtuple $fdt_state($key)]
+	}
+	set fdt_state(overlay) 0
+	if {[llength $fixups] != 0} {
+		fdt_emit_tree "__fixups__" $fixups "/__fixups__"
+	}
+	if {[llength $fdt_state(localpaths)] != 0} {
+		fdt_emit_tree "__local_fixups__" [fdt_local_fixups "/"] "/__local_fixups__"
+	}
+	set fdt_state(overlay) 1
+}
+
+proc fdt_emit_symbols {} {
+	variable fdt_state
+
+	set symbols {}
+	foreach key [lsort [array names fdt_state label,*]] {
+		lappend symbols [list [string range $key 6 end] string $fdt_state($key)]
+	}
+	if {[llength $symbols] != 0} {
+		fdt_emit_tree "__symbols__" $symbols "/__symbols__"
+	}
+}
+
+proc fdt_cell {value} {
+	return [binary format I [cell_value $value]]
+}
+
+# Padding to 32 bit boundary
+proc fdt_pad {data} {
+	set pad [expr {(4 - [string length $data] % 4) % 4}]
+	if {$pad} {
+		append data [binary format x$pad]
+	}
+	return $data
+}
+
+proc fdt_string_offset {name} {
+	variable fdt_state
+	variable fdt_strings
+
+	if {![info exists fdt_state(string,$name)]} {
+		set fdt_state(string,$name) [string length $fdt_strings]
+		append fdt_strings [binary format a*x $name]
+	}
+	return $fdt_state(string,$name)
+}
+
+# Binary encoding of property value - follows render_value
+proc fdt_value {type value} {
+	variable fdt_state
+
+	set data ""
+	switch -exact $type {
+		"int" {
+			set data [fdt_cell [format %d $value]]
+		}
+		"hexint" {
+			set data [fdt_cell [expr {$value}]]
+		}
+		"empty" {
+		}
+		"inttuple" {
+			foreach element $value {
+				append data [fdt_cell [format %d $element]]
+			}
+		}
+		"hexinttuple" {
+			foreach element $value {
+				append data [fdt_cell [expr {$element}]]
+			}
+		}
+		"bytesequence" {
+			foreach element $value {
+				if {$element > 255} {
+					error "Value $element is not a byte!"
+				}
+				append data [binary format c [expr {$element}]]
+			}
+		}
+		"labelref" {
+			set data [fdt_reference $value 0]
+		}
+		"labelreftuple" {
+			foreach element $value {
+				append data [fdt_reference $element [string length $data]]
+			}
+		}
+		"labelref-ext" {
+			set elements [eval concat $value]
+			set data [fdt_reference [lindex $elements 0] 0]
+			foreach element [lrange $elements 1 end] {
+				append data [fdt_cell [format %d $element]]
+			}
+		}
+		"celltuple" {
+			foreach element $value {
+				if {[string index $element 0] == "&"} {
+					append data [fdt_reference [string range $element 1 end] [string length $data]]
+				} else {
+					append data [fdt_cell [expr {$element}]]
+				}
+			}
+		}
+		"aliasref" {
+			if {![info exists fdt_state(label,$value)]} {
+				error "Unknown label $value"
+			}
+			set data [binary format a*x $fdt_state(label,$value)]
+		}
+		"string" {
+			set data [binary format a*x $value]
+		}
+		"stringtuple" {
+			foreach element $value {
+				append data [binary format a*x $element]
+			}
+		}
+		default {
+			debug warning "Warning: DTB unknown type $type"
+		}
+	}
+	return $data
+}
+
+proc fdt_emit_prop {name data} {
+	variable fdt_struct
+	variable fdt_prop
+
+	append fdt_struct [binary format III $fdt_prop [string length $data] [fdt_string_offset $name]]
+	append fdt_struct [fdt_pad $data]
+}
+
+proc fdt_emit_tree {name tree path} {
+	variable fdt_state
+	variable fdt_struct
+	variable fdt_begin_node
+	variable fdt_end_node
+
+	append fdt_struct [binary format I $fdt_begin_node]
+	append fdt_struct [fdt_pad [binary format a*x $name]]
+
+	set split [fdt_split_tree $tree]
+	foreach prop [lindex $split 0] {
+		set propname [lindex $prop 0]
+		set type [lindex $prop 1]
+		set value [lindex $prop 2]
+		set fdt_state(where) [list $path $propname]
+		if {[catch {set data [fdt_value $type $value]} error]} {
+			debug warning "Warning: DTB $path $propname: $error"
+			set data [binary format a*x $value]
+		}
+		fdt_emit_prop $propname $data
+	}
+	if {[info exists fdt_state(phandle,$path)] && ![info exists fdt_state(explicit,$path)]} {
+		fdt_emit_prop "phandle" [fdt_cell $fdt_state(phandle,$path)]
+	}
+
+	foreach node [lindex $split 1] {
+		set nodename [lindex [fdt_node_name [lindex $node 0]] 1]
+		if {$path == "/"} {
+			set subpath "/$nodename"
+		} else {
+			set subpath "$path/$nodename"
+		}
+		fdt_emit_tree $nodename [lindex $node 2] $subpath
+	}
+	if {$path == "/" && $fdt_state(overlay)} {
+		fdt_emit_fixups
+	}
+	if {$path == "/" && $fdt_state(symbols)} {
+		fdt_emit_symbols
+	}
+	append fdt_struct [binary format I $fdt_end_node]
+}
+
+# Return flattened device tree blob for the root node content,
+# with fixups if it is an overlay and __symbols__ if overlays are
+# applied on top of it
+proc fdt_blob {tree {overlay 0} {symbols 0}} {
+	variable fdt_state
+	variable fdt_struct
+	variable fdt_strings
+	variable fdt_end
+
+	array unset fdt_state
+	array set fdt_state [list overlay $overlay symbols $symbols localpaths {}]
+	set fdt_struct ""
+	set fdt_strings ""
+
+	fdt_scan_tree $tree "/"
+	if {$symbols} {
+		foreach key [array names fdt_state label,*] {
+			set fdt_state(ref,[string range $key 6 end]) 1
+		}
+	}
+	fdt_assign_phandles
+	fdt_emit_tree "" $tree "/"
+	append fdt_struct [binary format I $fdt_end]
+
+	# header, memory reserve map, structure block, strings block
+	set header_size 40
+	set rsvmap [binary format IIII 0 0 0 0]
+	set off_rsvmap $header_size
+	set off_struct [expr {$off_rsvmap + [string length $rsvmap]}]
+	set off_strings [expr {$off_struct + [string length $fdt_struct]}]
+	set totalsize [expr {$off_strings + [string length $fdt_strings]}]
+
+	set blob [binary format IIIIIIIIII 0xd00dfeed $totalsize $off_struct \
+		$off_strings $off_rsvmap 17 16 0 [string length $fdt_strings] \
+		[string length $fdt_struct]]
+	append blob $rsvmap $fdt_struct $fdt_strings
+	return $blob
+}
+
+# Profiling
+# profile_data(calls|usec,$kind,$name) - number of calls and wall time
+# profile_keys - list of {kind name} in order of first occurrence
+# Times of nested phases (bus_bridge) are inclusive.
+variable profile_enabled 0
+variable profile_data
+array set profile_data {}
+variable profile_keys {}
+# Procedures wrapped for timing, xget_* calls are only counted
+variable profile_procs {gen_microblaze gen_ppc440 gen_cortexa9 bus_bridge gen_memories}
+# xget_* procs of the generator itself, they aren't tool calls
+variable profile_script_xget {xget_cortexa9_handles}
+variable profile_wrapped {}
+
+proc profile_clock {} {
+	if {[catch {clock microseconds} now]} {
+		set now [expr {[clock clicks -milliseconds] * 1000}]
+	}
+	return $now
+}
+
+proc profile_add {kind name usec} {
+	variable profile_data
+	variable profile_keys
+
+	if {![info exists profile_data(calls,$kind,$name)]} {
+		set profile_data(calls,$kind,$name) 0
+		set profile_data(usec,$kind,$name) 0
+		lappend profile_keys [list $kind $name]
+	}
+	incr profile_data(calls,$kind,$name)
+	incr profile_data(usec,$kind,$name) $usec
+}
+
+proc profile_begin {} {
+	variable profile_enabled
+
+	if {!$profile_enabled} {
+		return 0
+	}
+	return [profile_clock]
+}
+
+proc profile_end {kind name start} {
+	variable profile_enabled
+
+	if {$profile_enabled} {
+		profile_add $kind $name [expr {[profile_clock] - $start}]
+	}
+}
+
+# Evaluate script in the caller and account its time to phase name
+proc profile_eval {name script} {
+	set start [profile_begin]
+	set code [catch {uplevel 1 $script} result]
+	profile_end phase $name $start
+	if {$code == 1} {
+		global errorInfo errorCode
+		return -code error -errorinfo $errorInfo -errorcode $errorCode $result
+	}
+	return -code $code $result
+}
+
+proc profile_wrap {cmd wrapper} {
+	variable profile_wrapped
+
+	rename $cmd ${cmd}_unprofiled
+	proc $cmd {args} [format $wrapper [list ${cmd}_unprofiled]]
+	lappend profile_wrapped $cmd
+}
+
+proc profile_unwrap {} {
+	variable profile_wrapped
+
+	foreach cmd $profile_wrapped {
+		catch {rename $cmd ""}
+		rename ${cmd}_unprofiled $cmd
+	}
+	set profile_wrapped {}
+}
+
+# Disable profiling, also after a failed profiled run
+proc profile_stop {} {
+	variable profile_enabled
+
+	profile_unwrap
+	set profile_enabled 0
+}
+
+proc profile_start {} {
+	variable profile_enabled
+	variable profile_data
+	variable profile_keys
+	variable profile_procs
+	variable profile_script_xget
+
+	profile_stop
+	array unset profile_data
+	array set profile_data {}
+	set profile_keys {}
+	set profile_enabled 1
+
+	set ns [namespace current]
+	foreach cmd $profile_procs {
+		profile_wrap ${ns}::$cmd [format {
+			set start [%s::profile_clock]
+			set code [catch {uplevel 1 [linsert $args 0 %%s]} result]
+			%s::profile_add phase %s [expr {[%s::profile_clock] - $start}]
+			if {$code == 1} {
+				global errorInfo errorCode
+				return -code error -errorinfo $errorInfo -errorcode $errorCode $result
+			}
+			return -code $code $result
+		} $ns $ns $cmd $ns]
+	}
+	foreach cmd [info commands ::xget_*] {
+		if {[string match "*_unprofiled" $cmd] || [lsearch -exact $profile_script_xget [namespace tail $cmd]] != -1} {
+			continue
+		}
+		profile_wrap $cmd [format {
+			%s::profile_add xget %s 0
+			uplevel 1 [linsert $args 0 %%s]
+		} $ns [namespace tail $cmd]]
+	}
+}
+
+# Write profile_data as CSV: kind,name,calls,usec
+proc profile_finish {filepath} {
+	variable profile_enabled
+	variable profile_data
+	variable profile_keys
+
+	if {!$profile_enabled} {
+		return
+	}
+	profile_stop
+
+	debug info "generating $filepath"
+	set csv "kind,name,calls,usec\n"
+	foreach key $profile_keys {
+		set kind [lindex $key 0]
+		set name [lindex $key 1]
+		append csv "$kind,$name,$profile_data(calls,$kind,$name),$profile_data(usec,$kind,$name)\n"
+	}
+	write_file_atomic $filepath $csv
+}
+
 # help function for debug purpose
 proc debug {level string} {
 	variable debug_level
@@ -3878,38 +5877,104 @@ proc debug {level string} {
 	}
 }
 
-proc dma_channel_config {xdma addr mode intc slave devid} {
-	set modelow [string tolower $mode]
-	set namestring "dma-channel"
-	set channame [format_name [format "%s@%x" $namestring $addr]]
-
-	set chan {}
-	lappend chan [list compatible stringtuple [list [format "xlnx,%s-%s-channel" $xdma $modelow]]]
-	set tmp [scan_int_parameter_value $slave [format "C_INCLUDE_%s_DRE" $mode]]
-	lappend chan [list "xlnx,include-dre" hexint $tmp]
-
-	lappend chan [list "xlnx,device-id" hexint $devid]
-	set tmp [xget_hw_parameter_handle $slave [format "C_%s_AXIS_%s_TDATA_WIDTH" [string index $mode 0] $mode]]
-	if {$tmp != ""} {
-		set tmp [scan_int_parameter_value $slave [format "C_%s_AXIS_%s_TDATA_WIDTH" [string index $mode 0] $mode]]
-		lappend chan [list "xlnx,datawidth" hexint $tmp]
+# Offload and buffer capabilities of Ethernet MACs
+# caps is a list of capability value pairs:
+#   txcsum, rxcsum - checksum offload, 0 none, 1 partial, 2 full
+#   txmem, rxmem - transmit and receive buffer memory in bytes
+#   max-frame - max-frame-size, the MTU, if not given it is the jumbo MTU
+#   when rxmem is at least mac_jumbo_rxmem (like axienet does) and the
+#   standard MTU otherwise
+# Properties already generated from the MAC parameters are kept.
+variable mac_mtu 1500
+variable mac_jumbo_mtu 9000
+variable mac_jumbo_rxmem 0x4000
+
+proc gen_mac_capabilities {tree caps} {
+	variable mac_mtu
+	variable mac_jumbo_mtu
+	variable mac_jumbo_rxmem
+
+	array set cap $caps
+	set props {}
+	foreach key {txcsum rxcsum txmem rxmem} {
+		if {[info exists cap($key)]} {
+			lappend props [list "xlnx,$key" hexint $cap($key)]
+		}
+	}
+	if {[info exists cap(txmem)]} {
+		lappend props [list "tx-fifo-depth" int $cap(txmem)]
 	}
+	if {[info exists cap(rxmem)]} {
+		lappend props [list "rx-fifo-depth" int $cap(rxmem)]
+		if {![info exists cap(max-frame)]} {
+			if {$cap(rxmem) >= $mac_jumbo_rxmem} {
+				set cap(max-frame) $mac_jumbo_mtu
+			} else {
+				set cap(max-frame) $mac_mtu
+			}
+		}
+	}
+	if {[info exists cap(max-frame)]} {
+		lappend props [list "max-frame-size" int $cap(max-frame)]
+	}
+	foreach prop $props {
+		if {![tree_has_property $tree [lindex $prop 0]]} {
+			tree_lappend tree $prop
+		}
+	}
+	return $tree
+}
 
-	set tmp [xget_hw_parameter_handle $slave [format "C_%s_AXIS_%s_DATA_WIDTH" [string index $mode 0] $mode]]
-	if {$tmp != ""} {
-		set tmp [scan_int_parameter_value $slave [format "C_%s_AXIS_%s_DATA_WIDTH" [string index $mode 0] $mode]]
-		lappend chan [list "xlnx,datawidth" hexint $mode]
+# Capabilities from the MAC parameters, params is a list of capability
+# parameter pairs. Parameters missing in older cores are skipped.
+proc mac_capability_params {slave params} {
+	set caps {}
+	foreach {cap param} $params {
+		if {[parameter_exists $slave $param]} {
+			lappend caps $cap [scan_int_parameter_value $slave $param]
+		}
 	}
+	return $caps
+}
 
-	if { [string compare -nocase $xdma "axi-dma"] != 0} {
-		set tmp [scan_int_parameter_value $slave [format "C_%s_GENLOCK_MODE" $mode]]
-		lappend chan [list "xlnx,genlock-mode" hexint $tmp]
+# Property triple name of tree, empty if there is none
+proc tree_property {tree name} {
+	foreach node [lindex $tree 2] {
+		if {[lindex $node 0] == $name} {
+			return $node
+		}
 	}
+	return {}
+}
 
-	set chantree [list $channame tree $chan]
-	set chantree [gen_interrupt_property $chantree $slave $intc [list [format "%s_introut" $modelow]]]
+proc tree_has_property {tree name} {
+	foreach node [lindex $tree 2] {
+		if {[lindex $node 0] == $name} {
+			return 1
+		}
+	}
+	return 0
+}
 
-	return $chantree
+# Name of the IP on the other end of the first connected AXI stream.
+# busifs is a list of interface and peer role pairs.
+proc mac_stream_peer {slave busifs} {
+	set mhs_handle [hw_parent_handle $slave]
+	foreach {name role} $busifs {
+		set busif [hw_busif_handle $slave $name]
+		if {[llength $busif] == 0} {
+			continue
+		}
+		set bus_name [hw_value $busif]
+		if {[llength $bus_name] == 0} {
+			continue
+		}
+		set peer_busif [lindex [xget_hw_connected_busifs_handle $mhs_handle $bus_name $role] 0]
+		if {[llength $peer_busif] != 0} {
+			return [hw_name [hw_parent_handle $peer_busif]]
+		}
+	}
+	return ""
 }
 
 proc is_gmii2rgmii_conv_present {slave} {
@@ -3918,19 +5983,15 @@ proc is_gmii2rgmii_conv_present {slave} {
 	set ipconv 0
 
 	# No any other way how to detect this convertor
-	set mhs_handle [xget_hw_parent_handle $slave]
-	set ips [xget_hw_ipinst_handle $mhs_handle "*"]
-	set ip_name [xget_hw_name $slave]
+	set mhs_handle [hw_parent_handle $slave]
+	set ip_name [hw_name $slave]
 
-	foreach ip $ips {
-		set periph [xget_value $ip "value"]
-		if { [string compare -nocase $periph "gmii_to_rgmii"] == 0} {
-			set ipconv $ip
-			break
-		}
+	set ips [hw_ips_of_type $mhs_handle "gmii_to_rgmii"]
+	if {[llength $ips] != 0} {
+		set ipconv [lindex $ips 0]
 	}
 	if { $ipconv != 0 }  {
-		set port_value [xget_hw_port_value $ipconv "gmii_txd"]
+		set port_value [hw_port_value $ipconv "gmii_txd"]
 		if { $port_value != 0 } {
 			set tmp [string first "ENET0" $port_value]
 			if { $tmp >= 0 } {
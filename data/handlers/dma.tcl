@@ -0,0 +1,333 @@
+#
+# AXI DMA, VDMA and CDMA IP handlers of the device tree generator
+#
+# Sourced into the generator namespace by slave_handler when the first
+# IP of the family is generated.
+#
+# (C) Copyright 2007-2013 Xilinx, Inc.
+# Based on original code:
+# (C) Copyright 2007-2013 Michal Simek
+# (C) Copyright 2007-2012 PetaLogix Qld Pty Ltd
+#
+# Michal SIMEK <monstr@monstr.eu>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License as
+# published by the Free Software Foundation; either version 2 of
+# the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+# MA 02111-1307 USA
+
+# AXI DMA
+proc gen_slave_axi_dma {node slave intc name type} {
+	set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "" [default_parameters $slave]]
+	set mhs_handle [hw_parent_handle $slave]
+	# See what the axi dma is connected to.
+	set axidma_busif_handle [hw_busif_handle $slave "M_AXIS_MM2S"]
+	set axidma_name [hw_value $axidma_busif_handle]
+	set axidma_ip_handle [xget_hw_connected_busifs_handle $mhs_handle $axidma_name "TARGET"]
+	set axidma_ip_handle_name [hw_name $axidma_ip_handle]
+	set connected_ip_handle [hw_parent_handle $axidma_ip_handle]
+	set connected_ip_name [hw_name $connected_ip_handle]
+	set connected_ip_type [hw_value $connected_ip_handle]
+	tree_lappend ip_tree [list "axistream-connected" labelref $connected_ip_name]
+	tree_lappend ip_tree [list "axistream-control-connected" labelref $connected_ip_name]
+
+	# Channels with their widths, burst sizes and stream peers
+	context_var dma_device_id
+	set baseaddr [scan_int_parameter_value $slave "C_BASEADDR"]
+	set highaddr [scan_int_parameter_value $slave "C_HIGHADDR"]
+	if {[scan_int_parameter_value $slave "C_INCLUDE_MM2S"] == 1} {
+		tree_lappend ip_tree [dma_channel_config "axi-dma" $baseaddr "MM2S" $intc $slave $dma_device_id]
+	}
+	if {[scan_int_parameter_value $slave "C_INCLUDE_S2MM"] == 1} {
+		tree_lappend ip_tree [dma_channel_config "axi-dma" [expr $baseaddr + 0x30] "S2MM" $intc $slave $dma_device_id]
+	}
+	tree_lappend ip_tree [list \#size-cells int 1]
+	tree_lappend ip_tree [list \#address-cells int 1]
+	set ip_tree [dma_sg_properties $ip_tree $slave]
+	tree_lappend ip_tree [gen_ranges_property $slave $baseaddr $highaddr $baseaddr]
+	incr dma_device_id
+
+	lappend node $ip_tree
+	return $node
+}
+
+# AXI DMA with channels merged into the Ethernet node
+# FIXME - this need to be check because can break axi ethernet implementation
+proc gen_slave_axi_dma_merged {node slave intc name type} {
+	set axiethernetfound 0
+	context_var dma_device_id
+	set xdma "axi-dma"
+	set mhs_handle [hw_parent_handle $slave]
+	set axidma_busif_handle [hw_busif_handle $slave "M_AXIS_MM2S"]
+	set axidma_name [hw_value $axidma_busif_handle]
+	set axidma_ip_handle [xget_hw_connected_busifs_handle $mhs_handle $axidma_name "TARGET"]
+	set axidma_ip_handle_name [hw_name $axidma_ip_handle]
+	set connected_ip_handle [hw_parent_handle $axidma_ip_handle]
+	set connected_ip_name [hw_name $connected_ip_handle]
+	set connected_ip_type [hw_value $connected_ip_handle]
+	if {[string compare $connected_ip_type "axi_ethernet"] == 0} {
+		set axiethernetfound 1
+	}
+	if {$axiethernetfound != 1} {
+		set hw_name [hw_name $slave]
+
+		set baseaddr [scan_int_parameter_value $slave "C_BASEADDR"]
+		set highaddr [scan_int_parameter_value $slave "C_HIGHADDR"]
+
+		set mytree [list [format_ip_name "axidma" $baseaddr $hw_name] tree {}]
+
+		set tx_chan [scan_int_parameter_value $slave "C_INCLUDE_MM2S"]
+		if {$tx_chan == 1} {
+			set chantree [dma_channel_config $xdma $baseaddr "MM2S" $intc $slave $dma_device_id]
+			tree_lappend mytree $chantree
+		}
+
+		set rx_chan [scan_int_parameter_value $slave "C_INCLUDE_S2MM"]
+		if {$rx_chan == 1} {
+			set chantree [dma_channel_config $xdma [expr $baseaddr + 0x30] "S2MM" $intc $slave $dma_device_id]
+			tree_lappend mytree $chantree
+		}
+
+		tree_lappend mytree [list \#size-cells int 1]
+		tree_lappend mytree [list \#address-cells int 1]
+		tree_lappend mytree [list compatible stringtuple [list "xlnx,axi-dma"]]
+
+		set stsctrl 1
+		set sgdmamode1 1
+		set sgdmamode [hw_parameter_handle $slave "C_INCLUDE_SG"]
+		if {$sgdmamode != ""} {
+			set sgdmamode1 [scan_int_parameter_value $slave "C_INCLUDE_SG"]
+			if {$sgdmamode1 == 0} {
+				set stsctrl 0
+				tree_lappend mytree [list "xlnx,sg-include-stscntrl-strm" hexint $stsctrl]
+			} else {
+				set stsctrl [hw_parameter_handle $slave "C_SG_INCLUDE_STSCNTRL_STRM"]
+				if {$stsctrl != ""} {
+					set stsctrl [scan_int_parameter_value $slave "C_SG_INCLUDE_STSCNTRL_STRM"]
+				} else {
+					set stsctrl 0
+				}
+				tree_lappend mytree [list "xlnx,sg-include-stscntrl-strm" hexint $stsctrl]
+			}
+		} else {
+			set stsctrl [hw_parameter_handle $slave "C_SG_INCLUDE_STSCNTRL_STRM"]
+			if {$stsctrl != ""} {
+				set stsctrl [scan_int_parameter_value $slave "C_SG_INCLUDE_STSCNTRL_STRM"]
+			} else {
+				set stsctrl 0
+			}
+			tree_lappend mytree [list "xlnx,sg-include-stscntrl-strm" hexint $stsctrl]
+		}
+		set mytree [dma_sg_properties $mytree $slave]
+		tree_lappend mytree [gen_ranges_property $slave $baseaddr $highaddr $baseaddr]
+		tree_lappend mytree [gen_reg_property $hw_name $baseaddr $highaddr]
+
+		lappend node $mytree
+	}
+
+	if {$axiethernetfound == 1} {
+		if {[catch {lappend node [slaveip_intr $slave $intc [interrupt_list $slave] "" [default_parameters $slave] "" ]} {error}]} {
+			debug warning $error
+		}
+	}
+	incr dma_device_id
+	return $node
+}
+
+# AXI VDMA
+proc gen_slave_axi_vdma {node slave intc name type} {
+	context_var vdma_device_id
+	set xdma "axi-vdma"
+	set hw_name [hw_name $slave]
+
+	set baseaddr [scan_int_parameter_value $slave "C_BASEADDR"]
+	set highaddr [scan_int_parameter_value $slave "C_HIGHADDR"]
+
+	set mytree [list [format_ip_name "axivdma" $baseaddr $hw_name] tree {}]
+	set tx_chan [scan_int_parameter_value $slave "C_INCLUDE_MM2S"]
+	if {$tx_chan == 1} {
+		set chantree [dma_channel_config $xdma $baseaddr "MM2S" $intc $slave $vdma_device_id]
+		tree_lappend mytree $chantree
+	}
+
+	set rx_chan [scan_int_parameter_value $slave "C_INCLUDE_S2MM"]
+	if {$rx_chan == 1} {
+		set chantree [dma_channel_config $xdma [expr $baseaddr + 0x30] "S2MM" $intc $slave $vdma_device_id]
+		tree_lappend mytree $chantree
+	}
+
+	tree_lappend mytree [list \#size-cells int 1]
+	tree_lappend mytree [list \#address-cells int 1]
+	tree_lappend mytree [list compatible stringtuple [list "xlnx,axi-vdma"]]
+
+	set tmp [hw_parameter_handle $slave "C_INCLUDE_SG"]
+
+	if {$tmp != ""} {
+		set tmp [scan_int_parameter_value $slave "C_INCLUDE_SG"]
+		tree_lappend mytree [list "xlnx,include-sg" hexint $tmp]
+	} else {
+		# older core always has SG
+		tree_lappend mytree [list "xlnx,include-sg" hexint 1]
+	}
+
+	set tmp [scan_int_parameter_value $slave "C_NUM_FSTORES"]
+	tree_lappend mytree [list "xlnx,num-fstores" hexint $tmp]
+
+	set tmp [scan_int_parameter_value $slave "C_FLUSH_ON_FSYNC"]
+	tree_lappend mytree [list "xlnx,flush-fsync" hexint $tmp]
+
+	set mytree [dma_sg_properties $mytree $slave]
+	tree_lappend mytree [gen_ranges_property $slave $baseaddr $highaddr $baseaddr]
+	tree_lappend mytree [gen_reg_property $hw_name $baseaddr $highaddr]
+
+	lappend node $mytree
+	incr vdma_device_id
+	return $node
+}
+
+# AXI CDMA
+proc gen_slave_axi_cdma {node slave intc name type} {
+	set hw_name [hw_name $slave]
+
+	set baseaddr [scan_int_parameter_value $slave "C_BASEADDR"]
+	set highaddr [scan_int_parameter_value $slave "C_HIGHADDR"]
+
+	set mytree [list [format_ip_name "axicdma" $baseaddr $hw_name] tree {}]
+	set namestring "dma-channel"
+	set channame [format_name [format "%s@%x" $namestring $baseaddr]]
+
+	set chan {}
+	lappend chan [list compatible stringtuple [list "xlnx,axi-cdma-channel"]]
+	set tmp [scan_int_parameter_value $slave "C_INCLUDE_DRE"]
+	lappend chan [list "xlnx,include-dre" hexint $tmp]
+
+	set tmp [scan_int_parameter_value $slave "C_USE_DATAMOVER_LITE"]
+	lappend chan [list "xlnx,lite-mode" hexint $tmp]
+
+	set tmp [scan_int_parameter_value $slave "C_M_AXI_DATA_WIDTH"]
+	lappend chan [list "xlnx,datawidth" hexint $tmp]
+
+	set tmp [scan_int_parameter_value $slave "C_M_AXI_MAX_BURST_LEN"]
+	lappend chan [list "xlnx,max-burst-len" hexint $tmp]
+
+
+	set chantree [list $channame tree $chan]
+	set chantree [gen_interrupt_property $chantree $slave $intc [list "cdma_introut"]]
+
+	tree_lappend mytree $chantree
+
+	tree_lappend mytree [list \#size-cells int 1]
+	tree_lappend mytree [list \#address-cells int 1]
+	tree_lappend mytree [list compatible stringtuple [list "xlnx,axi-cdma"]]
+
+	set tmp [scan_int_parameter_value $slave "C_INCLUDE_SG"]
+	tree_lappend mytree [list "xlnx,include-sg" hexint $tmp]
+	set mytree [dma_sg_properties $mytree $slave]
+
+	tree_lappend mytree [gen_ranges_property $slave $baseaddr $highaddr $baseaddr]
+	tree_lappend mytree [gen_reg_property $hw_name $baseaddr $highaddr]
+
+	lappend node $mytree
+	return $node
+}
+
+# Append property with the value of the parameter if the IP version has it
+proc gen_param_if_present {node slave param property} {
+	if {[hw_parameter_handle $slave $param] != ""} {
+		lappend node [list $property hexint [scan_int_parameter_value $slave $param]]
+	}
+	return $node
+}
+
+# Name of the IP on the other end of the AXI stream of a DMA channel
+proc dma_channel_peer {slave mode} {
+	if {$mode == "MM2S"} {
+		set busif [hw_busif_handle $slave "M_AXIS_MM2S"]
+		set role "TARGET"
+	} else {
+		set busif [hw_busif_handle $slave "S_AXIS_S2MM"]
+		set role "INITIATOR"
+	}
+	if {[llength $busif] == 0} {
+		return ""
+	}
+	set bus_name [hw_value $busif]
+	if {[llength $bus_name] == 0} {
+		return ""
+	}
+	set mhs_handle [hw_parent_handle $slave]
+	set peer_busif [lindex [xget_hw_connected_busifs_handle $mhs_handle $bus_name $role] 0]
+	if {[llength $peer_busif] == 0} {
+		return ""
+	}
+	return [hw_name [hw_parent_handle $peer_busif]]
+}
+
+# Scatter gather engine of DMA controllers, descriptor length and width,
+# unless the parameters of the IP already report them
+proc dma_sg_properties {tree slave} {
+	set node [lindex $tree 2]
+	foreach {param property} {C_SG_LENGTH_WIDTH xlnx,sg-length-width C_M_AXI_SG_DATA_WIDTH xlnx,sg-datawidth} {
+		if {![tree_has_property $tree $property]} {
+			set node [gen_param_if_present $node $slave $param $property]
+		}
+	}
+	return [lreplace $tree 2 2 $node]
+}
+
+proc dma_channel_config {xdma addr mode intc slave devid} {
+	set modelow [string tolower $mode]
+	set namestring "dma-channel"
+	set channame [format_name [format "%s@%x" $namestring $addr]]
+
+	set chan {}
+	lappend chan [list compatible stringtuple [list [format "xlnx,%s-%s-channel" $xdma $modelow]]]
+	set tmp [scan_int_parameter_value $slave [format "C_INCLUDE_%s_DRE" $mode]]
+	lappend chan [list "xlnx,include-dre" hexint $tmp]
+
+	lappend chan [list "xlnx,device-id" hexint $devid]
+	set tmp [hw_parameter_handle $slave [format "C_%s_AXIS_%s_TDATA_WIDTH" [string index $mode 0] $mode]]
+	if {$tmp != ""} {
+		set tmp [scan_int_parameter_value $slave [format "C_%s_AXIS_%s_TDATA_WIDTH" [string index $mode 0] $mode]]
+		lappend chan [list "xlnx,datawidth" hexint $tmp]
+	}
+
+	set tmp [hw_parameter_handle $slave [format "C_%s_AXIS_%s_DATA_WIDTH" [string index $mode 0] $mode]]
+	if {$tmp != ""} {
+		set tmp [scan_int_parameter_value $slave [format "C_%s_AXIS_%s_DATA_WIDTH" [string index $mode 0] $mode]]
+		lappend chan [list "xlnx,datawidth" hexint $tmp]
+	}
+
+	# Memory map side width and burst length, for sizing transfers
+	set chan [gen_param_if_present $chan $slave [format "C_M_AXI_%s_DATA_WIDTH" $mode] "xlnx,mm-datawidth"]
+	if {[hw_parameter_handle $slave [format "C_%s_BURST_SIZE" $mode]] != ""} {
+		set chan [gen_param_if_present $chan $slave [format "C_%s_BURST_SIZE" $mode] "xlnx,burst-size"]
+	} else {
+		set chan [gen_param_if_present $chan $slave [format "C_%s_MAX_BURST_LENGTH" $mode] "xlnx,burst-size"]
+	}
+
+	set peer [dma_channel_peer $slave $mode]
+	if {$peer != ""} {
+		lappend chan [list "axistream-connected" labelref $peer]
+	}
+
+	if { [string compare -nocase $xdma "axi-dma"] != 0} {
+		set tmp [scan_int_parameter_value $slave [format "C_%s_GENLOCK_MODE" $mode]]
+		lappend chan [list "xlnx,genlock-mode" hexint $tmp]
+	}
+
+	set chantree [list $channame tree $chan]
+	set chantree [gen_interrupt_property $chantree $slave $intc [list [format "%s_introut" $modelow]]]
+
+	return $chantree
+}
@@ -0,0 +1,110 @@
+#
+# External memory controller IP handlers of the device tree generator
+#
+# Sourced into the generator namespace by slave_handler when the first
+# IP of the family is generated.
+#
+# (C) Copyright 2007-2013 Xilinx, Inc.
+# Based on original code:
+# (C) Copyright 2007-2013 Michal Simek
+# (C) Copyright 2007-2012 PetaLogix Qld Pty Ltd
+#
+# Michal SIMEK <monstr@monstr.eu>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License as
+# published by the Free Software Foundation; either version 2 of
+# the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+# MA 02111-1307 USA
+
+# External memory controllers with flash banks
+proc gen_slave_emc {node slave intc name type} {
+	context_var main_memory main_memory_bank
+	# Handle flash memories with 'banks'. Generate one flash node
+	# for each bank, if necessary.  If not connected to flash,
+	# then do nothing.
+	set count [scan_int_parameter_value $slave "C_NUM_BANKS_MEM"]
+	if { [llength $count] == 0 } {
+		set count 1
+	}
+	for {set x 0} {$x < $count} {incr x} {
+
+		# Make sure we didn't already register this guy as the main memory.
+		# see main handling in gen_memories
+		if {[ string match -nocase $name $main_memory ] && $x == $main_memory_bank } {
+			continue;
+		}
+		context_var flash_memory flash_memory_bank
+		set baseaddr_prefix [format "MEM%d_" $x]
+		set tree [slaveip_intr $slave $intc [interrupt_list $slave] "flash" [default_parameters $slave] $baseaddr_prefix "" "cfi-flash"]
+
+		# Flash needs a bank-width attribute.
+		set datawidth [scan_int_parameter_value $slave [format "C_%sWIDTH" $baseaddr_prefix]]
+		tree_lappend tree [list "bank-width" int "[expr ($datawidth/8)]"]
+
+		# If it is a set as the system Flash memory, change the name of this node to PetaLinux standard system Flash emmory name
+		if {[ string match -nocase $name $flash_memory ] && $x == $flash_memory_bank} {
+			set tree [change_nodename $tree $name "primary_flash"]
+		}
+		lappend node $tree
+	}
+	return $node
+}
+
+# AXI external memory controller with flash banks
+proc gen_slave_axi_emc {node slave intc name type} {
+	# Handle flash memories with 'banks'. Generate one flash node
+	# for each bank, if necessary.  If not connected to flash,
+	# then do nothing.
+	set count [scan_int_parameter_value $slave "C_NUM_BANKS_MEM"]
+	if { [llength $count] == 0 } {
+		set count 1
+	}
+	for {set x 0} {$x < $count} {incr x} {
+
+		set synch_mem [scan_int_parameter_value $slave [format "C_MEM%d_TYPE" $x]]
+		# C_MEM$x_TYPE = 2 or 3 indicates the bank handles
+		# a flash device and it should be listed as a
+		# slave in fdt.
+		# C_MEM$x_TYPE = 0, 1 or 4 indicates the bank handles
+		# SRAM and it should be listed as a memory in
+		# fdt.
+
+		context_var main_memory main_memory_bank
+		# Make sure we didn't already register this guy as the main memory.
+		# see main handling in gen_memories
+		if {[ string match -nocase $name $main_memory ] && $x == $main_memory_bank } {
+			if { $synch_mem == 0 || $synch_mem == 1 || $synch_mem == 4 } {
+				continue;
+			}
+		}
+
+		set baseaddr_prefix [format "S_AXI_MEM%d_" $x]
+		if { $synch_mem == 2 || $synch_mem == 3 } {
+			set tree [slaveip_intr $slave $intc [interrupt_list $slave] "flash" [default_parameters $slave] $baseaddr_prefix "" "cfi-flash"]
+		} else {
+			set tree [slaveip_intr $slave $intc [interrupt_list $slave] "memory" [default_parameters $slave] $baseaddr_prefix "" ""]
+		}
+
+		# Flash needs a bank-width attribute.
+		set datawidth [scan_int_parameter_value $slave [format "C_MEM%d_WIDTH" $x]]
+		tree_lappend tree [list "bank-width" int "[expr ($datawidth/8)]"]
+
+		# If it is a set as the system Flash memory, change the name of this node to PetaLinux standard system Flash emmory name
+		context_var flash_memory flash_memory_bank
+		if {[ string match -nocase $name $flash_memory ] && $x == $flash_memory_bank} {
+			set tree [change_nodename $tree $name "primary_flash"]
+		}
+		lappend node $tree
+	}
+	return $node
+}
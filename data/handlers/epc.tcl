@@ -0,0 +1,41 @@
+#
+# External peripheral controller IP handlers of the device tree generator
+#
+# Sourced into the generator namespace by slave_handler when the first
+# IP of the family is generated.
+#
+# (C) Copyright 2007-2013 Xilinx, Inc.
+# Based on original code:
+# (C) Copyright 2007-2013 Michal Simek
+# (C) Copyright 2007-2012 PetaLogix Qld Pty Ltd
+#
+# Michal SIMEK <monstr@monstr.eu>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License as
+# published by the Free Software Foundation; either version 2 of
+# the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+# MA 02111-1307 USA
+
+# External peripheral controllers
+proc gen_slave_epc {node slave intc name type} {
+	set tree [compound_slave $slave "C_PRH0_BASEADDR"]
+
+	set epc_peripheral_num [hw_parameter_value $slave "C_NUM_PERIPHERALS"]
+	for {set x 0} {$x < ${epc_peripheral_num}} {incr x} {
+		set subnode [slaveip_intr $slave $intc [interrupt_list $slave] "" "" "PRH${x}_" ]
+		set subnode [change_nodename $subnode $name "${name}_p${x}"]
+		tree_lappend tree $subnode
+	}
+	lappend node $tree
+	return $node
+}
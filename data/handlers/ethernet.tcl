@@ -0,0 +1,229 @@
+#
+# Ethernet MAC IP handlers of the device tree generator
+#
+# Sourced into the generator namespace by slave_handler when the first
+# IP of the family is generated.
+#
+# (C) Copyright 2007-2013 Xilinx, Inc.
+# Based on original code:
+# (C) Copyright 2007-2013 Michal Simek
+# (C) Copyright 2007-2012 PetaLogix Qld Pty Ltd
+#
+# Michal SIMEK <monstr@monstr.eu>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License as
+# published by the Free Software Foundation; either version 2 of
+# the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+# MA 02111-1307 USA
+
+proc ll_temac_parameters {ip_handle index} {
+	set params {}
+	foreach param [default_parameters $ip_handle] {
+		set pattern [format "C_TEMAC%d*" $index]
+		if {[string match $pattern $param]} {
+			lappend params $param
+		}
+	}
+	return $params
+}
+
+proc slave_ll_temac_port {slave intc index} {
+	set name [hw_name $slave]
+	set type [hw_value $slave]
+	set baseaddr [scan_int_parameter_value $slave "C_BASEADDR"]
+	set baseaddr [expr $baseaddr + $index * 0x40]
+	set highaddr [expr $baseaddr + 0x3f]
+
+	#
+	# Add this temac channel to the alias list
+	#
+	context_var ethernet_count
+	context_var alias_node_list
+	set subnode_name [format "%s_%s" $name "ETHERNET"]
+	set alias_node [list ethernet$ethernet_count aliasref $subnode_name $ethernet_count]
+	lappend alias_node_list $alias_node
+	incr ethernet_count
+
+	set ip_tree [slaveip_basic $slave $intc "" [format_ip_name "ethernet" $baseaddr $subnode_name]]
+	tree_lappend ip_tree [list "device_type" string "network"]
+	context_var mac_count
+	tree_lappend ip_tree [list "local-mac-address" bytesequence [list 0x00 0x0a 0x35 0x00 0x00 $mac_count]]
+	incr mac_count
+
+	tree_lappend ip_tree [gen_reg_property $name $baseaddr $highaddr]
+	set ip_tree [gen_interrupt_property $ip_tree $slave $intc [format "TemacIntc%d_Irpt" $index]]
+	set ip_name [lindex $ip_tree 0]
+	set ip_node [lindex $ip_tree 2]
+	# Generate the parameters, stripping off the right prefix.
+	set ip_node [gen_params $ip_node $slave [ll_temac_parameters $slave $index] [format "C_TEMAC%i_" $index]]
+	# Generate the common parameters.
+	set ip_node [gen_params $ip_node $slave [list "C_PHY_TYPE" "C_TEMAC_TYPE" "C_BUS2CORE_CLK_RATIO"]]
+	set ip_tree [list $ip_name tree $ip_node]
+	set caps {}
+	foreach {cap param} {txcsum TXCSUM rxcsum RXCSUM txmem TXFIFO rxmem RXFIFO} {
+		lappend caps $cap [format "C_TEMAC%d_%s" $index $param]
+	}
+	set ip_tree [gen_mac_capabilities $ip_tree [mac_capability_params $slave $caps]]
+	set mhs_handle [hw_parent_handle $slave]
+	# See what the temac is connected to.
+	set ll_busif_handle [hw_busif_handle $slave "LLINK$index"]
+	set ll_name [hw_value $ll_busif_handle]
+	set ll_ip_handle [xget_hw_connected_busifs_handle $mhs_handle $ll_name "target"]
+	set ll_ip_handle_name [hw_name $ll_ip_handle]
+	set connected_ip_handle [hw_parent_handle $ll_ip_handle]
+	set connected_ip_name [hw_name $connected_ip_handle]
+	set connected_ip_type [hw_value $connected_ip_handle]
+	if {$connected_ip_type == "mpmc"} {
+		# Assumes only one MPMC.
+		if {[string match SDMA_LL? $ll_ip_handle_name]} {
+			set port_number [string range $ll_ip_handle_name 7 7]
+			set sdma_name "PIM$port_number"
+			tree_lappend ip_tree [list "llink-connected" labelref $sdma_name]
+		} else {
+			error "found ll_temac connected to mpmc, but can't find the port number!"
+		}
+	} elseif {$connected_ip_type == "ppc440_virtex5"} {
+		# Assumes only one PPC.
+		if {[string match LLDMA? $ll_ip_handle_name]} {
+			set port_number [string range $ll_ip_handle_name 5 5]
+			set sdma_name "DMA$port_number"
+			tree_lappend ip_tree [list "llink-connected" labelref $sdma_name]
+		} else {
+			error "found ll_temac connected to ppc440_virtex5, but can't find the port number!"
+		}
+	} else {
+		# Hope it's something that only has one locallink
+		# connection. Most likely an xps_ll_fifo
+		tree_lappend ip_tree [list "llink-connected" labelref "$connected_ip_name"]
+	}
+	return $ip_tree
+}
+
+proc slave_ll_temac {slave intc} {
+	set tree [compound_slave $slave]
+	tree_lappend tree [slave_ll_temac_port $slave $intc 0]
+	set port1_enabled  [scan_int_parameter_value $slave "C_TEMAC1_ENABLED"]
+	if {$port1_enabled == "1"} {
+		tree_lappend tree [slave_ll_temac_port $slave $intc 1]
+	}
+	return $tree
+}
+
+# Ethernet Lite and older Ethernet MACs
+proc gen_slave_ethernet {node slave intc name type} {
+	context_var phy_count
+	context_var mac_count
+
+	#
+	# Add this temac channel to the alias list
+	#
+	context_var ethernet_count
+	context_var alias_node_list
+	lappend alias_node_list [list ethernet$ethernet_count aliasref $name $ethernet_count]
+	incr ethernet_count
+
+	# 'network' type
+	set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "ethernet" [default_parameters $slave]]
+	tree_lappend ip_tree [list "device_type" string "network"]
+	tree_lappend ip_tree [list "local-mac-address" bytesequence [list 0x00 0x0a 0x35 0x00 0x00 $mac_count]]
+	incr mac_count
+
+	if {$type == "xps_ethernetlite" || $type == "axi_ethernetlite"} {
+		# 2 KiB buffer per direction, two with ping-pong, no offloads
+		set caps [list txcsum 0 rxcsum 0 max-frame 1518]
+		foreach {cap param} {txmem C_TX_PING_PONG rxmem C_RX_PING_PONG} {
+			set buffers 1
+			if {[parameter_exists $slave $param]} {
+				incr buffers [scan_int_parameter_value $slave $param]
+			}
+			lappend caps $cap [expr {$buffers * 0x800}]
+		}
+		set ip_tree [gen_mac_capabilities $ip_tree $caps]
+		if {[parameter_exists $slave "C_INCLUDE_MDIO"]} {
+			set has_mdio [scan_int_parameter_value $slave "C_INCLUDE_MDIO"]
+			if {$has_mdio == 1} {
+				set phy_name "phy$phy_count"
+				tree_lappend ip_tree [list "phy-handle" labelref $phy_name]
+				tree_lappend ip_tree [gen_mdiotree $slave]
+			}
+		}
+	}
+
+	lappend node $ip_tree
+	return $node
+}
+
+# LocalLink TEMAC
+proc gen_slave_ll_temac {node slave intc name type} {
+	# We need to handle this specially, to notify the driver
+	# about the connected LL connection, and the dual cores.
+	lappend node [slave_ll_temac $slave $intc]
+	return $node
+}
+
+# AXI Ethernet
+proc gen_slave_axi_ethernet {node slave intc name type} {
+	context_var phy_count
+	context_var mac_count
+
+	set name [hw_name $slave]
+	set type [hw_value $slave]
+	set baseaddr [scan_int_parameter_value $slave "C_BASEADDR"]
+	set highaddr [expr $baseaddr + 0x3ffff]
+
+	context_var ethernet_count
+	context_var alias_node_list
+	set alias_node [list ethernet$ethernet_count aliasref $name $ethernet_count]
+	lappend alias_node_list $alias_node
+	incr ethernet_count
+
+	set ip_tree [slaveip_basic $slave $intc "" [format_ip_name "axi-ethernet" $baseaddr $name]]
+	tree_lappend ip_tree [list "device_type" string "network"]
+	tree_lappend ip_tree [list "local-mac-address" bytesequence [list 0x00 0x0a 0x35 0x00 0x00 $mac_count]]
+	incr mac_count
+	set phy_name "phy$phy_count"
+	tree_lappend ip_tree [list "phy-handle" labelref $phy_name]
+
+	tree_lappend ip_tree [gen_reg_property $name $baseaddr $highaddr]
+	set ip_tree [gen_interrupt_property $ip_tree $slave $intc [format "INTERRUPT"]]
+	set ip_name [lindex $ip_tree 0]
+	set ip_node [lindex $ip_tree 2]
+	# Generate the common parameters.
+	set ip_node [gen_params $ip_node $slave [list "C_PHY_TYPE" "C_TYPE" "C_PHYADDR" "C_INCLUDE_IO" "C_HALFDUP"]]
+	set ip_node [gen_params $ip_node $slave [list "C_TXMEM" "C_RXMEM" "C_TXCSUM" "C_RXCSUM" "C_MCAST_EXTEND" "C_STATS" "C_AVB"]]
+	set ip_node [gen_params $ip_node $slave [list "C_TXVLAN_TRAN" "C_RXVLAN_TRAN" "C_TXVLAN_TAG" "C_RXVLAN_TAG" "C_TXVLAN_STRP" "C_RXVLAN_STRP"]]
+	set ip_tree [list $ip_name tree $ip_node]
+	set ip_tree [gen_mac_capabilities $ip_tree [mac_capability_params $slave \
+		{txcsum C_TXCSUM rxcsum C_RXCSUM txmem C_TXMEM rxmem C_RXMEM}]]
+	# See what the axi ethernet is connected to, the data streams go to
+	# the DMA and the control streams usually too.
+	set data_peer [mac_stream_peer $slave {AXI_STR_RXD TARGET AXI_STR_TXD INITIATOR}]
+	set control_peer [mac_stream_peer $slave {AXI_STR_STS TARGET AXI_STR_CTRL INITIATOR}]
+	if {$control_peer == ""} {
+		set control_peer $data_peer
+	}
+	if {$data_peer != ""} {
+		tree_lappend ip_tree [list "axistream-connected" labelref $data_peer]
+		tree_lappend ip_tree [list "axistream-control-connected" labelref $control_peer]
+	} else {
+		debug warning "Warning!: $name has no AXI stream connected to a DMA"
+	}
+
+	set freq [get_clock_frequency $slave "S_AXI_ACLK"]
+	tree_lappend ip_tree [list "clock-frequency" int $freq]
+
+	tree_lappend ip_tree [gen_mdiotree $slave]
+
+	lappend node $ip_tree
+	return $node
+}
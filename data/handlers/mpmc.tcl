@@ -0,0 +1,90 @@
+#
+# MPMC IP handlers of the device tree generator
+#
+# Sourced into the generator namespace by slave_handler when the first
+# IP of the family is generated.
+#
+# (C) Copyright 2007-2013 Xilinx, Inc.
+# Based on original code:
+# (C) Copyright 2007-2013 Michal Simek
+# (C) Copyright 2007-2012 PetaLogix Qld Pty Ltd
+#
+# Michal SIMEK <monstr@monstr.eu>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License as
+# published by the Free Software Foundation; either version 2 of
+# the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+# MA 02111-1307 USA
+
+proc slave_mpmc {slave intc} {
+	set share_addresses [scan_int_parameter_value $slave "C_ALL_PIMS_SHARE_ADDRESSES"]
+	if {[catch {
+		# Found control port for ECC and performance monitors
+		set tree [slaveip $slave $intc "" "" "MPMC_CTRL_"]
+		set ip_name [lindex $tree 0]
+		set mpmc_node [lindex $tree 2]
+	}]} {
+		# No control port
+		if {$share_addresses == 0} {
+			set baseaddr [scan_int_parameter_value $slave "C_PIM0_BASEADDR"]
+		} else {
+			set baseaddr [scan_int_parameter_value $slave "C_MPMC_BASEADDR"]
+		}
+		set tree [slaveip_basic $slave $intc "" [format_ip_name "mpmc" $baseaddr] ]
+		set ip_name [lindex $tree 0]
+		set mpmc_node [lindex $tree 2]
+
+		# Generate the parameters
+		# set mpmc_node [gen_params $mpmc_node $slave [default_parameters $slave] ]
+
+	}
+	set mpmc_node [concat $mpmc_node [cells_properties]]
+	lappend mpmc_node [list ranges empty empty]
+
+	set num_ports [scan_int_parameter_value $slave "C_NUM_PORTS"]
+	for {set x 0} {$x < $num_ports} {incr x} {
+		set pim_type [scan_int_parameter_value $slave [format "C_PIM%d_BASETYPE" $x]]
+		if {$pim_type == 3} {
+			# Found an SDMA port
+			if {$share_addresses == 0} {
+				set baseaddr [scan_int_parameter_value $slave [format "C_SDMA_CTRL%d_BASEADDR" $x]]
+				set highaddr [scan_int_parameter_value $slave [format "C_SDMA_CTRL%d_HIGHADDR" $x]]
+			} else {
+				set baseaddr [scan_int_parameter_value $slave "C_SDMA_CTRL_BASEADDR"]
+				set baseaddr [expr $baseaddr + $x * 0x80]
+				set highaddr [expr $baseaddr + 0x7f]
+			}
+
+			set sdma_name [format_ip_name sdma $baseaddr "PIM$x"]
+			set sdma_tree [list $sdma_name tree {}]
+			tree_lappend sdma_tree [gen_reg_property $sdma_name $baseaddr $highaddr]
+			tree_lappend sdma_tree [gen_compatible_property $sdma_name "ll_dma" "1.00.a"]
+			set sdma_tree [gen_interrupt_property $sdma_tree $slave $intc [list [format "SDMA%d_Rx_IntOut" $x] [format "SDMA%d_Tx_IntOut" $x]]]
+
+			lappend mpmc_node $sdma_tree
+
+		}
+	}
+	return [list $ip_name tree $mpmc_node]
+}
+
+# Multi-port memory controller
+proc gen_slave_mpmc {node slave intc name type} {
+	# We should handle this specially, to report the DMA
+	# ports.  This is a hack that happens to work for the
+	# design I have.  Note that we don't use the default
+	# parameters here because of the slew of parameters the
+	# mpmc has.
+	lappend node [slave_mpmc $slave $intc]
+	return $node
+}
@@ -0,0 +1,90 @@
+#
+# OPB, PLB and DCR bridge IP handlers of the device tree generator
+#
+# Sourced into the generator namespace by slave_handler when the first
+# IP of the family is generated.
+#
+# (C) Copyright 2007-2013 Xilinx, Inc.
+# Based on original code:
+# (C) Copyright 2007-2013 Michal Simek
+# (C) Copyright 2007-2012 PetaLogix Qld Pty Ltd
+#
+# Michal SIMEK <monstr@monstr.eu>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License as
+# published by the Free Software Foundation; either version 2 of
+# the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+# MA 02111-1307 USA
+
+# PLB to OPB bridges
+proc gen_slave_plb2opb_bridge {node slave intc name type} {
+	set baseaddr [scan_int_parameter_value $slave "C_RNG0_BASEADDR"]
+	set tree [bus_bridge $slave $intc $baseaddr "MOPB"]
+	set ranges_list [default_ranges $slave "C_NUM_ADDR_RNG" "C_RNG%d_BASEADDR" "C_RNG%d_HIGHADDR"]
+	tree_lappend tree [gen_ranges_property_list $slave $ranges_list [tree_cells $tree]]
+	lappend node $tree
+	return $node
+}
+
+# AXI to PLB bridge
+proc gen_slave_axi_plbv46_bridge {node slave intc name type} {
+	set baseaddr [scan_int_parameter_value $slave "C_S_AXI_RNG1_BASEADDR"]
+	set tree [bus_bridge $slave $intc $baseaddr "MPLB"]
+	set ranges_list [default_ranges $slave "C_S_AXI_NUM_ADDR_RANGES" "C_S_AXI_RNG%d_BASEADDR" "C_S_AXI_RNG%d_HIGHADDR" "1"]
+	tree_lappend tree [gen_ranges_property_list $slave $ranges_list [tree_cells $tree]]
+	lappend node $tree
+	return $node
+}
+
+# PLB to PLB bridge
+proc gen_slave_plbv46_plbv46_bridge {node slave intc name type} {
+	# FIXME: multiple ranges!
+	set baseaddr [scan_int_parameter_value $slave "C_RNG0_BASEADDR"]
+	set tree [bus_bridge $slave $intc $baseaddr "MPLB"]
+	set ranges_list [default_ranges $slave "C_NUM_ADDR_RNG" "C_RNG%d_BASEADDR" "C_RNG%d_HIGHADDR"]
+	tree_lappend tree [gen_ranges_property_list $slave $ranges_list [tree_cells $tree]]
+	lappend node $tree
+	return $node
+}
+
+# OPB to OPB bridge
+proc gen_slave_opb_opb_lite {node slave intc name type} {
+	# FIXME: multiple ranges!
+	set baseaddr [scan_int_parameter_value $slave "C_DEC0_BASEADDR"]
+	set tree [bus_bridge $slave $intc $baseaddr "MOPB"]
+	set ranges_list [default_ranges $slave "C_NUM_DECODES" "C_DEC%d_BASEADDR" "C_DEC%d_HIGHADDR"]
+	tree_lappend tree [gen_ranges_property_list $slave $ranges_list [tree_cells $tree]]
+	lappend node $tree
+	return $node
+}
+
+# DCR bridges
+proc gen_slave_dcr_bridge {node slave intc name type} {
+	set baseaddr [scan_int_parameter_value $slave "C_BASEADDR"]
+	set highaddr [scan_int_parameter_value $slave "C_HIGHADDR"]
+	set slavetree [slaveip_intr $slave $intc [interrupt_list $slave] "" [default_parameters $slave] ""]
+	tree_lappend slavetree [list dcr-controller empty empty]
+	tree_lappend slavetree [list dcr-access-method string mmio]
+	tree_lappend slavetree [list dcr-mmio-stride int 4]
+	tree_lappend slavetree [gen_reg_property $name $baseaddr $highaddr "dcr-mmio-range"]
+	lappend node $slavetree
+	set tree [bus_bridge $slave $intc 0 "MDCR"]
+
+	# Backward compatibility to not break older style tft driver
+	# connected through opb2dcr bridge.
+	set ranges [gen_ranges_property $slave $baseaddr $highaddr 0 [tree_cells $tree]]
+	tree_lappend tree $ranges
+
+	lappend node $tree
+	return $node
+}
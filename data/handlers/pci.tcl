@@ -0,0 +1,177 @@
+#
+# PCI and PCIe IP handlers of the device tree generator
+#
+# Sourced into the generator namespace by slave_handler when the first
+# IP of the family is generated.
+#
+# (C) Copyright 2007-2013 Xilinx, Inc.
+# Based on original code:
+# (C) Copyright 2007-2013 Michal Simek
+# (C) Copyright 2007-2012 PetaLogix Qld Pty Ltd
+#
+# Michal SIMEK <monstr@monstr.eu>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License as
+# published by the Free Software Foundation; either version 2 of
+# the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+# MA 02111-1307 USA
+
+# AXI PCIe
+proc gen_slave_axi_pcie {node slave intc name type} {
+	set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "" [default_parameters $slave] ]
+	tree_lappend ip_tree [list \#address-cells int 3]
+	tree_lappend ip_tree [list \#size-cells int 2]
+	set parent_cells [lindex [cells_current] 0]
+	set ranges {}
+	set ranges_list [axipcie_ranges $slave "C_AXIBAR_NUM" "C_AXIBAR_%d" "C_AXIBAR2PCIEBAR_%d" "C_AXIBAR_HIGHADDR_%d" "C_AXIBAR_AS_%d"]
+	foreach range $ranges_list {
+		set range_type [lindex $range 0]
+		set axi_baseaddr [lindex $range 1]
+		set child_baseaddr [lindex $range 1]
+		set pcie_baseaddr [lindex $range 2]
+		set axi_highaddr [lindex $range 3]
+		set size [validate_ranges_property $slave $axi_baseaddr $axi_highaddr $child_baseaddr]
+		set ranges [concat $ranges $range_type [encode_cells $pcie_baseaddr 2] \
+			[encode_cells $axi_baseaddr $parent_cells] [encode_cells $size 2]]
+	}
+	tree_lappend ip_tree [list "ranges" hexinttuple $ranges]
+
+	# Inbound PCIe BAR to AXI translation, mapped 1:1 in the PCI address
+	# space. Without it endpoint DMA goes through bounce buffers.
+	if {[parameter_exists $slave "C_PCIEBAR_NUM"]} {
+		set is_64bit 0
+		if {[parameter_exists $slave "C_PCIEBAR_AS"]} {
+			set is_64bit [scan_int_parameter_value $slave "C_PCIEBAR_AS"]
+		}
+		set dma_ranges {}
+		set count [scan_int_parameter_value $slave "C_PCIEBAR_NUM"]
+		for {set x 0} {$x < $count} {incr x} {
+			set axi_baseaddr [scan_int_parameter_value $slave [format "C_PCIEBAR2AXIBAR_%d" $x]]
+			set size [expr {wide(1) << [scan_int_parameter_value $slave [format "C_PCIEBAR_LEN_%d" $x]]}]
+			set dma_ranges [concat $dma_ranges [pci_space_code $is_64bit] [encode_cells $axi_baseaddr 2] \
+				[encode_cells $axi_baseaddr $parent_cells] [encode_cells $size 2]]
+		}
+		if {[llength $dma_ranges] != 0} {
+			tree_lappend ip_tree [list "dma-ranges" hexinttuple $dma_ranges]
+		}
+	}
+
+	# Root complex: legacy INTx through the integrated interrupt decoder,
+	# which is also the MSI controller
+	if {[parameter_exists $slave "C_INCLUDE_RC"] && [scan_int_parameter_value $slave "C_INCLUDE_RC"] == 1} {
+		set intc_label "${name}_intc"
+		tree_lappend ip_tree [list "device_type" string "pci"]
+		tree_lappend ip_tree [list "#interrupt-cells" int "1"]
+		tree_lappend ip_tree [list "msi-controller" empty empty]
+		tree_lappend ip_tree [list "interrupt-map-mask" hexinttuple "0x0 0x0 0x0 0x7"]
+		set map {}
+		foreach pin {1 2 3 4} {
+			lappend map 0 0 0 $pin "&$intc_label" $pin
+		}
+		tree_lappend ip_tree [list "interrupt-map" celltuple $map]
+		tree_lappend ip_tree [list "$intc_label: interrupt-controller" tree [list \
+			[list "interrupt-controller" empty empty] \
+			[list "#address-cells" int "0"] \
+			[list "#interrupt-cells" int "1"]]]
+	}
+	lappend node $ip_tree
+	return $node
+}
+
+# PCIe IPIF slave
+proc gen_slave_pcie_ipif_slave {node slave intc name type} {
+	# We can automatically generate the ranges property, but that's about it
+	# the interrupt-map encodes board-level info that cannot be
+	# derived from the MHS.
+	# Default handling for all params first
+	set ip_tree [slaveip_pcie_ipif_slave $slave $intc "pcie_ipif_slave" [default_parameters $slave]]
+
+	# Standard stuff required fror the pci OF bindings
+	tree_lappend ip_tree [list "#size-cells" int "2"]
+	tree_lappend ip_tree [list "#address-cells" int "3"]
+	tree_lappend ip_tree [list "#interrupt-cells" int "1"]
+	tree_lappend ip_tree [list "device_type" string "pci"]
+	# Generate ranges property.  Lots of assumptions here - 32 bit address space being the main one
+	set ranges ""
+
+	set ipifbar [ scan_int_parameter_value $slave "C_MEM1_BASEADDR" ]
+	set ipif_highaddr [ scan_int_parameter_value $slave "C_MEM1_HIGHADDR" ]
+	set space_code "0x02000000"
+
+	set ranges [lappend ranges $space_code 0 $ipifbar $ipifbar 0 [ expr $ipif_highaddr - $ipifbar + 1 ]]
+
+	tree_lappend ip_tree [ list "ranges" hexinttuple $ranges ]
+
+	# Now the interrupt-map-mask etc
+	tree_lappend ip_tree [ list "interrupt-map-mask" hexinttuple "0xff00 0x0 0x0 0x7" ]
+
+	# Make sure the user knows they've still got more work to do
+	# If we were prepared to add a custom PARAMETER to the MLD then we could do moer here, but for now this is
+	# the best we can do
+	debug warning "WARNING: Cannot automatically populate PCI interrupt-map property - this must be completed manually"
+	lappend node $ip_tree
+	return $node
+}
+
+# PLB PCI
+proc gen_slave_plbv46_pci {node slave intc name type} {
+	# We can automatically generate the ranges property, but that's about it
+	# the interrupt-map encodes board-level info that cannot be
+	# derived from the MHS.
+	# Default handling for all params first
+	set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "plbv46-pci" [default_parameters $slave]]
+
+	# Standard stuff required fror the pci OF bindings
+	tree_lappend ip_tree [list "#size-cells" int "2"]
+	tree_lappend ip_tree [list "#address-cells" int "3"]
+	tree_lappend ip_tree [list "#interrupt-cells" int "1"]
+	tree_lappend ip_tree [list "device_type" string "pci"]
+	# Generate ranges property.  Lots of assumptions here - 32 bit address space being the main one
+	set ranges ""
+	set ipifbar_num [ scan_int_parameter_value $slave "C_IPIFBAR_NUM"]
+	for {set i 0} {$i < $ipifbar_num} {incr i} {
+		set ipif_spacetype [ scan_int_parameter_value $slave [ format "C_IPIF_SPACETYPE_%i" $i ] ]
+		set ipifbar [ scan_int_parameter_value $slave [ format "C_IPIFBAR_%i" $i ] ]
+		set ipif_highaddr [ scan_int_parameter_value $slave [ format "C_IPIF_HIGHADDR_%i" $i ] ]
+		set ipifbar2pcibar [ scan_int_parameter_value $slave [ format "C_IPIFBAR2PCIBAR_%i" $i ] ]
+		# A quick DRC to make sure the IPIFBAR and IPIFBAR2PCIBAR match
+		# This is a limitation of the kernel PCI layer rather than anything else
+		if { $ipifbar != $ipifbar2pcibar } {
+			debug warning "WARNING: $name:  C_IPIFBAR_$i and C_IPIBAR2PCIBAR_$i don't match"
+		}
+		# Different magic number depending upon the type of address space
+		switch $ipif_spacetype {
+			"0" {
+				# IO space
+				set space_code "0x01000000"
+				debug warning "WARNING: $name BAR $i: PCI I/O spaces not supported in Linux kernel PCI drivers"
+			}
+			"1" {
+				# mem space
+				set space_code "0x02000000"
+			}
+		}
+		set ranges [lappend ranges $space_code 0 $ipifbar2pcibar $ipifbar 0 [ expr $ipif_highaddr - $ipifbar + 1 ]]
+	}
+	tree_lappend ip_tree [ list "ranges" hexinttuple $ranges ]
+
+	# Now the interrupt-map-mask etc
+	tree_lappend ip_tree [ list "interrupt-map-mask" hexinttuple "0xff00 0x0 0x0 0x7" ]
+
+	# Make sure the user knows they've still got more work to do
+	# If we were prepared to add a custom PARAMETER to the MLD then we could do moer here, but for now this is
+	# the best we can do
+	debug warning "WARNING: Cannot automatically populate PCI interrupt-map property - this must be completed manually"
+	lappend node $ip_tree
+	return $node
+}
@@ -0,0 +1,61 @@
+#
+# PS/2 IP handlers of the device tree generator
+#
+# Sourced into the generator namespace by slave_handler when the first
+# IP of the family is generated.
+#
+# (C) Copyright 2007-2013 Xilinx, Inc.
+# Based on original code:
+# (C) Copyright 2007-2013 Michal Simek
+# (C) Copyright 2007-2012 PetaLogix Qld Pty Ltd
+#
+# Michal SIMEK <monstr@monstr.eu>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License as
+# published by the Free Software Foundation; either version 2 of
+# the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+# MA 02111-1307 USA
+
+# Dual PS/2 reference core
+proc gen_slave_ps2_dual_ref {node slave intc name type} {
+	# We handle this specially, to report the two independent
+	# ports.
+	set tree [compound_slave $slave]
+	set baseaddr [scan_int_parameter_value $slave "C_BASEADDR"]
+	set highaddr [scan_int_parameter_value $slave "C_HIGHADDR"]
+	tree_lappend tree [gen_ranges_property $slave $baseaddr $highaddr 0 [tree_cells $tree]]
+	tree_lappend tree [slaveip_in_compound_intr $slave $intc "Sys_Intr1" "ps2" "" 0 0x1000 0x40]
+	tree_lappend tree [slaveip_in_compound_intr $slave $intc "Sys_Intr2" "ps2" "" 1 0x1000 0x40]
+	lappend node $tree
+	return $node
+}
+
+# XPS PS/2
+proc gen_slave_ps2 {node slave intc name type} {
+	set baseaddr [scan_int_parameter_value $slave "C_BASEADDR"]
+	set highaddr [scan_int_parameter_value $slave "C_HIGHADDR"]
+	set is_dual [scan_int_parameter_value $slave "C_IS_DUAL"]
+
+	if {$is_dual == 1} {
+		# We handle this specially, to report the two independent
+		# ports.
+		set tree [compound_slave $slave]
+		tree_lappend tree [gen_ranges_property $slave $baseaddr $highaddr 0 [tree_cells $tree]]
+		tree_lappend tree [slaveip_in_compound_intr $slave $intc "IP2INTC_Irpt_1" "ps2" "" 0 0x1000 0x40]
+		tree_lappend tree [slaveip_in_compound_intr $slave $intc "IP2INTC_Irpt_2" "ps2" "" 1 0x1000 0x40]
+		lappend node $tree
+	} else {
+		lappend node [slaveip_intr $slave $intc "IP2INTC_Irpt_1" "ps2" ""]
+	}
+	return $node
+}
@@ -0,0 +1,46 @@
+#
+# SystemACE IP handlers of the device tree generator
+#
+# Sourced into the generator namespace by slave_handler when the first
+# IP of the family is generated.
+#
+# (C) Copyright 2007-2013 Xilinx, Inc.
+# Based on original code:
+# (C) Copyright 2007-2013 Michal Simek
+# (C) Copyright 2007-2012 PetaLogix Qld Pty Ltd
+#
+# Michal SIMEK <monstr@monstr.eu>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License as
+# published by the Free Software Foundation; either version 2 of
+# the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+# MA 02111-1307 USA
+
+# System ACE
+proc gen_slave_sysace {node slave intc name type} {
+	set ip_tree [slaveip_intr $slave $intc [interrupt_list $slave] "sysace" [default_parameters $slave] ]
+	#"MEM_WIDTH"]
+	set sysace_width [hw_parameter_value $slave "C_MEM_WIDTH"]
+	if { $sysace_width == "8" } {
+		tree_lappend ip_tree [list "8-bit" empty empty]
+	} elseif { $sysace_width == "16" } {
+		tree_lappend ip_tree [list "16-bit" empty empty]
+	} else {
+		error "Unsuported Systemace memory width"
+	}
+	context_var sysace_count
+	tree_lappend ip_tree [list "port-number" int $sysace_count]
+	incr sysace_count
+	lappend node $ip_tree
+	return $node
+}
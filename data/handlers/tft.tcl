@@ -0,0 +1,40 @@
+#
+# TFT controller IP handlers of the device tree generator
+#
+# Sourced into the generator namespace by slave_handler when the first
+# IP of the family is generated.
+#
+# (C) Copyright 2007-2013 Xilinx, Inc.
+# Based on original code:
+# (C) Copyright 2007-2013 Michal Simek
+# (C) Copyright 2007-2012 PetaLogix Qld Pty Ltd
+#
+# Michal SIMEK <monstr@monstr.eu>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License as
+# published by the Free Software Foundation; either version 2 of
+# the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+# MA 02111-1307 USA
+
+# TFT controllers
+proc gen_slave_tft {node slave intc name type} {
+	lappend node [slaveip_dcr_or_plb $slave $intc "tft" [default_parameters $slave]]
+	return $node
+}
+
+# DCR based TFT/DVI reference controllers
+proc gen_slave_tft_cntlr_ref {node slave intc name type} {
+	# We handle this specially, since it is a DCR slave.
+	lappend node [slaveip_dcr $slave $intc "tft" [default_parameters $slave] "DCR_"]
+	return $node
+}
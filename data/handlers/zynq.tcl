@@ -0,0 +1,517 @@
+#
+# Zynq PS7 IP handlers of the device tree generator
+#
+# Sourced into the generator namespace by slave_handler when the first
+# IP of the family is generated.
+#
+# (C) Copyright 2007-2013 Xilinx, Inc.
+# Based on original code:
+# (C) Copyright 2007-2013 Michal Simek
+# (C) Copyright 2007-2012 PetaLogix Qld Pty Ltd
+#
+# Michal SIMEK <monstr@monstr.eu>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License as
+# published by the Free Software Foundation; either version 2 of
+# the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+# MA 02111-1307 USA
+
+# Zynq UART
+proc gen_slave_ps7_uart {node slave intc name type} {
+	set ip_tree [slaveip $slave $intc "serial" [default_parameters $slave] "S_AXI_" "xlnx,xuartps"]
+
+	context_var alias_node_list
+	context_var consoleip
+	if {[string match -nocase $name $consoleip]} {
+		lappend alias_node_list [list serial0 aliasref $name 0]
+		tree_lappend ip_tree [list "port-number" int 0]
+	} else {
+		context_var serial_count
+		incr serial_count
+		lappend alias_node_list [list serial$serial_count aliasref $name $serial_count]
+		tree_lappend ip_tree [list "port-number" int $serial_count]
+	}
+
+	# MS silly use just clock-frequency which is standard
+	tree_lappend ip_tree [list "device_type" string "serial"]
+	tree_lappend ip_tree [list "current-speed" int "115200"]
+	set ip_tree [zynq_irq $ip_tree $intc $name]
+
+	lappend node $ip_tree
+	return $node
+}
+
+# Zynq PL330 DMA
+proc gen_slave_ps7_dma {node slave intc name type} {
+	set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" "arm,primecell arm,pl330"]
+	# use TCL table
+	set ip_tree [zynq_irq $ip_tree $intc $name]
+	tree_lappend ip_tree [list "#dma-cells" int "1"]
+	tree_lappend ip_tree [list "#dma-channels" int "8"]
+	tree_lappend ip_tree [list "#dma-requests" int "4"]
+	tree_lappend ip_tree [list "arm,primecell-periphid" hexint "0x00041330"]
+
+	lappend node $ip_tree
+	return $node
+}
+
+# Zynq system level control registers with clock description
+proc gen_slave_ps7_slcr {node slave intc name type} {
+	set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" "xlnx,zynq-slcr"]
+	# use TCL table
+	set ip_tree [zynq_irq $ip_tree $intc $name]
+
+	set clock_tree [list "clocks" tree {}]
+	tree_lappend clock_tree [list "#address-cells" int "1"]
+	tree_lappend clock_tree [list "#size-cells" int "0"]
+
+	# PS_CLK node creation
+	set subclk_tree [list "ps_clk: ps_clk" tree {}]
+	tree_lappend subclk_tree [list "#clock-cells" int "0"]
+	tree_lappend subclk_tree [list "compatible" stringtuple "fixed-clock"]
+	tree_lappend subclk_tree [list "clock-output-names" stringtuple "ps_clk"]
+	tree_lappend subclk_tree [list "clock-frequency" int "33333333"]
+	tree_lappend clock_tree $subclk_tree
+
+	set subclk_tree [list "armpll: armpll" tree {}]
+	tree_lappend subclk_tree [list "#clock-cells" int "0"]
+	tree_lappend subclk_tree [list "compatible" stringtuple "xlnx,zynq-pll"]
+	tree_lappend subclk_tree [list "clocks" labelref "ps_clk"]
+	tree_lappend subclk_tree [list "reg" hexinttuple [list "0x100" "0x110" "0x10c"]]
+	tree_lappend subclk_tree [list "lockbit" int "0"]
+	tree_lappend subclk_tree [list "clock-output-names" stringtuple "armpll"]
+	tree_lappend clock_tree $subclk_tree
+
+	set subclk_tree [list "ddrpll: ddrpll" tree {}]
+	tree_lappend subclk_tree [list "#clock-cells" int "0"]
+	tree_lappend subclk_tree [list "compatible" stringtuple "xlnx,zynq-pll"]
+	tree_lappend subclk_tree [list "clocks" labelref "ps_clk"]
+	tree_lappend subclk_tree [list "reg" hexinttuple [list "0x104" "0x114" "0x10c"]]
+	tree_lappend subclk_tree [list "lockbit" int "1"]
+	tree_lappend subclk_tree [list "clock-output-names" stringtuple "ddrpll"]
+	tree_lappend clock_tree $subclk_tree
+
+	set subclk_tree [list "iopll: iopll" tree {}]
+	tree_lappend subclk_tree [list "#clock-cells" int "0"]
+	tree_lappend subclk_tree [list "compatible" stringtuple "xlnx,zynq-pll"]
+	tree_lappend subclk_tree [list "clocks" labelref "ps_clk"]
+	tree_lappend subclk_tree [list "reg" hexinttuple [list "0x108" "0x118" "0x10c"]]
+	tree_lappend subclk_tree [list "lockbit" int "2"]
+	tree_lappend subclk_tree [list "clock-output-names" stringtuple "iopll"]
+	tree_lappend clock_tree $subclk_tree
+
+	tree_lappend ip_tree $clock_tree
+
+	lappend node $ip_tree
+	return $node
+}
+
+# Zynq IPs with default description
+proc gen_slave_ps7_basic {node slave intc name type} {
+	set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" ""]
+	# use TCL table
+	set ip_tree [zynq_irq $ip_tree $intc $name]
+
+	lappend node $ip_tree
+	return $node
+}
+
+# Zynq GPIO
+proc gen_slave_ps7_gpio {node slave intc name type} {
+	set count 32
+	set ip_tree [slaveip $slave $intc "" "" "S_AXI_" ""]
+	tree_lappend ip_tree [list "emio-gpio-width" int [xget_sw_parameter_value $slave "C_EMIO_GPIO_WIDTH"]]
+	set gpiomask [xget_sw_parameter_value $slave "C_MIO_GPIO_MASK"]
+	set mask [expr {$gpiomask & 0xffffffff}]
+	tree_lappend ip_tree [list "gpio-mask-low" hexint $mask]
+	set mask [expr {$gpiomask>>$count}]
+	set mask [expr {$mask & 0xffffffff}]
+	tree_lappend ip_tree [list "gpio-mask-high" hexint $mask]
+	set ip_tree [zynq_irq $ip_tree $intc $name]
+
+	tree_lappend ip_tree [list "#gpio-cells" int "2"]
+	tree_lappend ip_tree [list "gpio-controller" empty empty]
+
+	lappend node $ip_tree
+	return $node
+}
+
+# Zynq I2C
+proc gen_slave_ps7_i2c {node slave intc name type} {
+	set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" ""]
+	# use TCL table
+	set ip_tree [zynq_irq $ip_tree $intc $name]
+
+	context_var ps7_i2c_count
+	context_var ps7_cortexa9_clk
+	tree_lappend ip_tree [list "input-clk" int [expr $ps7_cortexa9_clk/6]]
+	tree_lappend ip_tree [list "i2c-clk" int 400000]
+	tree_lappend ip_tree [list "bus-id" int $ps7_i2c_count]
+	incr ps7_i2c_count
+
+	lappend node $ip_tree
+	return $node
+}
+
+# Zynq triple timer counter
+proc gen_slave_ps7_ttc {node slave intc name type} {
+	set ip_tree [slaveip $slave $intc "" "" "S_AXI_" "cdns,ttc"]
+	# use TCL table
+	set ip_tree [zynq_irq $ip_tree $intc $name]
+
+	lappend node $ip_tree
+	return $node
+}
+
+# Zynq private timer
+proc gen_slave_ps7_scutimer {node slave intc name type} {
+	set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" ""]
+	# use TCL table
+	set ip_tree [zynq_irq $ip_tree $intc $name]
+
+	set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" "arm,cortex-a9-twd-timer"]
+	set ip_tree [zynq_irq $ip_tree $intc $name]
+
+	lappend node $ip_tree
+	return $node
+}
+
+# Zynq QSPI
+proc gen_slave_ps7_qspi {node slave intc name type} {
+	set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" ""]
+	# use TCL table
+	set ip_tree [zynq_irq $ip_tree $intc $name]
+
+	context_var ps7_spi_count
+	tree_lappend ip_tree [list "speed-hz" int [xget_sw_parameter_value $slave "C_QSPI_CLK_FREQ_HZ"]]
+	tree_lappend ip_tree [list "bus-num" int $ps7_spi_count]
+	tree_lappend ip_tree [list "num-chip-select" int 1]
+	set qspi_mode [xget_sw_parameter_value $slave "C_QSPI_MODE"]
+	if { $qspi_mode == 2} {
+		set is_dual 1
+	} else {
+		set is_dual 0
+	}
+	tree_lappend ip_tree [list "is-dual" int $is_dual]
+	incr ps7_spi_count
+
+	# We will handle SPI FLASH here
+	context_var flash_memory flash_memory_bank
+
+	if {[string match -nocase $flash_memory $name]} {
+		# Add the address-cells and size-cells to make the DTC compiler stop outputing warning
+		tree_lappend ip_tree [list "#address-cells" int "1"]
+		tree_lappend ip_tree [list "#size-cells" int "0"]
+		# If it is a SPI FLASH, we will add a SPI Flash
+		# subnode to the SPI controller
+		set subnode {}
+		# Set the SPI Flash chip select
+		lappend subnode [list "reg" hexinttuple [list $flash_memory_bank]]
+		# Set the SPI Flash clock frequency, assume it will be
+		# 1/4 of the QSPI controller frequency.
+		# Note this is not the actual maximum SPI flash frequency
+		# as we can't know.
+		lappend subnode [list [format_name "spi-max-frequency"] int [expr [xget_sw_parameter_value $slave "C_QSPI_CLK_FREQ_HZ"]/4]]
+		tree_lappend ip_tree [list [format_ip_name $type $flash_memory_bank "primary_flash"] tree $subnode]
+	}
+
+	lappend node $ip_tree
+	return $node
+}
+
+# Zynq system watchdog
+proc gen_slave_ps7_wdt {node slave intc name type} {
+	set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" ""]
+	# use TCL table
+	set ip_tree [zynq_irq $ip_tree $intc $name]
+
+	tree_lappend ip_tree [list "device_type" string "watchdog"]
+	tree_lappend ip_tree [list "reset" int 0]
+	tree_lappend ip_tree [list "timeout" int 10]
+
+	lappend node $ip_tree
+	return $node
+}
+
+# Zynq private watchdog
+proc gen_slave_ps7_scuwdt {node slave intc name type} {
+	set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" ""]
+	# use TCL table
+	set ip_tree [zynq_irq $ip_tree $intc $name]
+
+	tree_lappend ip_tree [list "device_type" string "watchdog"]
+
+	lappend node $ip_tree
+	return $node
+}
+
+# Zynq USB
+proc gen_slave_ps7_usb {node slave intc name type} {
+	set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" ""]
+	# use TCL table
+	set ip_tree [zynq_irq $ip_tree $intc $name]
+
+	tree_lappend ip_tree [list "dr_mode" string "host"]
+	tree_lappend ip_tree [list "phy_type" string "ulpi"]
+
+	lappend node $ip_tree
+	return $node
+}
+
+# Zynq SPI
+proc gen_slave_ps7_spi {node slave intc name type} {
+	set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" ""]
+	# use TCL table
+	set ip_tree [zynq_irq $ip_tree $intc $name]
+
+	context_var ps7_spi_count
+	tree_lappend ip_tree [list "speed-hz" int [xget_sw_parameter_value $slave "C_SPI_CLK_FREQ_HZ"]]
+	tree_lappend ip_tree [list "bus-num" int $ps7_spi_count]
+	tree_lappend ip_tree [list "num-chip-select" int 4]
+	incr ps7_spi_count
+	# We will handle SPI FLASH here
+	context_var flash_memory flash_memory_bank
+
+	if {[string match -nocase $flash_memory $name]} {
+		# Add the address-cells and size-cells to make the DTC compiler stop outputing warning
+		tree_lappend ip_tree [list "#address-cells" int "1"]
+		tree_lappend ip_tree [list "#size-cells" int "0"]
+		# If it is a SPI FLASH, we will add a SPI Flash
+		# subnode to the SPI controller
+		set subnode {}
+		# Set the SPI Flash chip select
+		lappend subnode [list "reg" hexinttuple [list $flash_memory_bank]]
+		# Set the SPI Flash clock freqeuncy
+		# hardcode this spi-max-frequency (based on board_zc770_xm010.c)
+		lappend subnode [list [format_name "spi-max-frequency"] int 75000000]
+		tree_lappend ip_tree [list [format_ip_name $type $flash_memory_bank "primary_flash"] tree $subnode]
+	}
+
+	lappend node $ip_tree
+	return $node
+}
+
+# Zynq SDIO
+proc gen_slave_ps7_sdio {node slave intc name type} {
+	set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" "generic-sdhci"]
+	# FIXME linux sdhci requires clock-frequency even if we use common clock framework
+	tree_lappend ip_tree [list "clock-frequency" int [xget_sw_parameter_value $slave "C_SDIO_CLK_FREQ_HZ"]]
+	set ip_tree [zynq_irq $ip_tree $intc $name]
+	lappend node $ip_tree
+	return $node
+}
+
+# Zynq static memory controller, NAND/NOR flashes are its subnodes
+proc gen_slave_ps7_smcc {node slave intc name type} {
+	set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" "xlnx,ps7-smc"]
+
+	# use TCL table
+	set ip_tree [zynq_irq $ip_tree $intc $type]
+
+	context_var ps7_smcc_list
+	if {![string match "" $ps7_smcc_list]} {
+		# The flashes have reg with the cells of the bus
+		set cells [cells_current]
+		tree_lappend ip_tree [list "#address-cells" int [lindex $cells 0]]
+		tree_lappend ip_tree [list "#size-cells" int [lindex $cells 1]]
+		tree_lappend ip_tree [list ranges empty empty]
+
+		tree_lappend ip_tree $ps7_smcc_list
+	}
+
+	lappend node $ip_tree
+	return $node
+}
+
+# Zynq NAND, added to the ps7_smcc node
+proc gen_slave_ps7_nand {node slave intc name type} {
+	# just C_S_AXI_BASEADDR  C_S_AXI_HIGHADDR C_NAND_CLK_FREQ_HZ C_NAND_MODE C_INTERCONNECT_S_AXI_MASTERS HW_VER INSTANCE
+	set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" ""]
+
+	# FIXME: set reg size to 16MB. This is a workaround for 14.4
+	# tools provides the wrong high address of NAND
+	set baseaddr [scan_int_parameter_value $slave "C_S_AXI_BASEADDR"]
+	tree_node_lset ip_tree "reg" [list "reg" hexinttuple [reg_cells $baseaddr "16777216"]]
+
+	context_var flash_memory
+	if {[ string match -nocase $name $flash_memory ]} {
+		set ip_tree [change_nodename $ip_tree $name "primary_flash"]
+	}
+
+	context_var ps7_smcc_list
+
+	set ps7_smcc_list "$ps7_smcc_list $ip_tree"
+	return $node
+}
+
+# Zynq NOR, added to the ps7_smcc node
+proc gen_slave_ps7_nor {node slave intc name type} {
+	# NOTE: For 14.4, the ps7_sram_* is refer to NOR flash not SRAM
+	context_var flash_memory
+	if {[ string match -nocase $name $flash_memory ]} {
+		set ip_tree [slaveip $slave $intc "flash" [default_parameters $slave] "S_AXI_" "cfi-flash"]
+		set ip_tree [change_nodename $ip_tree $name "primary_flash"]
+	} else {
+		set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" "cfi-flash"]
+	}
+
+	tree_lappend ip_tree [list "bank-width" int 1]
+
+	regsub -all "ps7_sram" $ip_tree "ps7_nor" ip_tree
+	regsub -all "ps7-sram" $ip_tree "ps7-nor" ip_tree
+
+	context_var ps7_smcc_list
+	set ps7_smcc_list "$ps7_smcc_list $ip_tree"
+	return $node
+}
+
+# Zynq GIC
+proc gen_slave_ps7_scugic {node slave intc name type} {
+	# FIXME this node should be provided by SDK and not to compose it by hand
+
+	# just test code to show all interrupts
+#			set port_handles [xget_hw_port_handle $slave "*"]
+#			foreach i $port_handles {
+#				set signals [xget_hw_port_value $slave [xget_hw_name $i]]
+#				puts "$i [xget_hw_name $i] -- $signals --"
+#			}
+
+	# Replace _ with - in type to be compatible
+	regsub -all "_" $type "-" type
+
+	# Add interrupt distributor because it is not detected
+	set tree [list "$name: $type@f8f01000" tree \
+			[list \
+				[gen_compatible_property $name $type [hw_parameter_value $slave "HW_VER"] "arm,cortex-a9-gic arm,gic" ] \
+				[list "reg" hexinttuple [concat [reg_cells "0xF8F01000" "0x1000"] [reg_cells "0xF8F00100" "0x100"]] ] \
+				[list "#interrupt-cells" inttuple "3" ] \
+				[list "#address-cells" inttuple "2" ] \
+				[list "#size-cells" inttuple "1" ] \
+				[list "interrupt-controller" empty empty ] \
+				[list "linux,phandle" hexinttuple "0x1" ] \
+				[list "phandle" hexinttuple "0x1" ] \
+			] \
+		]
+	lappend node $tree
+
+#			lappend node [gen_intc $slave "" "interrupt-controller" [default_parameters $slave] "S_AXI_" "arm,gic"]
+	return $node
+}
+
+# Zynq L2 cache controller
+proc gen_slave_ps7_pl310 {node slave intc name type} {
+	variable cache_geometry
+	variable pl310_config
+
+	set tree [list "ps7_pl310_0: ps7-pl310@f8f02000" tree \
+			[list \
+				[gen_compatible_property "ps7_pl310" "ps7_pl310" "1.00.a" "arm,pl310-cache" ] \
+				[list "cache-unified" empty empty ] \
+				[list "cache-level" inttuple "2" ] \
+				[list "reg" hexinttuple [reg_cells "0xF8F02000" "0x1000"] ] \
+			] \
+		]
+	foreach prop [cache_properties "cache" $cache_geometry(ps7_pl310)] {
+		tree_lappend tree $prop
+	}
+	foreach {prop value} $pl310_config {
+		tree_lappend tree [list $prop inttuple $value]
+	}
+	set tree [zynq_irq $tree $intc $name]
+	lappend node $tree
+	return $node
+}
+
+# Zynq XADC
+proc gen_slave_ps7_xadc {node slave intc name type} {
+	set tree [list "ps7_xadc: ps7-xadc@f8007100" tree \
+			[list \
+				[gen_compatible_property "ps7_xadc" "ps7_xadc" "1.00.a" ] \
+				[list "reg" hexinttuple [reg_cells "0xF8007100" "0x20"] ] \
+			] \
+		]
+	set tree [zynq_irq $tree $intc $name]
+	lappend node $tree
+	return $node
+}
+
+# Zynq Ethernet
+proc gen_slave_ps7_ethernet {node slave intc name type} {
+	context_var phy_count
+	context_var mac_count
+
+	context_var ethernet_count
+	context_var alias_node_list
+	set alias_node [list ethernet$ethernet_count aliasref $name $ethernet_count]
+	lappend alias_node_list $alias_node
+	incr ethernet_count
+
+	set ip_tree [slaveip $slave $intc "" [default_parameters $slave] "S_AXI_" ""]
+	set ip_tree [zynq_irq $ip_tree $intc $name]
+	tree_lappend ip_tree [list "local-mac-address" bytesequence [list 0x00 0x0a 0x35 0x00 0x00 $mac_count]]
+	incr mac_count
+	tree_lappend ip_tree [list "#address-cells" int "1"]
+	tree_lappend ip_tree [list "#size-cells" int "0"]
+	set phy_name "phy$phy_count"
+	tree_lappend ip_tree [list "phy-handle" labelref $phy_name]
+
+	set mdio_tree [list "mdio" tree {}]
+	tree_lappend mdio_tree [list \#size-cells int 0]
+	tree_lappend mdio_tree [list \#address-cells int 1]
+	set phya 7
+	set phy_chip "marvell,88e1116r"
+	tree_lappend mdio_tree [gen_phytree $slave $phya $phy_chip]
+
+	set phya [is_gmii2rgmii_conv_present $slave]
+	if { $phya != "-1" } {
+		set phy_name "phy$phy_count"
+		tree_lappend ip_tree [list "gmii2rgmii-phy-handle" labelref $phy_name]
+		set phy_chip "xlnx,gmii2rgmii"
+		tree_lappend mdio_tree [gen_phytree $slave $phya $phy_chip]
+	}
+	tree_lappend ip_tree $mdio_tree
+
+	context_var ps7_cortexa9_1x_clk
+	tree_lappend ip_tree [list "xlnx,ptp-enet-clock" int $ps7_cortexa9_1x_clk]
+
+	set phymode [scan_int_parameter_value $slave "C_ETH_MODE"]
+	if { $phymode == 0 } {
+		tree_lappend ip_tree [list "phy-mode" string "gmii"]
+	} else {
+		tree_lappend ip_tree [list "phy-mode" string "rgmii-id"]
+	}
+
+	lappend node $ip_tree
+	return $node
+}
+
+# Zynq on chip memory
+proc gen_slave_ps7_ram {node slave intc name type} {
+	context_var sram_nodes
+	if {"$name" == "ps7_ram_0"} {
+		if {[info exists sram_nodes] && [string is true -strict $sram_nodes]} {
+			set ip_tree [slaveip $slave $intc "" "" "S_AXI_" "xlnx,ps7-ocm mmio-sram"]
+			tree_lappend ip_tree [list \#address-cells int 1]
+			tree_lappend ip_tree [list \#size-cells int 1]
+			tree_lappend ip_tree [list "ranges" hexinttuple [concat 0 [encode_cells "0xfffc0000" [lindex [cells_current] 0]] "262144"]]
+		} else {
+			set ip_tree [slaveip $slave $intc "" "" "S_AXI_" "xlnx,ps7-ocm"]
+		}
+		tree_node_lset ip_tree "reg" [list "reg" hexinttuple [reg_cells "0xfffc0000" "262144"]]
+		# use TCL table
+		set ip_tree [zynq_irq $ip_tree $intc $name]
+
+		lappend node $ip_tree
+	}
+	return $node
+}